@@ -4,6 +4,10 @@
 #include "build_tools.hpp"
 #include "cli_args.hpp"
 
+// Dump settings of network lib are the same for all builds, so they are set once before
+// any build (BGP cache may be refreshed in background while they are read)
+void initBGPSettings();
+
 std::optional<GeoReleases> buildListsHandler(const CmdArgs& args);
 
 #endif // BUILD_LISTS_HANDLER_HPP
\ No newline at end of file
@@ -44,6 +44,7 @@ extern CLI::App* gBuildSubCmd;
 extern CLI::App* gCheckSubCmd;
 extern CLI::App* gServiceSubCmd;
 extern CLI::App* gShowSubCmd;
+extern CLI::App* gBGPStatsSubCmd;
 extern CLI::Option* gOutPathOption;
 
 bool validateParsedFormats(const CmdArgs& args);
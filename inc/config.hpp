@@ -3,8 +3,10 @@
 
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "main_sources.hpp"
+#include "libnetwork_settings.hpp"
 
 #define CFG_DEFAULT_NUM_VALUE   0u
 #define CFG_DEFAULT_STR_VALUE   ""
@@ -23,7 +25,11 @@ struct RgcConfig {
     SourcesStorage sources;
 
     std::string whitelistPath;
-    std::string bgpDumpPath;
+    std::vector<std::string> bgpDumpPaths;
+    std::vector<std::string> bgpUpdatePaths;
+    BGPTrieType bgpTrieType = BGPTrieType::PATRICIA;
+    IPv4LookupType ipv4LookupType = IPv4LookupType::TRIE;
+    IPv6LookupType ipv6LookupType = IPv6LookupType::TRIE;
 };
 
 bool writeConfig(const RgcConfig& config);
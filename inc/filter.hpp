@@ -5,16 +5,29 @@
 #include <fs_utils.hpp>
 
 #include "net_types_base.hpp"
+#include "cares_resolver.hpp"
+#include "whitelist_index.hpp"
 #include "main_sources.hpp"
 
 bool checkAddressByLists(const std::string& addr, const NetTypes::ListIPv4& ipv4, const NetTypes::ListIPv6& ipv6);
 
-bool checkFileByIPvLists(const fs::path& path, const NetTypes::ListIPvxPair& listsPair, bool applyFix);
+// Resolver must not be shared between threads, every thread which checks files owns its resolver.
+// Pipelined check reads, classifies, resolves and writes lines in parallel stages,
+// its output is the same as output of sequential check (order of lines is kept)
+bool checkFileByIPvLists(const fs::path& path, const WhitelistIndex& whitelist, NetUtils::CAresResolver& resolver, bool applyFix, bool isPipelined = true);
 
-void parseAddressFile(const fs::path& path, NetTypes::ListIPvxPair& listsPair);
+// Domains of file are resolved to IPs, domains themselves are also added to domains (if it is set)
+void parseAddressFile(const fs::path& path, NetTypes::ListIPvxPair& listsPair, NetTypes::ListAddress* domains = nullptr);
+
+// Replace subnets in file with minimal list of subnets covering the same addresses:
+// subnets covered by others are dropped, adjacent ones are merged. Count of removed lines is returned,
+// count of lines left in file is written to linesCount (if it is set). Order of lines is not kept:
+// lines which are not subnets are written first as is, then sorted IPv4 and IPv6 subnets (IPv6 in compressed form)
+size_t aggregateAddressFile(const fs::path& path, size_t* linesCount = nullptr);
 
 bool isUrl(const std::string& str);
 
+// Files are checked concurrently with one compiled whitelist
 void filterDownloadsByWhitelist(const std::vector<DownloadedSourcePair>& downloadedFiles);
 
 bool extractDomainsInPlace(const std::string& filePath);
@@ -17,4 +17,6 @@ void printHelp(const CLI::App& app);
 
 void checkSourcesAvailability(const CmdArgs& args);
 
+bool showBGPStats();
+
 #endif // HANDLERS_HPP
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <forward_list>
+#include <optional>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -15,7 +16,17 @@ class SourcePreset;
 
 // ID of source saved in configuration file
 using SourceObjectId = uint16_t;
-using DownloadedSourcePair = std::pair<SourceObjectId, fs::path>;
+
+// Downloaded (or joined) file of source with metadata collected while it is processed
+struct DownloadedSourcePair {
+    DownloadedSourcePair(const SourceObjectId id, fs::path path) : first(id), second(std::move(path)) {}
+
+    SourceObjectId first;
+    fs::path second;
+
+    // Count of lines recorded by the last pass which rewrote file, empty if file was changed after it
+    std::optional<size_t> linesCount;
+};
 
 using SourcesStorage = std::unordered_map<SourceObjectId, Source>;
 using SourcePresetsStorage = std::unordered_map<std::string, SourcePreset>;
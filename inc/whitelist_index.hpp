@@ -0,0 +1,66 @@
+#ifndef WHITELIST_INDEX_HPP
+#define WHITELIST_INDEX_HPP
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <fs_utils.hpp>
+
+#include "ip_range_set.hpp"
+#include "domain_suffix_set.hpp"
+#include "time_tools.hpp"
+
+// Time after which resolved IPs of whitelisted domains are considered stale
+#define WHITELIST_INDEX_TTL_SEC     HOURS_TO_SEC(12)
+
+// Count of verdicts kept by DomainVerdictCache, least recently used ones are evicted
+#define WHITELIST_VERDICTS_MAX_COUNT    (1u << 18)
+
+// Verdicts of resolved domains (true - IPs of domain overlap whitelist), shared by threads.
+// Only successful resolutions are inserted, so failed DNS lookup is retried when domain is met again
+class DomainVerdictCache {
+public:
+    DomainVerdictCache() = default;
+
+    explicit DomainVerdictCache(const size_t maxCount) : m_maxCount(maxCount) {}
+
+    // Found verdict becomes the most recently used one
+    [[nodiscard]]
+    std::optional<bool> find(std::string_view domain) const;
+
+    void insert(const std::string& domain, bool isFound);
+
+    [[nodiscard]]
+    size_t size() const;
+
+private:
+    using Entry = std::pair<std::string, bool>;
+
+    mutable std::mutex m_mtx;
+
+    // Most recently used first, keys of map point to its strings
+    mutable std::list<Entry> m_order;
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> m_verdicts;
+
+    size_t m_maxCount = WHITELIST_VERDICTS_MAX_COUNT;
+};
+
+// Whitelist compiled for matching: ranges of its subnets (and IPs of its domains) and its domains with subdomains
+struct WhitelistIndex {
+    NetTypes::IPRangeSetPair ranges;
+    NetTypes::DomainSuffixSet domains;
+
+    // Filled during checks, so a domain met in several files is resolved once
+    mutable DomainVerdictCache verdicts;
+};
+
+// Compiled index of whitelist file. It is built (parsed, resolved and fixed by BGP) only if
+// whitelist content, settings of parsing or BGP dump changed or index is older than WHITELIST_INDEX_TTL_SEC.
+// Index is kept in memory for the whole process and saved to binary cache for next runs (only the latest one is kept)
+std::shared_ptr<const WhitelistIndex> loadWhitelistIndex(const fs::path& whitelistPath);
+
+#endif // WHITELIST_INDEX_HPP
@@ -0,0 +1,71 @@
+#ifndef BOUNDED_QUEUE_HPP
+#define BOUNDED_QUEUE_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+// FIFO queue between threads of pipeline: producer waits while queue is full, consumer waits while it is empty.
+// After close() producers fail and consumers get remaining items and then std::nullopt
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(const size_t capacity) : m_capacity(capacity ? capacity : 1) {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // False if queue is closed, item is dropped then
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(m_mtx);
+        m_notFull.wait(lock, [this] { return m_isClosed || m_items.size() < m_capacity; });
+
+        if (m_isClosed) {
+            return false;
+        }
+
+        m_items.push_back(std::move(item));
+        m_notEmpty.notify_one();
+
+        return true;
+    }
+
+    // std::nullopt if queue is closed and empty
+    std::optional<T> pop() {
+        std::unique_lock<std::mutex> lock(m_mtx);
+        m_notEmpty.wait(lock, [this] { return m_isClosed || !m_items.empty(); });
+
+        if (m_items.empty()) {
+            return std::nullopt;
+        }
+
+        T item = std::move(m_items.front());
+        m_items.pop_front();
+        m_notFull.notify_one();
+
+        return item;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_isClosed = true;
+        }
+
+        m_notFull.notify_all();
+        m_notEmpty.notify_all();
+    }
+
+private:
+    const size_t m_capacity;
+
+    std::deque<T> m_items;
+    std::mutex m_mtx;
+    std::condition_variable m_notFull;
+    std::condition_variable m_notEmpty;
+    bool m_isClosed = false;
+};
+
+#endif // BOUNDED_QUEUE_HPP
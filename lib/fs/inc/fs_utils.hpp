@@ -9,7 +9,8 @@ size_t countLinesInFile(const fs::path& filePath);
 
 size_t removeDuplicateLines(const std::string& fileAPath, const std::string& fileBPath);
 
-size_t removeDuplicateLines(const std::string& inputPath, const std::string* outputPath = nullptr);
+// Empty lines are removed too. Count of removed lines is returned, count of lines left is written to linesCount (if it is set)
+size_t removeDuplicateLines(const std::string& inputPath, const std::string* outputPath = nullptr, size_t* linesCount = nullptr);
 
 void joinTwoFiles(const std::string& fileAPath, const std::string& fileBPath);
 
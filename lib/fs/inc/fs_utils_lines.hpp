@@ -0,0 +1,55 @@
+#ifndef FS_UTILS_LINES_HPP
+#define FS_UTILS_LINES_HPP
+
+#include "fs_utils_types_base.hpp"
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "fs_utils_mmap.hpp"
+
+namespace FS::Utils {
+    // How lines are handled before they are yielded by LineSource
+    struct LineOptions {
+        bool trim = false;                  // Spaces, tabs and '\r' are removed from both ends
+        bool skipEmpty = false;             // Empty lines (after trim) are not yielded
+        std::string_view commentChars;      // Lines starting with one of these chars (after trim) are not yielded
+    };
+
+    // Lines of file ('\n' or "\r\n") as views, nothing is copied per line.
+    // Regular file is mapped, pipe or other stream which can not be mapped is read to own buffer by read() calls.
+    // Views are valid while source is alive
+    class LineSource {
+    public:
+        // Throws std::ios_base::failure if file can not be opened or read
+        explicit LineSource(const fs::path& path, LineOptions options = {});
+
+        LineSource(const LineSource&) = delete;
+        LineSource& operator=(const LineSource&) = delete;
+        LineSource(LineSource&&) = delete;
+        LineSource& operator=(LineSource&&) = delete;
+
+        // False if there are no more lines
+        bool next(std::string_view& line);
+
+        // Whole content of file, for parsers which split lines by themselves
+        [[nodiscard]] std::string_view content() const { return m_content; }
+
+    private:
+        bool nextRaw(std::string_view& line);
+
+        std::optional<MappedFile> m_mapped;
+        std::string m_buffer;               // Content of stream which is not mapped
+        std::string_view m_content;
+        size_t m_pos = 0;
+
+        LineOptions m_options;
+    };
+
+    // Count of lines in content like std::getline gives: last line may be without '\n'.
+    // Line breaks are counted by AVX2 if CPU supports it, by memchr otherwise
+    size_t countLines(std::string_view content);
+}
+
+#endif //FS_UTILS_LINES_HPP
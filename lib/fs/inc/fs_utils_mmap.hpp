@@ -0,0 +1,34 @@
+#ifndef FS_UTILS_MMAP_HPP
+#define FS_UTILS_MMAP_HPP
+
+#include "fs_utils_types_base.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace FS::Utils {
+    // Read-only memory mapping of whole file, unmapped in dtor
+    class MappedFile {
+    public:
+        // Throws std::ios_base::failure if file can not be opened or mapped
+        explicit MappedFile(const fs::path& path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&&) = delete;
+        MappedFile& operator=(MappedFile&&) = delete;
+
+        [[nodiscard]] const uint8_t* data() const { return m_data; }
+        [[nodiscard]] size_t size() const { return m_size; }
+
+        // Hint kernel that file is read from begin to end (more read-ahead)
+        void adviseSequential() const;
+
+    private:
+        const uint8_t* m_data = nullptr;
+        size_t m_size = 0;
+    };
+}
+
+#endif //FS_UTILS_MMAP_HPP
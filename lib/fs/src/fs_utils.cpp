@@ -3,11 +3,13 @@
 #include <unordered_set>
 
 #include "fs_utils_temp.hpp"
+#include "fs_utils_lines.hpp"
 #include "log.hpp"
 #include "fs_utils.hpp"
 
 #include <algorithm>
 
+using namespace FS::Utils;
 using namespace FS::Utils::Temp;
 
 void removePath(const std::string& path) {
@@ -20,18 +22,9 @@ size_t countLinesInFile(const fs::path& filePath) {
         throw std::ios_base::failure(FILE_LOCATE_ERROR_MSG + filePath.string());
     }
 
-    std::ifstream file(filePath);
-    if (!file.is_open()) {
-        throw std::ios_base::failure(FILE_OPEN_ERROR_MSG + filePath.string());
-    }
-
-    size_t line_count = 0;
-    std::string line;
-    while (std::getline(file, line)) {
-        ++line_count;
-    }
+    const LineSource file(filePath);
 
-    return line_count;
+    return countLines(file.content());
 }
 
 bool isDirEmpty(const fs::path& p, const bool allowNonExist) {
@@ -43,19 +36,20 @@ bool isDirEmpty(const fs::path& p, const bool allowNonExist) {
     return fs::directory_iterator(p) == fs::directory_iterator();
 }
 
-size_t removeDuplicateLines(const std::string& inputPath, const std::string* outputPath) {
-    std::vector<std::string> lines;
-    std::string line;
+size_t removeDuplicateLines(const std::string& inputPath, const std::string* outputPath, size_t* linesCount) {
+    // Views point into mapped input, so it is never truncated while lines are written
+    if (outputPath != nullptr && *outputPath == inputPath) {
+        outputPath = nullptr;
+    }
 
-    std::ifstream in(inputPath);
-    if (!in.is_open()) throw std::ios_base::failure(FILE_OPEN_ERROR_MSG + inputPath);
+    LineSource in(inputPath, {false, true, ""});
 
-    while (std::getline(in, line)) {
-        if (!line.empty()) {
-            lines.push_back(line);
-        }
+    std::vector<std::string_view> lines;
+    std::string_view line;
+
+    while (in.next(line)) {
+        lines.push_back(line);
     }
-    in.close();
 
     size_t removedCount = lines.size();
 
@@ -66,6 +60,10 @@ size_t removeDuplicateLines(const std::string& inputPath, const std::string* out
 
     removedCount -= lines.size();
 
+    if (linesCount != nullptr) {
+        *linesCount = lines.size();
+    }
+
     std::ofstream out(targetPath);
     for (const auto& l : lines) {
         out << l << "\n";
@@ -81,7 +79,7 @@ size_t removeDuplicateLines(const std::string& inputPath, const std::string* out
 
 size_t removeDuplicateLines(const std::string& fileAPath, const std::string& fileBPath) {
     // Открываем файл B и читаем строки в множество
-    std::unordered_set<std::string> linesInB;
+    std::unordered_set<std::string_view> linesInB;
     const std::string* fileForReplace;
     const std::string* fileForSearch;
     size_t lineCntA, lineCntB, dupeCnt;
@@ -102,21 +100,13 @@ size_t removeDuplicateLines(const std::string& fileAPath, const std::string& fil
         fileForSearch = &fileBPath;
     }
 
-    std::ifstream fileSearch(*fileForSearch);
-    if (!fileSearch.is_open()) {
-        throw std::ios_base::failure(FILE_OPEN_ERROR_MSG + *fileForSearch);
-    }
+    // Views in set point into mapped file, so it is kept open until the end
+    LineSource fileSearch(*fileForSearch);
 
-    std::string line;
-    while (std::getline(fileSearch, line)) {
+    std::string_view line;
+    while (fileSearch.next(line)) {
         linesInB.insert(line);
     }
-    fileSearch.close();
-
-    std::ifstream fileReplace(*fileForReplace);
-    if (!fileReplace.is_open()) {
-        throw std::ios_base::failure(FILE_OPEN_ERROR_MSG + *fileForReplace);
-    }
 
     std::ofstream tempFileReplace(tempFile.lock()->path);
     if (!tempFileReplace.is_open()) {
@@ -125,16 +115,20 @@ size_t removeDuplicateLines(const std::string& fileAPath, const std::string& fil
 
     dupeCnt = 0;
 
-    while (std::getline(fileReplace, line)) {
-        if (linesInB.find(line) == linesInB.end()) {
-            tempFileReplace << line << std::endl;
-        } else {
-            ++dupeCnt;
+    {
+        // Mapping is released before file is replaced
+        LineSource fileReplace(*fileForReplace);
+
+        while (fileReplace.next(line)) {
+            if (linesInB.find(line) == linesInB.end()) {
+                tempFileReplace << line << '\n';
+            } else {
+                ++dupeCnt;
+            }
         }
     }
 
     tempFileReplace.close();
-    fileReplace.close();
 
     fs::remove(*fileForReplace);
     fs::rename(tempFile.lock()->path, *fileForReplace);
@@ -0,0 +1,189 @@
+#include "fs_utils_lines.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ios>
+
+#include "log.hpp"
+
+// AVX2 version is compiled with target attribute and selected at runtime
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define LINE_COUNT_X86
+#include <immintrin.h>
+#endif
+
+using namespace FS::Utils;
+
+// Size of one read() call for streams which can not be mapped
+#define LINE_SOURCE_READ_SIZE   (64u * 1024u)
+
+#define LINE_TRIM_CHARS         " \t\r"
+
+// 8-bit counter of each byte of AVX2 register is summed before it may overflow
+#define LINE_COUNT_AVX2_MAX_BLOCKS  255u
+
+static void readStream(const fs::path& path, std::string& buffer) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        throw std::ios_base::failure(FILE_OPEN_ERROR_MSG + path.string());
+    }
+
+    size_t size = 0;
+
+    while (true) {
+        buffer.resize(size + LINE_SOURCE_READ_SIZE);
+
+        const ssize_t count = ::read(fd, buffer.data() + size, LINE_SOURCE_READ_SIZE);
+
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (count < 0) {
+            ::close(fd);
+            throw std::ios_base::failure(FILE_OPEN_ERROR_MSG + path.string());
+        }
+
+        if (count == 0) {
+            break;
+        }
+
+        size += static_cast<size_t>(count);
+    }
+
+    ::close(fd);
+    buffer.resize(size);
+}
+
+static std::string_view trimLine(std::string_view line) {
+    const size_t first = line.find_first_not_of(LINE_TRIM_CHARS);
+
+    if (first == std::string_view::npos) {
+        return {};
+    }
+
+    return line.substr(first, line.find_last_not_of(LINE_TRIM_CHARS) - first + 1);
+}
+
+LineSource::LineSource(const fs::path& path, const LineOptions options) : m_options(options) {
+    std::error_code ec;
+
+    if (fs::is_regular_file(path, ec)) {
+        m_mapped.emplace(path);
+        m_mapped->adviseSequential();
+
+        m_content = {reinterpret_cast<const char*>(m_mapped->data()), m_mapped->size()};
+    } else {
+        readStream(path, m_buffer);
+
+        m_content = m_buffer;
+    }
+}
+
+bool LineSource::nextRaw(std::string_view& line) {
+    if (m_pos == m_content.size()) {
+        return false;
+    }
+
+    const char* first = m_content.data() + m_pos;
+    const size_t rest = m_content.size() - m_pos;
+    const auto* end = static_cast<const char*>(std::memchr(first, '\n', rest));
+
+    if (end == nullptr) {
+        // Last line without '\n'
+        line = {first, rest};
+        m_pos = m_content.size();
+    } else {
+        line = {first, static_cast<size_t>(end - first)};
+        m_pos += line.size() + 1;
+    }
+
+    return true;
+}
+
+bool LineSource::next(std::string_view& line) {
+    while (nextRaw(line)) {
+        if (m_options.trim) {
+            line = trimLine(line);
+        }
+
+        if (line.empty() && m_options.skipEmpty) {
+            continue;
+        }
+
+        if (!line.empty() && m_options.commentChars.find(line.front()) != std::string_view::npos) {
+            continue;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+static size_t countNewlinesByMemchr(const char* first, const char* last) {
+    size_t count = 0;
+
+    while ((first = static_cast<const char*>(std::memchr(first, '\n', last - first))) != nullptr) {
+        ++count;
+        ++first;
+    }
+
+    return count;
+}
+
+#ifdef LINE_COUNT_X86
+__attribute__((target("avx2")))
+static size_t countNewlinesAVX2(const char* first, const char* last) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t count = 0;
+
+    while (last - first >= 32) {
+        const size_t blocks = std::min<size_t>((last - first) / 32, LINE_COUNT_AVX2_MAX_BLOCKS);
+        __m256i counters = _mm256_setzero_si256();
+
+        // Match is 0xFF (-1), so it is subtracted to increase counter of its byte
+        for (size_t i = 0; i < blocks; ++i, first += 32) {
+            const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+            counters = _mm256_sub_epi8(counters, _mm256_cmpeq_epi8(chars, newline));
+        }
+
+        const __m256i sums = _mm256_sad_epu8(counters, _mm256_setzero_si256());
+
+        count += static_cast<size_t>(_mm256_extract_epi64(sums, 0)) +
+                 static_cast<size_t>(_mm256_extract_epi64(sums, 1)) +
+                 static_cast<size_t>(_mm256_extract_epi64(sums, 2)) +
+                 static_cast<size_t>(_mm256_extract_epi64(sums, 3));
+    }
+
+    return count + countNewlinesByMemchr(first, last);
+}
+#endif
+
+static size_t countNewlines(const char* first, const char* last) {
+#ifdef LINE_COUNT_X86
+    // CPU features are detected once
+    static const bool isAVX2 = __builtin_cpu_supports("avx2");
+
+    if (isAVX2) {
+        return countNewlinesAVX2(first, last);
+    }
+#endif
+
+    return countNewlinesByMemchr(first, last);
+}
+
+size_t FS::Utils::countLines(const std::string_view content) {
+    if (content.empty()) {
+        return 0;
+    }
+
+    const size_t count = countNewlines(content.data(), content.data() + content.size());
+
+    return content.back() == '\n' ? count : count + 1;
+}
@@ -0,0 +1,56 @@
+#include "fs_utils_mmap.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <ios>
+
+#include "log.hpp"
+
+using namespace FS::Utils;
+
+MappedFile::MappedFile(const fs::path& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        throw std::ios_base::failure(FILE_OPEN_ERROR_MSG + path.string());
+    }
+
+    struct stat st {};
+
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::ios_base::failure(FILE_OPEN_ERROR_MSG + path.string());
+    }
+
+    m_size = static_cast<size_t>(st.st_size);
+
+    // Empty file can not be mapped, it is represented by null data
+    if (m_size != 0) {
+        void* addr = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (addr == MAP_FAILED) {
+            ::close(fd);
+            throw std::ios_base::failure(FILE_OPEN_ERROR_MSG + path.string());
+        }
+
+        m_data = static_cast<const uint8_t*>(addr);
+    }
+
+    // Mapping stays valid after descriptor is closed
+    ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (m_data != nullptr) {
+        ::munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+}
+
+void MappedFile::adviseSequential() const {
+    if (m_data != nullptr) {
+        ::madvise(const_cast<uint8_t*>(m_data), m_size, MADV_SEQUENTIAL);
+    }
+}
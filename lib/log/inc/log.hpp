@@ -41,7 +41,8 @@ void initLogging();
 
 void loggerFlush();
 
-void logFilterCheckProgress(float progress);
+// Progress of one file, prevProgress keeps last logged value (files may be checked concurrently)
+void logFilterCheckProgress(const std::string& fileName, float progress, float& prevProgress);
 
 void suppressConsoleOutput();
 
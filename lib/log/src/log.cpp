@@ -77,16 +77,14 @@ void initLogging() {
 // Old wrappers
 // ====================
 
-void logFilterCheckProgress(float progress) {
-    static float prevProgress = 0.0f;
-
+void logFilterCheckProgress(const std::string& fileName, const float progress, float& prevProgress) {
     if (prevProgress > progress)
         prevProgress = 0.0f;
 
     if ((progress - prevProgress) >= gkResolveProgressStep) {
         float pct = progress * 100.0f;
 
-        LOG_INFO("File filter-check in progress: {:.1f} %", pct);
+        LOG_INFO("File {} filter-check in progress: {:.1f} %", fileName, pct);
 
         prevProgress = progress;
     }
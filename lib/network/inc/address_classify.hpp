@@ -0,0 +1,28 @@
+#ifndef ADDRESS_CLASSIFY_HPP
+#define ADDRESS_CLASSIFY_HPP
+
+#include <string_view>
+
+#include "net_types_base.hpp"
+
+namespace NetUtils {
+    // Type of entry and its value parsed in the same pass
+    struct AddressInfo {
+        NetTypes::AddressType type = NetTypes::AddressType::UNKNOWN;
+
+        // Only for IPV4 and IPV6, prefix is 0 if it is not specified (see hasPrefix)
+        NetTypes::SubnetVariant subnet;
+
+        bool hasPrefix = false;
+    };
+
+    // Single pass over input by table of character classes, nothing is allocated.
+    // IPv4 is dotted quad without leading zeros and with optional prefix /0-32.
+    // IPv6 has 8 groups or "::", optionally ends with embedded IPv4, prefix /0-128 or zone "%eth0" of link-local address.
+    // Domain has at least two labels starting with letter and TLD of 2-63 letters, "localhost" is a domain too
+    AddressInfo classifyAddress(std::string_view input);
+
+    NetTypes::AddressType getAddressType(std::string_view input);
+}
+
+#endif // ADDRESS_CLASSIFY_HPP
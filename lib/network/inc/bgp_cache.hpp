@@ -0,0 +1,67 @@
+#ifndef BGP_CACHE_HPP
+#define BGP_CACHE_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bgp_parse.hpp"
+#include "bgp_trie.hpp"
+
+namespace NetUtils::BGP {
+    // Published tries are never modified, so readers use them without locks.
+    // New dump is parsed into another pair which replaces the old one atomically,
+    // old pair is freed when its last reader drops the pointer.
+    using TrieSnapshot = std::shared_ptr<const NetTypes::TriePair>;
+
+    // Parse dumps (or load their snapshot) and publish them as new version of cache.
+    // Nothing is done if dumps and updates files did not change since the last publication,
+    // new updates files appended to applied ones are applied to copy of published tries without rebuild.
+    // True if new version is published
+    bool parseDumpsToCache(const std::vector<std::string>& patterns);
+
+    // Current version of tries, nullptr if nothing is published yet (never blocks)
+    TrieSnapshot getTrieFromCache();
+
+    // Current version of tries, dumps are parsed first if cache is still empty
+    TrieSnapshot loadTrieToCache(const std::vector<std::string>& patterns);
+
+    // Count of published versions, 0 while cache is empty
+    uint64_t getTrieCacheVersion();
+
+    // Counters of updates applied by the last publication: all updates files after rebuild from dumps,
+    // only new ones if they were appended to already applied files
+    UpdateStats getTrieCacheUpdateStats();
+
+    // Background thread which periodically checks dumps and publishes new version of cache if they changed
+    class TrieCacheRefresher {
+    public:
+        TrieCacheRefresher() = default;
+        ~TrieCacheRefresher();
+
+        TrieCacheRefresher(const TrieCacheRefresher&) = delete;
+        TrieCacheRefresher& operator=(const TrieCacheRefresher&) = delete;
+
+        void start(const std::vector<std::string>& patterns, std::chrono::seconds interval);
+
+        void stop();
+
+    private:
+        std::vector<std::string> m_patterns;
+        std::chrono::seconds m_interval{0};
+
+        std::thread m_thread;
+        std::mutex m_mtx;
+        std::condition_variable m_cv;
+        bool m_isRunning = false;
+
+        void run();
+    };
+} // namespace NetUtils
+
+#endif // BGP_CACHE_HPP
@@ -0,0 +1,54 @@
+#ifndef BGP_DIR24_8_HPP
+#define BGP_DIR24_8_HPP
+
+#include <optional>
+#include <vector>
+
+#include "net_types_base.hpp"
+#include "trie_key.hpp"
+
+namespace NetTypes {
+    template <size_t BITS>
+    class BGPTrie;
+
+    // Compiled IPv4 LPM table (DIR-24-8): first level is indexed by 24 upper bits of address,
+    // prefixes longer than /24 are placed to 256-entry overflow chunks.
+    // Lookup costs one or two memory accesses. Table is read-only after build.
+    class Dir24_8Table {
+    public:
+        static constexpr unsigned kFirstLevelBits = 24u;
+        static constexpr size_t kFirstLevelSize = 1u << kFirstLevelBits;
+        static constexpr size_t kChunkSize = 1u << (IPV4_BITS_COUNT - kFirstLevelBits);
+
+        // Build table from all routes of trie
+        explicit Dir24_8Table(const BGPTrie<IPV4_BITS_COUNT>& trie);
+
+        Dir24_8Table(const Dir24_8Table&) = delete;
+        Dir24_8Table& operator=(const Dir24_8Table&) = delete;
+
+        // Longest Prefix Match
+        [[nodiscard]]
+        std::optional<IPv4Subnet> lookup(const addrIPv4 ip) const;
+
+        void lookupBatch(const std::vector<addrIPv4>& ips, std::vector<std::optional<IPv4Subnet>>& results) const;
+
+        [[nodiscard]]
+        size_t getAllocatedBytes() const;
+
+    private:
+        // Entry: 0 - no route, (route index + 1) - route, kChunkFlag | chunk - overflow chunk
+        using Entry = uint32_t;
+        static constexpr Entry kChunkFlag = 1u << 31;
+
+        struct Route {
+            uint32_t key;
+            uint8_t len;
+        };
+
+        std::vector<Entry> m_firstLevel;
+        std::vector<Entry> m_chunks;
+        std::vector<Route> m_routes;
+    };
+}
+
+#endif // BGP_DIR24_8_HPP
@@ -1,15 +1,53 @@
 #ifndef BGP_PARSE_HPP
 #define BGP_PARSE_HPP
 
+#include <filesystem>
+#include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "bgp_trie.hpp"
+#include "mrt_reader.hpp"
+
+namespace fs = std::filesystem;
 
 namespace NetUtils::BGP {
-    void parseDump(const std::string& path, NetTypes::TriePair& outPair);
-    void parseDumpToCache(const std::string& path);
+    // Peers (AS and IP) announcing every route, collected from RIB entries of dumps and kept between
+    // applications of updates files. Peers are stored by index in table of known peers
+    struct RoutePeers {
+        std::vector<MRT::Peer> peers;
+        std::map<MRT::Peer, uint32_t> peerIndexes;
+
+        // Sorted indexes of peers of route
+        std::map<std::pair<NetTypes::TrieKey<IPV4_BITS_COUNT>, uint8_t>, std::vector<uint32_t>> v4;
+        std::map<std::pair<NetTypes::TrieKey<IPV6_BITS_COUNT>, uint8_t>, std::vector<uint32_t>> v6;
+
+        // Index of peer, unknown peer is added to table
+        uint32_t getPeerIndex(const MRT::Peer& peer);
+    };
+
+    // Peers of routes are collected to outPeers in the same pass if it is set
+    void parseDump(const std::string& path, NetTypes::TriePair& outPair, RoutePeers* outPeers = nullptr);
+
+    // Parse several dumps on all cores (plain dumps are also split to parts), routes are merged to outPair
+    void parseDumps(const std::vector<fs::path>& paths, NetTypes::TriePair& outPair, RoutePeers* outPeers = nullptr);
+
+    struct UpdateStats {
+        size_t messagesCount = 0;
+        size_t announcedCount = 0;
+        size_t withdrawnCount = 0;
+        size_t removedCount = 0;    // Routes without announcements after withdrawals
+    };
+
+    // Apply BGP4MP UPDATE messages (MRT updates files, in given order) on top of already loaded tries.
+    // Route exists while it has peers: repeated announcement of peer replaces its route, withdrawal of peer
+    // which does not announce route is ignored, route is removed when all its peers withdraw it.
+    // Refs of routes are not changed. Compiled lookup tables are not refreshed
+    UpdateStats applyUpdates(const std::vector<fs::path>& paths, NetTypes::TriePair& pair, RoutePeers& peers);
 
-    NetTypes::TriePair* getTrieFromCache();
+    // Resolve glob patterns to sorted list of existing dumps
+    std::vector<fs::path> expandDumpPaths(const std::vector<std::string>& patterns);
 } // namespace NetUtils
 
-#endif // BGP_PARSE_HPP
\ No newline at end of file
+#endif // BGP_PARSE_HPP
@@ -0,0 +1,114 @@
+#ifndef BGP_PATRICIA_TRIE_HPP
+#define BGP_PATRICIA_TRIE_HPP
+
+#include <array>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "net_types_base.hpp"
+#include "trie_arena.hpp"
+#include "trie_key.hpp"
+#include "trie_stats.hpp"
+
+namespace NetTypes {
+    // Path-compressed (Patricia) variant of BGPRadixTrie.
+    // Every node stores its whole key segment and prefix length,
+    // so only branching nodes and nodes with routes are allocated.
+    template <size_t BITS>
+    class BGPPatriciaTrie {
+        using Key    = TrieKey<BITS>;
+        using IPvxT  = IPvx<Key>;
+
+        // Node: key segment + skip count (len) on the edge from parent
+        struct Node {
+            Key key{};
+            std::array<TrieIndex, 2> child{kTrieNullIndex, kTrieNullIndex};
+            TrieIndex route = kTrieNoRoute;
+            uint8_t len = 0;
+        };
+
+        struct Route {
+            Key key{};
+            uint32_t refs = 0;
+        };
+
+    public:
+        BGPPatriciaTrie();
+        ~BGPPatriciaTrie() = default;
+
+        // ========= Copy ctor is blocked
+        BGPPatriciaTrie(const BGPPatriciaTrie&) = delete;
+        BGPPatriciaTrie& operator=(const BGPPatriciaTrie&) = delete;
+        // =========
+
+        BGPPatriciaTrie(BGPPatriciaTrie&&) = delete;
+        BGPPatriciaTrie& operator=(BGPPatriciaTrie&&) = delete;
+
+        // Insert Subnet, refs is a count of announcements (peers) of route
+        void insert(const IPvxT& subnet, uint32_t refs = 1);
+
+        // Drop refs announcements of subnet, route is deleted when none are left.
+        // True if route was deleted
+        bool withdraw(const IPvxT& subnet, uint32_t refs = 1);
+
+        // Delete route regardless of count of announcements, true if it existed
+        bool remove(const IPvxT& subnet);
+
+        // Count of announcements of exactly this route, 0 if it is not stored
+        [[nodiscard]]
+        uint32_t getRefs(const IPvxT& subnet) const;
+
+        [[nodiscard]]
+        bool isEmpty() const;
+
+        // Longest Prefix Match
+        [[nodiscard]]
+        std::optional<IPvxT> lookup(const Key ip) const;
+
+        // Longest Prefix Match for many addresses, lookups are interleaved to overlap cache misses
+        void lookupBatch(const std::vector<Key>& ips, std::vector<std::optional<IPvxT>>& results) const;
+
+        // Bytes allocated by nodes and routes storage
+        [[nodiscard]]
+        size_t getAllocatedBytes() const;
+
+        // Counts of nodes and routes, depth of routes and average depth of lookups for sampled route addresses
+        [[nodiscard]]
+        TrieStats getStats(size_t samplesCount = TRIE_STATS_SAMPLES_COUNT) const;
+
+        // Visit every stored route (order is not specified)
+        void forEachRoute(const std::function<void(const IPvxT&)>& callback) const;
+
+        void forEachRouteWithRefs(const std::function<void(const IPvxT&, uint32_t refs)>& callback) const;
+
+        // Raw storage of nodes and routes (for snapshot)
+        [[nodiscard]]
+        std::array<TrieArenaView, 2> getStorageViews() const { return {m_nodes.getView(), m_routes.getView()}; }
+
+        // Use external memory (mapped snapshot) as storage, false if it does not fit this trie
+        bool attachStorage(const std::array<TrieArenaView, 2>& views);
+
+        // Replace routes with own copy of another trie
+        void copyFrom(const BGPPatriciaTrie& other) {
+            m_nodes.copyFrom(other.m_nodes);
+            m_routes.copyFrom(other.m_routes);
+        }
+
+    private:
+        // Index 0 is a root with zero length prefix
+        TrieArena<Node> m_nodes;
+
+        // Route value (IP of inserted subnet) and count of its announcements, length of prefix is stored in node
+        TrieArena<Route> m_routes;
+
+        TrieIndex createNode(Key key, unsigned len);
+
+        void setRoute(TrieIndex index, Key key, uint32_t refs);
+
+        // Count of nodes read by lookup of key
+        unsigned getLookupDepth(Key key) const;
+    };
+}
+
+#endif // BGP_PATRICIA_TRIE_HPP
@@ -0,0 +1,41 @@
+#ifndef BGP_SNAPSHOT_HPP
+#define BGP_SNAPSHOT_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "bgp_parse.hpp"
+#include "bgp_trie.hpp"
+
+namespace fs = std::filesystem;
+
+namespace NetUtils::BGP {
+    // Identity of dump files, snapshot can be used only for the same dumps
+    struct DumpFingerprint {
+        uint64_t size = 0;          // Total size of files
+        int64_t mtime = 0;          // Latest modification time
+        uint64_t sampleHash = 0;    // Hash of begin, middle and end parts of every file
+
+        bool operator==(const DumpFingerprint& other) const {
+            return size == other.size && mtime == other.mtime && sampleHash == other.sampleHash;
+        }
+    };
+
+    DumpFingerprint getDumpFingerprint(const std::vector<fs::path>& dumpPaths);
+
+    // Path of snapshot for dumps inside of dir (name depends on dump paths and trie type)
+    fs::path getSnapshotPath(const fs::path& dir, const std::vector<fs::path>& dumpPaths, BGPTrieType type);
+
+    // Save nodes and routes of tries in native layout, file is replaced atomically.
+    // Peers of routes are saved too if they are set
+    void writeSnapshot(const fs::path& path, const NetTypes::TriePair& pair, const DumpFingerprint& fingerprint,
+                       const RoutePeers* peers = nullptr);
+
+    // Map snapshot and use it as storage of empty tries without deserialization, peers of routes are read to outPeers if it is set.
+    // False if snapshot is absent, broken, made for another dump or trie type or has no peers which are requested
+    bool loadSnapshot(const fs::path& path, NetTypes::TriePair& outPair, const DumpFingerprint& fingerprint,
+                      RoutePeers* outPeers = nullptr);
+} // namespace NetUtils
+
+#endif // BGP_SNAPSHOT_HPP
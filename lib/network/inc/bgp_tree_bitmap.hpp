@@ -0,0 +1,68 @@
+#ifndef BGP_TREE_BITMAP_HPP
+#define BGP_TREE_BITMAP_HPP
+
+#include <array>
+#include <optional>
+#include <vector>
+
+#include "net_types_base.hpp"
+#include "trie_key.hpp"
+
+namespace NetTypes {
+    template <size_t BITS>
+    class BGPTrie;
+
+    // Compiled IPv6 LPM structure (Tree Bitmap with 8-bit stride).
+    // Every node covers 8 bits of address: internal bitmap marks prefixes ending inside of node,
+    // external bitmap marks existing children. Children and results of node are stored contiguously
+    // and addressed by popcount of bitmap, so lookup visits at most 17 nodes instead of 128.
+    class IPv6TreeBitmap {
+    public:
+        static constexpr unsigned kStride = 8u;
+        static constexpr unsigned kMaxDepth = IPV6_BITS_COUNT / kStride;
+
+        // Build structure from all routes of trie
+        explicit IPv6TreeBitmap(const BGPTrie<IPV6_BITS_COUNT>& trie);
+
+        IPv6TreeBitmap(const IPv6TreeBitmap&) = delete;
+        IPv6TreeBitmap& operator=(const IPv6TreeBitmap&) = delete;
+
+        // Longest Prefix Match
+        [[nodiscard]]
+        std::optional<IPv6Subnet> lookup(const addrIPv6 ip) const;
+
+        void lookupBatch(const std::vector<addrIPv6>& ips, std::vector<std::optional<IPv6Subnet>>& results) const;
+
+        [[nodiscard]]
+        size_t getAllocatedBytes() const;
+
+        [[nodiscard]]
+        size_t getNodesCount() const { return m_nodes.size(); }
+
+    private:
+        // 256 bits bitmap
+        using Bitmap = std::array<uint64_t, 4>;
+
+        struct Node {
+            // Prefix of local length l (0..7) with value v has position (2^l - 1 + v)
+            Bitmap internal{};
+            // Child for every value of 8-bit chunk
+            Bitmap external{};
+            uint32_t childBase = 0;
+            uint32_t resultBase = 0;
+        };
+
+        struct Route {
+            uint128 key;
+            uint8_t len;
+        };
+
+        std::vector<Node> m_nodes;
+        std::vector<uint32_t> m_results;
+        std::vector<Route> m_routes;
+
+        void buildNode(uint32_t index, unsigned depth, const std::vector<uint32_t>& routes);
+    };
+}
+
+#endif // BGP_TREE_BITMAP_HPP
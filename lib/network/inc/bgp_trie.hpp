@@ -1,23 +1,42 @@
 #ifndef BGP_TRIE_HPP
 #define BGP_TRIE_HPP
 
-#include <bitset>
+#include <array>
+#include <functional>
+#include <memory>
 #include <optional>
+#include <vector>
 
+#include "fs_utils_mmap.hpp"
 #include "net_types_base.hpp"
+#include "trie_arena.hpp"
+#include "trie_key.hpp"
+#include "trie_stats.hpp"
+#include "bgp_patricia_trie.hpp"
+#include "bgp_dir24_8.hpp"
+#include "bgp_tree_bitmap.hpp"
+#include "libnetwork_settings.hpp"
 
 namespace NetTypes {
     template <size_t BITS>
     class BGPRadixTrie {
-        using Bitset = std::bitset<BITS>;
-        using IPvxT  = IPvx<Bitset>;
+        using Key    = TrieKey<BITS>;
+        using IPvxT  = IPvx<Key>;
 
-        // Forward declaration
-        struct Node;
+        // One node per bit of prefix, children are linked by index in arena
+        struct Node {
+            std::array<TrieIndex, 2> child{kTrieNullIndex, kTrieNullIndex};
+            TrieIndex route = kTrieNoRoute;
+        };
+
+        struct Route {
+            Key key{};
+            uint32_t refs = 0;
+        };
 
     public:
         BGPRadixTrie();
-        ~BGPRadixTrie();
+        ~BGPRadixTrie() = default;
 
         // ========= Copy ctor is blocked
         BGPRadixTrie(const BGPRadixTrie&) = delete;
@@ -27,31 +46,143 @@ namespace NetTypes {
         BGPRadixTrie(BGPRadixTrie&&) = delete;
         BGPRadixTrie& operator=(BGPRadixTrie&&) = delete;
 
-        // Insert Subnet
-        void insert(const IPvxT& subnet);
+        // Insert Subnet, refs is a count of announcements (peers) of route
+        void insert(const IPvxT& subnet, uint32_t refs = 1);
+
+        // Drop refs announcements of subnet, route is deleted when none are left.
+        // True if route was deleted
+        bool withdraw(const IPvxT& subnet, uint32_t refs = 1);
+
+        // Delete route regardless of count of announcements, true if it existed
+        bool remove(const IPvxT& subnet);
+
+        // Count of announcements of exactly this route, 0 if it is not stored
+        [[nodiscard]]
+        uint32_t getRefs(const IPvxT& subnet) const;
 
         [[nodiscard]]
         bool isEmpty() const;
 
         // Longest Prefix Match
         [[nodiscard]]
-        std::optional<IPvxT> lookup(const Bitset& ip) const;
+        std::optional<IPvxT> lookup(const Key ip) const;
+
+        // Longest Prefix Match for many addresses, lookups are interleaved to overlap cache misses
+        void lookupBatch(const std::vector<Key>& ips, std::vector<std::optional<IPvxT>>& results) const;
+
+        // Bytes allocated by nodes and routes storage
+        [[nodiscard]]
+        size_t getAllocatedBytes() const;
+
+        // Counts of nodes and routes, depth of routes and average depth of lookups for sampled route addresses
+        [[nodiscard]]
+        TrieStats getStats(size_t samplesCount = TRIE_STATS_SAMPLES_COUNT) const;
+
+        // Visit every stored route (order is not specified)
+        void forEachRoute(const std::function<void(const IPvxT&)>& callback) const;
+
+        void forEachRouteWithRefs(const std::function<void(const IPvxT&, uint32_t refs)>& callback) const;
+
+        // Raw storage of nodes and routes (for snapshot)
+        [[nodiscard]]
+        std::array<TrieArenaView, 2> getStorageViews() const { return {m_nodes.getView(), m_routes.getView()}; }
+
+        // Use external memory (mapped snapshot) as storage, false if it does not fit this trie
+        bool attachStorage(const std::array<TrieArenaView, 2>& views);
+
+        // Replace routes with own copy of another trie
+        void copyFrom(const BGPRadixTrie& other) {
+            m_nodes.copyFrom(other.m_nodes);
+            m_routes.copyFrom(other.m_routes);
+        }
 
     private:
-        Node* root = nullptr;
+        // Root is always placed at index 0
+        TrieArena<Node> m_nodes;
 
-        // UTILS
-        static int getMaskLength(const Bitset& mask);
+        // Route value (IP of inserted subnet) and count of its announcements, length of prefix is depth of node
+        TrieArena<Route> m_routes;
+
+        // Count of nodes read by lookup of key
+        unsigned getLookupDepth(Key key) const;
     };
 
-    using IPv4Trie = BGPRadixTrie<IPV4_BITS_COUNT>;
-    using IPv6Trie = BGPRadixTrie<IPV6_BITS_COUNT>;
+    // Trie with implementation selected in runtime (BGPTrieType)
+    template <size_t BITS>
+    class BGPTrie {
+        using Key    = TrieKey<BITS>;
+        using IPvxT  = IPvx<Key>;
+
+    public:
+        explicit BGPTrie(BGPTrieType type);
+
+        BGPTrie(const BGPTrie&) = delete;
+        BGPTrie& operator=(const BGPTrie&) = delete;
+        BGPTrie(BGPTrie&&) = delete;
+        BGPTrie& operator=(BGPTrie&&) = delete;
+
+        void insert(const IPvxT& subnet, uint32_t refs = 1);
+
+        bool withdraw(const IPvxT& subnet, uint32_t refs = 1);
+
+        bool remove(const IPvxT& subnet);
+
+        [[nodiscard]]
+        uint32_t getRefs(const IPvxT& subnet) const;
+
+        [[nodiscard]]
+        bool isEmpty() const;
+
+        [[nodiscard]]
+        std::optional<IPvxT> lookup(const Key ip) const;
+
+        void lookupBatch(const std::vector<Key>& ips, std::vector<std::optional<IPvxT>>& results) const;
+
+        [[nodiscard]]
+        size_t getAllocatedBytes() const;
+
+        [[nodiscard]]
+        TrieStats getStats(size_t samplesCount = TRIE_STATS_SAMPLES_COUNT) const;
+
+        void forEachRoute(const std::function<void(const IPvxT&)>& callback) const;
+
+        void forEachRouteWithRefs(const std::function<void(const IPvxT&, uint32_t refs)>& callback) const;
+
+        [[nodiscard]]
+        std::array<TrieArenaView, 2> getStorageViews() const;
+
+        bool attachStorage(const std::array<TrieArenaView, 2>& views);
+
+        // Replace routes with own copy of another trie of the same type
+        void copyFrom(const BGPTrie& other);
+
+        [[nodiscard]]
+        BGPTrieType getType() const { return m_type; }
+
+    private:
+        BGPTrieType m_type;
+
+        std::unique_ptr<BGPRadixTrie<BITS>> m_radix;
+        std::unique_ptr<BGPPatriciaTrie<BITS>> m_patricia;
+    };
+
+    using IPv4Trie = BGPTrie<IPV4_BITS_COUNT>;
+    using IPv6Trie = BGPTrie<IPV6_BITS_COUNT>;
 
     struct TriePair {
         IPv4Trie v4;
         IPv6Trie v6;
 
-        TriePair() = default;
+        // Optional compiled structures, built from tries after dump is loaded
+        std::unique_ptr<Dir24_8Table> v4Compiled;
+        std::unique_ptr<IPv6TreeBitmap> v6Compiled;
+
+        // Mapped snapshot used as storage of tries (if pair was loaded from it)
+        std::unique_ptr<FS::Utils::MappedFile> snapshot;
+
+        // Type of tries is taken from gLibNetworkSettings
+        TriePair();
+        explicit TriePair(BGPTrieType type);
 
         TriePair(const TriePair&) = delete;
         TriePair& operator=(const TriePair&) = delete;
@@ -60,6 +191,30 @@ namespace NetTypes {
 
         [[nodiscard]]
         bool isEmpty() const;
+
+        [[nodiscard]]
+        size_t getAllocatedBytes() const;
+
+        // Statistics of both tries and memory of compiled structures
+        [[nodiscard]]
+        TriePairStats getStats(size_t samplesCount = TRIE_STATS_SAMPLES_COUNT) const;
+
+        // Own copy of tries of another pair (compiled structures are not copied, they must be compiled again)
+        void copyTriesFrom(const TriePair& other);
+
+        // Build compiled lookup structures requested in gLibNetworkSettings
+        void compileLookupTables();
+
+        // Longest Prefix Match using compiled structure if it exists
+        [[nodiscard]]
+        std::optional<IPv4Subnet> lookup(const addrIPv4 ip) const;
+
+        [[nodiscard]]
+        std::optional<IPv6Subnet> lookup(const addrIPv6 ip) const;
+
+        void lookupBatch(const std::vector<addrIPv4>& ips, std::vector<std::optional<IPv4Subnet>>& results) const;
+
+        void lookupBatch(const std::vector<addrIPv6>& ips, std::vector<std::optional<IPv6Subnet>>& results) const;
     };
 }
 
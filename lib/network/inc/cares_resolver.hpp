@@ -2,6 +2,8 @@
 #define CARES_RESOLVER_HPP
 
 #include <future>
+#include <mutex>
+#include <unordered_map>
 #include <ares.h>
 #include <vector>
 
@@ -15,6 +17,9 @@
 // ====================
 
 namespace NetUtils {
+    // IPs of every resolved host (empty if host is not resolved)
+    using ResolvedHosts = std::unordered_map<std::string, NetTypes::ListAddress>;
+
     class CAresResolver {
     public:
         struct ResolveQueryData {
@@ -37,12 +42,18 @@ namespace NetUtils {
             return m_initialized;
         }
 
+        // Channel is shared, so concurrent callers of one resolver are served one after another.
+        // Threads which resolve in parallel should use own resolvers
         bool resolveDomains(const NetTypes::ListAddress& hosts, NetTypes::ListAddress& uniqueIPs);
 
+        // Same as resolveDomains, but IPs are kept for every host separately
+        bool resolveHosts(const NetTypes::ListAddress& hosts, ResolvedHosts& resolved);
+
     private:
         ares_channel m_channel{};
         int m_timeoutMs;
         bool m_initialized;
+        std::mutex m_mtx;
 
         static void resolveCallback(void *arg, int status, int, struct ares_addrinfo *res);
 
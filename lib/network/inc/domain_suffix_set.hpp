@@ -0,0 +1,53 @@
+#ifndef DOMAIN_SUFFIX_SET_HPP
+#define DOMAIN_SUFFIX_SET_HPP
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+#include "net_types_base.hpp"
+
+namespace NetTypes {
+    // Set of domains, every domain also covers all of its subdomains:
+    // "example.ru" matches "example.ru" and "a.b.example.ru", but not "badexample.ru".
+    // Check costs one hash lookup per label of checked domain, no DNS is needed
+    class DomainSuffixSet {
+    public:
+        DomainSuffixSet() = default;
+
+        explicit DomainSuffixSet(const ListAddress& domains);
+
+        DomainSuffixSet(const DomainSuffixSet&) = delete;
+        DomainSuffixSet& operator=(const DomainSuffixSet&) = delete;
+
+        DomainSuffixSet(DomainSuffixSet&&) = default;
+        DomainSuffixSet& operator=(DomainSuffixSet&&) = default;
+
+        // Leading "*." or "." and trailing dot are ignored, case is ignored
+        void insert(std::string_view domain);
+
+        // True if domain or one of its parent domains is in set
+        [[nodiscard]]
+        bool isMatches(std::string_view domain) const;
+
+        // Normalized domains in order of insertion
+        [[nodiscard]]
+        const std::deque<std::string>& getDomains() const { return m_storage; }
+
+        [[nodiscard]]
+        size_t size() const { return m_suffixes.size(); }
+
+        [[nodiscard]]
+        bool isEmpty() const { return m_suffixes.empty(); }
+
+    private:
+        // Views point to strings of storage, deque does not move them on insert
+        std::deque<std::string> m_storage;
+        std::unordered_set<std::string_view> m_suffixes;
+
+        static std::string normalize(std::string_view domain);
+    };
+}
+
+#endif // DOMAIN_SUFFIX_SET_HPP
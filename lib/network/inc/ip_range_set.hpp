@@ -0,0 +1,83 @@
+#ifndef IP_RANGE_SET_HPP
+#define IP_RANGE_SET_HPP
+
+#include <vector>
+
+#include "net_types_base.hpp"
+
+namespace NetTypes {
+    // Closed range of addresses [first, last]
+    template <typename T>
+    struct IPRange {
+        T first = 0;
+        T last = 0;
+
+        bool operator==(const IPRange& other) const {
+            return first == other.first && last == other.last;
+        }
+    };
+
+    // Set of addresses compiled from subnets into sorted, merged and non-overlapping ranges.
+    // Set is read-only after build, every check is a binary search over ranges: O(log M)
+    template <typename T>
+    class IPRangeSet {
+    public:
+        using IPvxT = IPvx<T>;
+        using Range = IPRange<T>;
+
+        IPRangeSet() = default;
+
+        // Corrupted subnets (see IPvx::isCorrupted) are skipped
+        explicit IPRangeSet(const ListIPvx<T>& subnets);
+
+        // Ranges may be unsorted and may overlap (e.g. loaded from file)
+        explicit IPRangeSet(std::vector<Range> ranges);
+
+        // First and last address of subnet
+        static Range toRange(const IPvxT& subnet);
+
+        // True if at least one address of subnet is in set
+        [[nodiscard]]
+        bool isOverlaps(const IPvxT& subnet) const;
+
+        // True if all addresses of subnet are in set
+        [[nodiscard]]
+        bool isIncludes(const IPvxT& subnet) const;
+
+        // Minimal list of subnets covering exactly the same addresses (sorted by address)
+        [[nodiscard]]
+        std::vector<IPvxT> toSubnets() const;
+
+        // Minimal list of subnets covering addresses of subnet which are not in set (sorted by address)
+        [[nodiscard]]
+        std::vector<IPvxT> subtract(const IPvxT& subnet) const;
+
+        [[nodiscard]]
+        bool isEmpty() const { return m_ranges.empty(); }
+
+        [[nodiscard]]
+        const std::vector<Range>& getRanges() const { return m_ranges; }
+
+    private:
+        std::vector<Range> m_ranges;
+
+        // First range which ends at addr or later
+        typename std::vector<Range>::const_iterator findRange(T addr) const;
+
+        // Sort and merge overlapping and adjacent ranges
+        void normalize();
+
+        // Split range into aligned subnets
+        static void appendSubnets(const Range& range, std::vector<IPvxT>& subnets);
+    };
+
+    using IPv4RangeSet = IPRangeSet<addrIPv4>;
+    using IPv6RangeSet = IPRangeSet<addrIPv6>;
+
+    struct IPRangeSetPair {
+        IPv4RangeSet v4;
+        IPv6RangeSet v6;
+    };
+}
+
+#endif // IP_RANGE_SET_HPP
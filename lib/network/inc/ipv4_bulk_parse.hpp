@@ -0,0 +1,23 @@
+#ifndef IPV4_BULK_PARSE_HPP
+#define IPV4_BULK_PARSE_HPP
+
+#include <string_view>
+#include <vector>
+
+#include "net_types_base.hpp"
+
+namespace NetUtils::Convert {
+    // Parse whole buffer with one entry per line ('\n' or "\r\n").
+    // Lines which are IPv4 with optional prefix (same rules as classifyAddress) are appended to subnets:
+    // prefix of mask-less IP is 0, "/0" is read as /32 like in parseIPv4.
+    // Other non-empty lines are appended to otherLines, views point into buffer.
+    // Implementation is selected by gLibNetworkSettings.ipv4BulkParseType and CPU features
+    void parseIPv4Bulk(std::string_view buffer,
+        std::vector<NetTypes::IPv4Subnet>& subnets,
+        std::vector<std::string_view>& otherLines);
+
+    // Name of implementation used by parseIPv4Bulk: "avx2", "sse4.1" or "scalar"
+    const char* getIPv4BulkParserName();
+}
+
+#endif // IPV4_BULK_PARSE_HPP
@@ -2,6 +2,39 @@
 #define LIBNETWORK_SETTINGS
 
 #include <string>
+#include <vector>
+
+/**
+ * @brief Implementation of trie used for storing BGP dump.
+ */
+enum class BGPTrieType {
+    RADIX,      // One node per bit of prefix
+    PATRICIA    // Path-compressed, nodes only for branches and routes
+};
+
+/**
+ * @brief Structure used for IPv4 lookups in BGP dump.
+ */
+enum class IPv4LookupType {
+    TRIE,       // Lookup directly in trie (BGPTrieType)
+    DIR_24_8    // Compiled DIR-24-8 table built once after dump is loaded (~64 MiB)
+};
+
+/**
+ * @brief Structure used for IPv6 lookups in BGP dump.
+ */
+enum class IPv6LookupType {
+    TRIE,           // Lookup directly in trie (BGPTrieType)
+    TREE_BITMAP     // Compiled multibit Tree Bitmap (8-bit stride) built once after dump is loaded
+};
+
+/**
+ * @brief Implementation of bulk parser of IPv4 lists.
+ */
+enum class IPv4BulkParseType {
+    AUTO,       // Best one supported by CPU at runtime (AVX2, SSE4.1 or scalar)
+    SCALAR      // Portable parser without SIMD
+};
 
 /**
  * @brief Network library configuration structure.
@@ -11,8 +44,26 @@ struct LibNetworkSettings {
     /** @brief Whether to discover subnet using BGP data. */
     bool isSearchSubnetByBGP = false;
 
-    /** @brief Path to the BGP dump file (used when isSearchSubnetByBGP == true). */
-    std::string bgpDumpPath;
+    /** @brief Paths or glob patterns of BGP dump files (used when isSearchSubnetByBGP == true). */
+    std::vector<std::string> bgpDumpPaths;
+
+    /** @brief Paths or glob patterns of MRT updates files applied on top of BGP dumps (in sorted order). */
+    std::vector<std::string> bgpUpdatePaths;
+
+    /** @brief Threads used for parsing BGP dumps (0 - count of CPU cores). */
+    unsigned int bgpParseThreadsCount = 0u;
+
+    /** @brief Directory for mappable snapshots of parsed BGP dump (empty disables snapshots). */
+    std::string bgpSnapshotDir;
+
+    /** @brief Trie implementation used for BGP dump (can be switched for A/B comparison). */
+    BGPTrieType bgpTrieType = BGPTrieType::PATRICIA;
+
+    /** @brief Structure used for IPv4 longest prefix match in BGP dump. */
+    IPv4LookupType ipv4LookupType = IPv4LookupType::TRIE;
+
+    /** @brief Structure used for IPv6 longest prefix match in BGP dump. */
+    IPv6LookupType ipv6LookupType = IPv6LookupType::TRIE;
 
     /** @brief Limit of IP mask, which can be fixed using BGP dump */
     struct AutoFixMaskLimitByBGP {
@@ -22,6 +73,9 @@ struct LibNetworkSettings {
 
     AutoFixMaskLimitByBGP autoFixMaskLimitByBGP;
 
+    /** @brief Implementation of bulk parser of IPv4 lists (can be switched for A/B comparison). */
+    IPv4BulkParseType ipv4BulkParseType = IPv4BulkParseType::AUTO;
+
     /** @brief Maximum time (seconds) for the whole cURL operation to complete. */
     unsigned int curlOperationTimeoutSec = 10u;
 
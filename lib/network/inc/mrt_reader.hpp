@@ -0,0 +1,126 @@
+#ifndef MRT_READER_HPP
+#define MRT_READER_HPP
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "net_types_base.hpp"
+
+namespace fs = std::filesystem;
+
+// Reader of MRT routing dumps (RFC 6396) without external dependencies.
+// Records are read from mapped file directly, gzip and bzip2 dumps are
+// decompressed by blocks using libarchive.
+namespace NetUtils::MRT {
+    // Types of records (only used ones)
+    constexpr uint16_t kTypeTableDump       = 12u;
+    constexpr uint16_t kTypeTableDumpV2     = 13u;
+    constexpr uint16_t kTypeBGP4MP          = 16u;
+    constexpr uint16_t kTypeBGP4MP_ET       = 17u;
+
+    // Subtypes of TABLE_DUMP
+    constexpr uint16_t kTableDumpAfiIPv4    = 1u;
+    constexpr uint16_t kTableDumpAfiIPv6    = 2u;
+
+    // Subtypes of TABLE_DUMP_V2
+    constexpr uint16_t kPeerIndexTable              = 1u;
+    constexpr uint16_t kRibIPv4Unicast              = 2u;
+    constexpr uint16_t kRibIPv4Multicast            = 3u;
+    constexpr uint16_t kRibIPv6Unicast              = 4u;
+    constexpr uint16_t kRibIPv6Multicast            = 5u;
+    constexpr uint16_t kRibIPv4UnicastAddPath       = 8u;
+    constexpr uint16_t kRibIPv4MulticastAddPath     = 9u;
+    constexpr uint16_t kRibIPv6UnicastAddPath       = 10u;
+    constexpr uint16_t kRibIPv6MulticastAddPath     = 11u;
+
+    // Subtypes of BGP4MP with BGP message
+    constexpr uint16_t kBGP4MPMessage                   = 1u;
+    constexpr uint16_t kBGP4MPMessageAS4                = 4u;
+    constexpr uint16_t kBGP4MPMessageLocal              = 6u;
+    constexpr uint16_t kBGP4MPMessageAS4Local           = 7u;
+    constexpr uint16_t kBGP4MPMessageAddPath            = 8u;
+    constexpr uint16_t kBGP4MPMessageAS4AddPath         = 9u;
+    constexpr uint16_t kBGP4MPMessageLocalAddPath       = 10u;
+    constexpr uint16_t kBGP4MPMessageAS4LocalAddPath    = 11u;
+
+    constexpr size_t kRecordHeaderSize = 12u;
+
+    struct RecordHeader {
+        uint32_t timestamp;
+        uint16_t type;
+        uint16_t subtype;
+        uint32_t length; // Length of body (without common header)
+    };
+
+    // Body points to memory of reader, it is valid only inside of callback
+    using RecordCallback = std::function<void(const RecordHeader& header, const uint8_t* body)>;
+
+    inline uint16_t readBE16(const uint8_t* p) {
+        return static_cast<uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    inline uint32_t readBE32(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+    }
+
+    // Dump starts with gzip or bzip2 magic
+    bool isCompressed(const uint8_t* data, size_t size);
+
+    // Split plain dump at record boundaries into chunks of about chunkBytes, so they can be parsed independently.
+    // Returned offsets start with 0 and end with size of all complete records
+    std::vector<size_t> splitToChunks(const uint8_t* data, size_t size, size_t chunkBytes);
+
+    // Call callback for every complete record of buffer, count of consumed bytes is returned
+    size_t forEachRecord(const uint8_t* data, size_t size, const RecordCallback& callback);
+
+    // Call callback for every record of dump file (plain, gzip or bzip2).
+    // Throws std::ios_base::failure if file can not be read
+    void forEachRecord(const fs::path& path, const RecordCallback& callback);
+
+    // Prefix of route from TABLE_DUMP or TABLE_DUMP_V2 RIB record, nullopt for other records.
+    // outPeersCount receives count of RIB entries (peers announcing prefix)
+    std::optional<NetTypes::SubnetVariant> extractRibPrefix(const RecordHeader& header, const uint8_t* body,
+                                                            uint32_t* outPeersCount = nullptr);
+
+    // Peer of collector which sent BGP message
+    struct Peer {
+        uint32_t as = 0;
+        std::array<uint8_t, 16> ip{};   // IPv4 address takes first 4 bytes
+
+        bool operator<(const Peer& other) const {
+            return as != other.as ? as < other.as : ip < other.ip;
+        }
+
+        bool operator==(const Peer& other) const {
+            return as == other.as && ip == other.ip;
+        }
+    };
+
+    // Peers of PEER_INDEX_TABLE record (RIB entries of TABLE_DUMP_V2 refer to them by index), false for other records
+    bool extractPeerIndexTable(const RecordHeader& header, const uint8_t* body, std::vector<Peer>& outPeers);
+
+    // Prefix of TABLE_DUMP or TABLE_DUMP_V2 RIB record with peers of its entries, nullopt for other records.
+    // Indexes of TABLE_DUMP_V2 entries are resolved by peerTable, entries of unknown peers are skipped
+    std::optional<NetTypes::SubnetVariant> extractRibPeers(const RecordHeader& header, const uint8_t* body,
+                                                           const std::vector<Peer>& peerTable, std::vector<Peer>& outPeers);
+
+    // Prefixes of BGP UPDATE message (IPv4 NLRI and MP_REACH/MP_UNREACH attributes)
+    struct UpdatePrefixes {
+        Peer peer;
+        std::vector<NetTypes::SubnetVariant> announced;
+        std::vector<NetTypes::SubnetVariant> withdrawn;
+    };
+
+    // Fill peer and prefixes of BGP4MP UPDATE record, false for other records or broken message
+    bool extractUpdatePrefixes(const RecordHeader& header, const uint8_t* body, UpdatePrefixes& out);
+
+    // Prefix in NLRI encoding (length in bits + significant bytes), returns size of encoded prefix or 0 if it is broken
+    size_t decodePrefix(const uint8_t* data, size_t size, bool isIPv6, NetTypes::SubnetVariant& outSubnet);
+}
+
+#endif // MRT_READER_HPP
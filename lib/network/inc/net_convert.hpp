@@ -2,24 +2,44 @@
 #define NET_CONVERT_HPP
 
 #include <arpa/inet.h>
+#include <charconv>
+#include <string_view>
+#include <vector>
 
 #include "net_types_base.hpp"
 
 namespace NetUtils::Convert {
-    bool parseIPv4(const std::string& ip, NetTypes::IPv4Subnet& out);
+    // Parsing of address in [first, last) in style of std::from_chars: nothing is allocated and no exceptions are thrown.
+    // On success ptr points past the address, on failure ec is invalid_argument (or result_out_of_range for big octet or group).
+    // IPv4 is dotted quad without leading zeros, IPv6 may be compressed with "::" and may end with embedded IPv4
+    std::from_chars_result fromCharsIPv4(const char* first, const char* last, NetTypes::addrIPv4& out);
 
-    bool parseIPv6(const std::string& ip, NetTypes::IPv6Subnet& out);
+    std::from_chars_result fromCharsIPv6(const char* first, const char* last, NetTypes::addrIPv6& out);
 
-    NetTypes::bitsetIPv4 inetv4ToBitset(const in_addr& a);
+    // isFixByBGP = false leaves mask-less IP as a single host, so it can be fixed later with fixSubnetsByBGP
+    bool parseIPv4(std::string_view ip, NetTypes::IPv4Subnet& out, bool isFixByBGP = true);
 
-    NetTypes::bitsetIPv6 inetv6ToBitset(const in6_addr& a);
+    // Zone of link-local address ("fe80::1%eth0") is ignored
+    bool parseIPv6(std::string_view ip, NetTypes::IPv6Subnet& out, bool isFixByBGP = true);
 
-    NetTypes::bitsetIPv4 lengthv4ToBitset(int len);
+    // Replace masks of IPs with subnets from BGP dump using batched lookup.
+    // IPs without route or with too wide subnet are removed, count of removed IPs is returned
+    size_t fixSubnetsByBGP(std::vector<NetTypes::IPv4Subnet>& subnets);
 
-    NetTypes::bitsetIPv6 lengthv6ToBitset(int len);
+    size_t fixSubnetsByBGP(std::vector<NetTypes::IPv6Subnet>& subnets);
 
-    template <size_t N>
-    int bitsetToLength(const std::bitset<N>& bs);
+    // Same batched lookup, but IPs are kept in place: outIsFixed[i] is false if subnets[i] must be skipped
+    void fixSubnetsByBGP(std::vector<NetTypes::IPv4Subnet>& subnets, std::vector<bool>& outIsFixed);
+
+    void fixSubnetsByBGP(std::vector<NetTypes::IPv6Subnet>& subnets, std::vector<bool>& outIsFixed);
+
+    NetTypes::addrIPv4 inetv4ToAddr(const in_addr& a);
+
+    NetTypes::addrIPv6 inetv6ToAddr(const in6_addr& a);
+
+    NetTypes::addrIPv4 lengthv4ToMask(int len);
+
+    NetTypes::addrIPv6 lengthv6ToMask(int len);
 }
 
 #endif //NET_CONVERT_HPP
\ No newline at end of file
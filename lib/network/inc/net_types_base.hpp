@@ -3,7 +3,7 @@
 
 #include <variant>
 #include <string>
-#include <bitset>
+#include <cstdint>
 #include <forward_list>
 
 #define IPV4_BITS_COUNT         32u
@@ -12,23 +12,38 @@
 #define IPV6_HEX_GROUPS_COUNT   8u
 
 namespace NetTypes {
-    using bitsetIPv4 = std::bitset<IPV4_BITS_COUNT>;
-    using bitsetIPv6 = std::bitset<IPV6_BITS_COUNT>;
+    using uint128 = unsigned __int128;
+
+    // Addresses are stored as host-order integers, the most significant bit is the first bit of address
+    using addrIPv4 = uint32_t;
+    using addrIPv6 = uint128;
 
     template <typename T>
     class IPvx {
     public:
-        T ip;
-        T mask;
+        static constexpr unsigned kBitsCount = sizeof(T) * 8u;
+
+        T ip = 0;
+        uint8_t prefix = 0;     // Length of mask
+
+        // Mask of type 11..100..0 with len leading ones
+        static constexpr T lengthToMask(const unsigned len) {
+            return (len == 0) ? T(0) : static_cast<T>(~T(0) << (kBitsCount - len));
+        }
+
+        [[nodiscard]]
+        constexpr T mask() const {
+            return lengthToMask(prefix);
+        }
 
         [[nodiscard]]
         bool isCorrupted() const {
-            return ip.none() || mask.none();
+            return ip == 0 || prefix == 0;
         };
 
         bool isSubnetIncludes(const IPvx<T>& ipvx) const {
             const bool isAnyCorrupted = this->isCorrupted() || ipvx.isCorrupted();
-            const bool isEqual = (this->ip & this->mask) == (ipvx.ip & ipvx.mask);
+            const bool isEqual = (this->ip & this->mask()) == (ipvx.ip & ipvx.mask());
 
             return isEqual && !isAnyCorrupted;
         };
@@ -37,8 +52,8 @@ namespace NetTypes {
         std::string to_string() const;
     };
 
-    using IPv4Subnet = IPvx<bitsetIPv4>;
-    using IPv6Subnet = IPvx<bitsetIPv6>;
+    using IPv4Subnet = IPvx<addrIPv4>;
+    using IPv6Subnet = IPvx<addrIPv6>;
     using SubnetVariant = std::variant<IPv4Subnet, IPv6Subnet>;
 
     template <typename T>
@@ -0,0 +1,22 @@
+#ifndef RANGE_INDEX_HPP
+#define RANGE_INDEX_HPP
+
+#include <cstdint>
+#include <filesystem>
+
+#include "ip_range_set.hpp"
+#include "domain_suffix_set.hpp"
+
+namespace fs = std::filesystem;
+
+namespace NetUtils::RangeIndex {
+    // Save compiled ranges and domains of list with key of its source, file is replaced atomically
+    void write(const fs::path& path, const NetTypes::IPRangeSetPair& ranges, const NetTypes::DomainSuffixSet& domains,
+               uint64_t key, uint64_t createdAt);
+
+    // False if file is absent, broken or written for another key (outputs are not changed then)
+    bool read(const fs::path& path, uint64_t key, NetTypes::IPRangeSetPair& outRanges,
+              NetTypes::DomainSuffixSet& outDomains, uint64_t& outCreatedAt);
+} // namespace NetUtils
+
+#endif // RANGE_INDEX_HPP
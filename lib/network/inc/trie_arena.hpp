@@ -0,0 +1,150 @@
+#ifndef TRIE_ARENA_HPP
+#define TRIE_ARENA_HPP
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace NetTypes {
+    // Index of element inside of TrieArena
+    using TrieIndex = uint32_t;
+
+    // Index 0 is always taken by root, so it is used as "no child" marker
+    constexpr TrieIndex kTrieNullIndex = 0u;
+
+    // Marker of node without route
+    constexpr TrieIndex kTrieNoRoute = std::numeric_limits<TrieIndex>::max();
+
+    // Raw memory of one arena, used for writing and mapping snapshots
+    struct TrieArenaView {
+        const void* data = nullptr;
+        size_t count = 0;
+        size_t itemSize = 0;
+    };
+
+    // Contiguous pool of trivially destructible elements linked by 32-bit indices.
+    // Released elements are reset and reused by next allocations, memory is returned only with whole pool.
+    // Pool can be attached to external read-only memory (e.g. mapped snapshot),
+    // first modification copies it to own storage.
+    template <typename T>
+    class TrieArena {
+        static_assert(std::is_trivially_destructible_v<T>, "Arena elements must be trivially destructible");
+
+    public:
+        static constexpr size_t kInitialCapacity = 1024u;
+
+        TrieArena() {
+            m_items.reserve(kInitialCapacity);
+            syncData();
+        }
+
+        // Pointer to data is cached, so arena can not be copied or moved
+        TrieArena(const TrieArena&) = delete;
+        TrieArena& operator=(const TrieArena&) = delete;
+
+        TrieIndex allocate() {
+            detach();
+
+            if (!m_free.empty()) {
+                const TrieIndex index = m_free.back();
+                m_free.pop_back();
+
+                return index;
+            }
+
+            m_items.emplace_back();
+            syncData();
+
+            return static_cast<TrieIndex>(m_size - 1);
+        }
+
+        // Element is reset to default value, so it looks unused for linear walks
+        void release(const TrieIndex index) {
+            detach();
+            m_items[index] = T{};
+            m_free.push_back(index);
+        }
+
+        T& operator[](const TrieIndex index) {
+            detach();
+            return m_items[index];
+        }
+
+        const T& operator[](const TrieIndex index) const { return m_data[index]; }
+
+        [[nodiscard]]
+        size_t size() const { return m_size; }
+
+        // Count of elements in use (released ones are excluded)
+        [[nodiscard]]
+        size_t getUsedCount() const { return m_size - m_free.size(); }
+
+        // Mapped memory is not owned, so it is not counted
+        [[nodiscard]]
+        size_t getAllocatedBytes() const { return m_items.capacity() * sizeof(T) + m_free.capacity() * sizeof(TrieIndex); }
+
+        void reserve(const size_t count) {
+            detach();
+            m_items.reserve(count);
+            syncData();
+        }
+
+        [[nodiscard]]
+        TrieArenaView getView() const { return {m_data, m_size, sizeof(T)}; }
+
+        // External memory must outlive arena or next attach
+        bool attach(const TrieArenaView& view) {
+            static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable elements can be attached");
+
+            if (view.itemSize != sizeof(T) || (view.count != 0 && view.data == nullptr)) {
+                return false;
+            }
+
+            m_items.clear();
+            m_items.shrink_to_fit();
+            m_free.clear();
+
+            m_data = static_cast<const T*>(view.data);
+            m_size = view.count;
+            m_isAttached = true;
+
+            return true;
+        }
+
+        [[nodiscard]]
+        bool isAttached() const { return m_isAttached; }
+
+        // Replace elements with own copy of another arena (own or attached)
+        void copyFrom(const TrieArena& other) {
+            m_items.assign(other.m_data, other.m_data + other.m_size);
+            m_free = other.m_free;
+            m_isAttached = false;
+            syncData();
+        }
+
+    private:
+        std::vector<T> m_items;
+        std::vector<TrieIndex> m_free;
+
+        // Elements are read through these fields both in own and attached mode
+        const T* m_data = nullptr;
+        size_t m_size = 0;
+        bool m_isAttached = false;
+
+        void syncData() {
+            m_data = m_items.data();
+            m_size = m_items.size();
+        }
+
+        void detach() {
+            if (m_isAttached) {
+                m_items.assign(m_data, m_data + m_size);
+                m_isAttached = false;
+                syncData();
+            }
+        }
+    };
+}
+
+#endif // TRIE_ARENA_HPP
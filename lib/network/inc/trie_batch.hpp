@@ -0,0 +1,55 @@
+#ifndef TRIE_BATCH_HPP
+#define TRIE_BATCH_HPP
+
+#include <array>
+#include <cstddef>
+
+// Count of lookups advanced in lockstep
+#define TRIE_BATCH_WIDTH    16u
+
+namespace NetTypes {
+    // Prefetch memory of next node to hide cache miss behind steps of other lookups
+    template <typename T>
+    inline void prefetchNode(const T* ptr) {
+        __builtin_prefetch(ptr, 0, 1);
+    }
+
+    // Driver for interleaved traversal: up to TRIE_BATCH_WIDTH lookups (lanes) are advanced
+    // by one node per round, finished lane is refilled with next request.
+    //  start(lane, slot)  - prepare lane for request with index slot
+    //  step(lane) -> bool - move lane to next node, false if lookup is finished
+    //  finish(lane)       - save result of lane
+    template <typename Lane, typename StartFn, typename StepFn, typename FinishFn>
+    void runInterleavedLookups(const size_t count, StartFn&& start, StepFn&& step, FinishFn&& finish) {
+        std::array<Lane, TRIE_BATCH_WIDTH> lanes{};
+        size_t active = 0;
+        size_t next = 0;
+
+        while (active < lanes.size() && next < count) {
+            start(lanes[active++], next++);
+        }
+
+        while (active != 0) {
+            for (size_t i = 0; i < active;) {
+                Lane& lane = lanes[i];
+
+                if (step(lane)) {
+                    ++i;
+                    continue;
+                }
+
+                finish(lane);
+
+                if (next < count) {
+                    start(lane, next++);
+                    ++i;
+                } else {
+                    // Last active lane takes place of finished one
+                    lane = lanes[--active];
+                }
+            }
+        }
+    }
+}
+
+#endif // TRIE_BATCH_HPP
@@ -0,0 +1,50 @@
+#ifndef TRIE_KEY_HPP
+#define TRIE_KEY_HPP
+
+#include <cstdint>
+#include <type_traits>
+
+#include "net_types_base.hpp"
+
+namespace NetTypes {
+    // Integer representation of an address used inside of tries (same as IPvx address)
+    template <size_t BITS>
+    using TrieKey = std::conditional_t<BITS == IPV4_BITS_COUNT, addrIPv4, addrIPv6>;
+
+    // ──────────────────────────────────────────────────────────────
+    // Bit utils (bit position 0 is the most significant bit)
+    // ──────────────────────────────────────────────────────────────
+    template <size_t BITS>
+    constexpr TrieKey<BITS> keyMask(const unsigned len) {
+        using Key = TrieKey<BITS>;
+        return (len == 0) ? Key(0) : static_cast<Key>(~Key(0) << (BITS - len));
+    }
+
+    template <size_t BITS>
+    constexpr int keyBit(const TrieKey<BITS> key, const unsigned pos) {
+        return static_cast<int>((key >> (BITS - 1 - pos)) & 1u);
+    }
+
+    // Count of leading zero bits, BITS for zero key
+    template <size_t BITS>
+    constexpr unsigned keyLeadingZeros(const TrieKey<BITS> key) {
+        if constexpr (BITS == IPV4_BITS_COUNT) {
+            return key ? __builtin_clz(key) : BITS;
+        } else {
+            const auto hi = static_cast<uint64_t>(key >> 64);
+            const auto lo = static_cast<uint64_t>(key);
+
+            if (hi) return __builtin_clzll(hi);
+            if (lo) return 64 + __builtin_clzll(lo);
+            return BITS;
+        }
+    }
+
+    // Length of common prefix of two keys
+    template <size_t BITS>
+    constexpr unsigned keyCommonPrefix(const TrieKey<BITS> a, const TrieKey<BITS> b) {
+        return keyLeadingZeros<BITS>(a ^ b);
+    }
+}
+
+#endif // TRIE_KEY_HPP
@@ -0,0 +1,70 @@
+#ifndef TRIE_STATS_HPP
+#define TRIE_STATS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Count of route addresses used to measure depth of lookups
+#define TRIE_STATS_SAMPLES_COUNT    10000u
+
+namespace NetTypes {
+    // Shape and memory of one trie, used for sizing and diagnostics
+    struct TrieStats {
+        size_t nodesCount = 0;
+        size_t routesCount = 0;
+        size_t allocatedBytes = 0;
+
+        // Count of routes by depth of their node (nodes passed from root)
+        std::vector<size_t> depthHistogram;
+
+        // Nodes read by one lookup of sampled route addresses (root included)
+        size_t sampledLookupsCount = 0;
+        double avgLookupDepth = 0.0;
+    };
+
+    struct TriePairStats {
+        TrieStats v4;
+        TrieStats v6;
+
+        // Compiled lookup structures (Dir24_8Table, IPv6TreeBitmap)
+        size_t compiledBytes = 0;
+    };
+
+    // Collects every step-th route address while trie is walked, so samples are spread over whole trie
+    template <typename Key>
+    class TrieStatsSampler {
+    public:
+        TrieStatsSampler(const size_t routesCount, const size_t samplesCount)
+            : m_step(samplesCount ? std::max<size_t>(1, routesCount / samplesCount) : 0), m_limit(samplesCount) {
+            m_samples.reserve(samplesCount);
+        }
+
+        void addRoute(const Key key) {
+            if (m_step && m_seen++ % m_step == 0 && m_samples.size() < m_limit) {
+                m_samples.push_back(key);
+            }
+        }
+
+        // depthFn(key) -> count of nodes read by lookup of key
+        template <typename DepthFn>
+        void measure(TrieStats& stats, DepthFn&& depthFn) const {
+            size_t totalDepth = 0;
+
+            for (const Key key : m_samples) {
+                totalDepth += depthFn(key);
+            }
+
+            stats.sampledLookupsCount = m_samples.size();
+            stats.avgLookupDepth = m_samples.empty() ? 0.0 : static_cast<double>(totalDepth) / m_samples.size();
+        }
+
+    private:
+        std::vector<Key> m_samples;
+        size_t m_step;
+        size_t m_limit;
+        size_t m_seen = 0;
+    };
+}
+
+#endif // TRIE_STATS_HPP
@@ -4,12 +4,11 @@
 #include <string>
 #include <json_io.hpp>
 
+#include "address_classify.hpp"
 #include "net_types_base.hpp"
 #include "fs_utils.hpp"
 
 namespace NetUtils {
-    NetTypes::AddressType getAddressType(const std::string& input);
-
     std::vector<std::string> downloadGithubReleaseAssets(const std::string& url,
         const std::vector<std::string>& fileNames,
         const fs::path& dirPath,
@@ -0,0 +1,249 @@
+#include <array>
+
+#include "address_classify.hpp"
+#include "net_convert.hpp"
+
+using namespace NetTypes;
+using namespace NetUtils;
+
+#define DOMAIN_LABEL_MAX_LENGTH     63u
+#define DOMAIN_TLD_MIN_LENGTH       2u
+
+namespace {
+    enum CharClass : uint8_t {
+        kDigit  = 1u << 0,
+        kLetter = 1u << 1,
+        kHyphen = 1u << 2
+    };
+
+    constexpr std::array<uint8_t, 256> makeCharClasses() {
+        std::array<uint8_t, 256> table{};
+
+        for (int c = '0'; c <= '9'; ++c) {
+            table[c] = kDigit;
+        }
+
+        for (int c = 'a'; c <= 'z'; ++c) {
+            table[c] = kLetter;
+            table[c - 'a' + 'A'] = kLetter;
+        }
+
+        table['-'] = kHyphen;
+
+        return table;
+    }
+
+    constexpr auto kCharClasses = makeCharClasses();
+
+    bool isClass(const char c, const uint8_t classes) {
+        return (kCharClasses[static_cast<uint8_t>(c)] & classes) != 0;
+    }
+
+    // Position in input, '\0' is returned past the end, it belongs to no class
+    struct Scanner {
+        std::string_view input;
+        size_t pos = 0;
+
+        [[nodiscard]]
+        char peek() const {
+            return pos < input.size() ? input[pos] : '\0';
+        }
+
+        [[nodiscard]]
+        bool isEnd() const {
+            return pos == input.size();
+        }
+
+        bool skip(const char c) {
+            if (peek() != c) {
+                return false;
+            }
+
+            ++pos;
+            return true;
+        }
+    };
+}
+
+// Decimal number without leading zeros
+static bool scanDecimal(Scanner& sc, const unsigned maxValue, unsigned& out) {
+    const size_t start = sc.pos;
+    unsigned value = 0;
+
+    while (isClass(sc.peek(), kDigit)) {
+        value = value * 10 + (sc.peek() - '0');
+        ++sc.pos;
+
+        if (value > maxValue) {
+            return false;
+        }
+    }
+
+    const size_t length = sc.pos - start;
+
+    if (length == 0 || (length > 1 && sc.input[start] == '0')) {
+        return false;
+    }
+
+    out = value;
+    return true;
+}
+
+// Scanner is moved past parsed address
+static bool scanIPv4(Scanner& sc, addrIPv4& out) {
+    const auto [ptr, ec] = Convert::fromCharsIPv4(sc.input.data() + sc.pos, sc.input.data() + sc.input.size(), out);
+    sc.pos = ptr - sc.input.data();
+
+    return ec == std::errc();
+}
+
+static bool scanIPv6(Scanner& sc, addrIPv6& out) {
+    const auto [ptr, ec] = Convert::fromCharsIPv6(sc.input.data() + sc.pos, sc.input.data() + sc.input.size(), out);
+    sc.pos = ptr - sc.input.data();
+
+    return ec == std::errc();
+}
+
+static bool scanPrefix(Scanner& sc, const unsigned bitsCount, uint8_t& prefix, bool& hasPrefix) {
+    unsigned value = 0;
+
+    if (!sc.skip('/')) {
+        return true;
+    }
+
+    if (!scanDecimal(sc, bitsCount, value)) {
+        return false;
+    }
+
+    prefix = static_cast<uint8_t>(value);
+    hasPrefix = true;
+
+    return true;
+}
+
+static bool tryClassifyIPv4(const std::string_view input, AddressInfo& info) {
+    Scanner sc{input};
+    IPv4Subnet subnet;
+    bool hasPrefix = false;
+
+    if (!scanIPv4(sc, subnet.ip) || !scanPrefix(sc, IPV4_BITS_COUNT, subnet.prefix, hasPrefix) || !sc.isEnd()) {
+        return false;
+    }
+
+    info = {AddressType::IPV4, subnet, hasPrefix};
+    return true;
+}
+
+static bool tryClassifyIPv6(const std::string_view input, AddressInfo& info) {
+    Scanner sc{input};
+    IPv6Subnet subnet;
+    bool hasPrefix = false;
+
+    if (!scanIPv6(sc, subnet.ip)) {
+        return false;
+    }
+
+    if (sc.skip('%')) {
+        // Zone is allowed only for link-local address (fe80::/10) and it is not a part of value
+        if ((subnet.ip >> (IPV6_BITS_COUNT - 10)) != 0x3FA) {
+            return false;
+        }
+
+        const size_t start = sc.pos;
+
+        while (isClass(sc.peek(), kDigit | kLetter)) {
+            ++sc.pos;
+        }
+
+        if (sc.pos == start) {
+            return false;
+        }
+    } else if (!scanPrefix(sc, IPV6_BITS_COUNT, subnet.prefix, hasPrefix)) {
+        return false;
+    }
+
+    if (!sc.isEnd()) {
+        return false;
+    }
+
+    info = {AddressType::IPV6, subnet, hasPrefix};
+    return true;
+}
+
+static bool isDomainLabel(const std::string_view label) {
+    if (label.empty() || label.size() > DOMAIN_LABEL_MAX_LENGTH) {
+        return false;
+    }
+
+    if (!isClass(label.front(), kLetter) || !isClass(label.back(), kLetter | kDigit)) {
+        return false;
+    }
+
+    for (const char c : label) {
+        if (!isClass(c, kLetter | kDigit | kHyphen)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool isDomainTLD(const std::string_view label) {
+    if (label.size() < DOMAIN_TLD_MIN_LENGTH || label.size() > DOMAIN_LABEL_MAX_LENGTH) {
+        return false;
+    }
+
+    for (const char c : label) {
+        if (!isClass(c, kLetter)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool isDomain(const std::string_view input) {
+    if (input == "localhost") {
+        return true;
+    }
+
+    size_t start = 0;
+
+    while (true) {
+        const size_t end = input.find('.', start);
+
+        if (end == std::string_view::npos) {
+            // At least one label before TLD
+            return start != 0 && isDomainTLD(input.substr(start));
+        }
+
+        if (!isDomainLabel(input.substr(start, end - start))) {
+            return false;
+        }
+
+        start = end + 1;
+    }
+}
+
+AddressInfo NetUtils::classifyAddress(const std::string_view input) {
+    AddressInfo info;
+
+    if (input.empty()) {
+        return info;
+    }
+
+    // IPv4 is checked first, so entries like "1.2.3.4" are never domains
+    if (tryClassifyIPv4(input, info) || tryClassifyIPv6(input, info)) {
+        return info;
+    }
+
+    if (isDomain(input)) {
+        info.type = AddressType::DOMAIN;
+    }
+
+    return info;
+}
+
+AddressType NetUtils::getAddressType(const std::string_view input) {
+    return classifyAddress(input).type;
+}
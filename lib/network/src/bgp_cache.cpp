@@ -0,0 +1,251 @@
+#include <algorithm>
+#include <atomic>
+#include <optional>
+
+#include "bgp_cache.hpp"
+#include "bgp_parse.hpp"
+#include "bgp_snapshot.hpp"
+#include "libnetwork_settings.hpp"
+#include "log.hpp"
+
+using namespace NetTypes;
+using namespace NetUtils;
+
+namespace {
+    // Dumps and updates files which current version of cache was built from
+    struct CacheSource {
+        std::vector<fs::path> paths;
+        BGP::DumpFingerprint fingerprint;
+
+        // Applied updates files, in order
+        std::vector<fs::path> updatePaths;
+        BGP::DumpFingerprint updateFingerprint;
+
+        // Peers of routes after applied updates, filled only if updates are enabled
+        BGP::RoutePeers peers;
+
+        bool isSameDumps(const std::vector<fs::path>& otherPaths, const BGP::DumpFingerprint& otherFingerprint) const {
+            return paths == otherPaths && fingerprint == otherFingerprint;
+        }
+
+        // New files were only appended to applied ones, which did not change
+        bool isAppendedUpdates(const std::vector<fs::path>& otherPaths) const {
+            return otherPaths.size() > updatePaths.size() &&
+                   std::equal(updatePaths.begin(), updatePaths.end(), otherPaths.begin()) &&
+                   BGP::getDumpFingerprint(updatePaths) == updateFingerprint;
+        }
+    };
+
+    // Accessed only through std::atomic_load / std::atomic_store
+    BGP::TrieSnapshot gCacheTrie;
+
+    std::atomic<uint64_t> gCacheVersion{0};
+
+    // Serializes building of new versions, readers never take it
+    std::mutex gCacheBuildMutex;
+
+    // Guarded by gCacheBuildMutex
+    std::optional<CacheSource> gCacheSource;
+    BGP::UpdateStats gCacheUpdateStats;
+}
+
+static void logTrieStats(const char* family, const TrieStats& stats) {
+    LOG_INFO("{} trie: {} nodes, {} routes, {} KiB, average lookup depth {:.1f} (on {} routes)",
+        family,
+        stats.nodesCount,
+        stats.routesCount,
+        stats.allocatedBytes / 1024,
+        stats.avgLookupDepth,
+        stats.sampledLookupsCount);
+}
+
+static std::shared_ptr<TriePair> buildTriePair(CacheSource& source, BGP::UpdateStats& outStats) {
+    const auto& paths = source.paths;
+    const auto& fingerprint = source.fingerprint;
+    auto pair = std::make_shared<TriePair>();
+
+    // Peers of routes are needed only for applying updates, they are collected while dumps are parsed
+    BGP::RoutePeers* peers = !gLibNetworkSettings.bgpUpdatePaths.empty() ? &source.peers : nullptr;
+
+    if (gLibNetworkSettings.bgpSnapshotDir.empty()) {
+        BGP::parseDumps(paths, *pair, peers);
+    } else {
+        const auto snapshotPath = BGP::getSnapshotPath(gLibNetworkSettings.bgpSnapshotDir, paths, pair->v4.getType());
+
+        if (BGP::loadSnapshot(snapshotPath, *pair, fingerprint, peers)) {
+            LOG_INFO("{} BGP dumps are loaded from snapshot {}", paths.size(), snapshotPath.string());
+        } else {
+            BGP::parseDumps(paths, *pair, peers);
+
+            try {
+                BGP::writeSnapshot(snapshotPath, *pair, fingerprint, peers);
+            } catch (const std::exception& e) {
+                // Snapshot only speeds up next start, so build is continued
+                LOG_WARNING("Failed to save snapshot of BGP dump: {}", e.what());
+            }
+        }
+    }
+
+    if (peers != nullptr) {
+        outStats = BGP::applyUpdates(source.updatePaths, *pair, *peers);
+    }
+
+    pair->compileLookupTables();
+
+    return pair;
+}
+
+// Published tries are copied and only new updates files are applied to the copy
+static std::shared_ptr<TriePair> applyNewUpdates(const TriePair& published, CacheSource& source,
+                                                 const std::vector<fs::path>& updatePaths, BGP::UpdateStats& outStats) {
+    const std::vector<fs::path> newPaths(updatePaths.begin() + static_cast<ptrdiff_t>(source.updatePaths.size()), updatePaths.end());
+    auto pair = std::make_shared<TriePair>(published.v4.getType());
+
+    pair->copyTriesFrom(published);
+
+    outStats = BGP::applyUpdates(newPaths, *pair, source.peers);
+
+    pair->compileLookupTables();
+
+    return pair;
+}
+
+bool BGP::parseDumpsToCache(const std::vector<std::string>& patterns) {
+    std::lock_guard<std::mutex> lock(gCacheBuildMutex);
+
+    const auto paths = expandDumpPaths(patterns);
+
+    if (paths.empty()) {
+        return false;
+    }
+
+    const auto fingerprint = getDumpFingerprint(paths);
+
+    std::vector<fs::path> updatePaths;
+
+    if (!gLibNetworkSettings.bgpUpdatePaths.empty()) {
+        updatePaths = expandDumpPaths(gLibNetworkSettings.bgpUpdatePaths);
+    }
+
+    const auto updateFingerprint = getDumpFingerprint(updatePaths);
+
+    TrieSnapshot pair;
+    UpdateStats updateStats;
+
+    if (gCacheSource && gCacheSource->isSameDumps(paths, fingerprint)) {
+        if (gCacheSource->updatePaths == updatePaths && gCacheSource->updateFingerprint == updateFingerprint) {
+            return false;
+        }
+
+        if (gCacheSource->isAppendedUpdates(updatePaths)) {
+            try {
+                pair = applyNewUpdates(*getTrieFromCache(), *gCacheSource, updatePaths, updateStats);
+            } catch (...) {
+                // Peers may be partially updated, so next refresh rebuilds cache from dumps
+                gCacheSource.reset();
+                throw;
+            }
+
+            LOG_INFO("{} new BGP updates files are applied to cache", updatePaths.size() - gCacheSource->updatePaths.size());
+
+            gCacheSource->updatePaths = updatePaths;
+            gCacheSource->updateFingerprint = updateFingerprint;
+        }
+    }
+
+    if (!pair) {
+        CacheSource source = {paths, fingerprint, updatePaths, updateFingerprint, {}};
+
+        pair = buildTriePair(source, updateStats);
+        gCacheSource = std::move(source);
+    }
+
+    std::atomic_store(&gCacheTrie, pair);
+    gCacheUpdateStats = updateStats;
+
+    const uint64_t version = ++gCacheVersion;
+
+    LOG_INFO("{} BGP dumps are parsed to cache (version {}), tries allocated {} KiB",
+        paths.size(),
+        version,
+        pair->getAllocatedBytes() / 1024);
+
+    const auto stats = pair->getStats();
+
+    logTrieStats("IPv4", stats.v4);
+    logTrieStats("IPv6", stats.v6);
+
+    return true;
+}
+
+BGP::TrieSnapshot BGP::getTrieFromCache() {
+    return std::atomic_load(&gCacheTrie);
+}
+
+BGP::TrieSnapshot BGP::loadTrieToCache(const std::vector<std::string>& patterns) {
+    if (auto pair = getTrieFromCache()) {
+        return pair;
+    }
+
+    // Concurrent callers wait for the first one and find dumps unchanged
+    parseDumpsToCache(patterns);
+
+    return getTrieFromCache();
+}
+
+uint64_t BGP::getTrieCacheVersion() {
+    return gCacheVersion.load();
+}
+
+BGP::UpdateStats BGP::getTrieCacheUpdateStats() {
+    std::lock_guard<std::mutex> lock(gCacheBuildMutex);
+    return gCacheUpdateStats;
+}
+
+// ──────────────────────────────────────────────────────────────
+// TrieCacheRefresher
+// ──────────────────────────────────────────────────────────────
+BGP::TrieCacheRefresher::~TrieCacheRefresher() {
+    stop();
+}
+
+void BGP::TrieCacheRefresher::start(const std::vector<std::string>& patterns, const std::chrono::seconds interval) {
+    stop();
+
+    m_patterns = patterns;
+    m_interval = interval;
+    m_isRunning = true;
+
+    m_thread = std::thread(&TrieCacheRefresher::run, this);
+}
+
+void BGP::TrieCacheRefresher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_isRunning = false;
+    }
+
+    m_cv.notify_one();
+
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void BGP::TrieCacheRefresher::run() {
+    std::unique_lock<std::mutex> lock(m_mtx);
+
+    while (m_isRunning) {
+        lock.unlock();
+
+        try {
+            parseDumpsToCache(m_patterns);
+        } catch (const std::exception& e) {
+            // Readers keep using previous version
+            LOG_WARNING("Failed to refresh BGP dump cache: {}", e.what());
+        }
+
+        lock.lock();
+        m_cv.wait_for(lock, m_interval, [this] { return !m_isRunning; });
+    }
+}
@@ -0,0 +1,90 @@
+#include <algorithm>
+
+#include "bgp_dir24_8.hpp"
+#include "bgp_trie.hpp"
+#include "trie_batch.hpp"
+
+namespace NetTypes {
+    // ──────────────────────────────────────────────────────────────
+    // Build
+    // ──────────────────────────────────────────────────────────────
+    Dir24_8Table::Dir24_8Table(const BGPTrie<IPV4_BITS_COUNT>& trie) : m_firstLevel(kFirstLevelSize, 0u) {
+        trie.forEachRoute([this](const IPv4Subnet& subnet) {
+            m_routes.push_back({subnet.ip, subnet.prefix});
+        });
+
+        // Shorter prefixes are painted first, so more specific ones overwrite them
+        std::stable_sort(m_routes.begin(), m_routes.end(), [](const Route& a, const Route& b) {
+            return a.len < b.len;
+        });
+
+        for (size_t i = 0; i < m_routes.size(); ++i) {
+            const auto& route = m_routes[i];
+            const auto entry = static_cast<Entry>(i + 1);
+            const uint32_t network = route.key & keyMask<IPV4_BITS_COUNT>(route.len);
+
+            if (route.len <= kFirstLevelBits) {
+                const size_t start = network >> (IPV4_BITS_COUNT - kFirstLevelBits);
+                const size_t count = size_t{1} << (kFirstLevelBits - route.len);
+
+                std::fill_n(m_firstLevel.begin() + static_cast<std::ptrdiff_t>(start), count, entry);
+                continue;
+            }
+
+            Entry& first = m_firstLevel[network >> (IPV4_BITS_COUNT - kFirstLevelBits)];
+
+            if (!(first & kChunkFlag)) {
+                // Chunk inherits covering route of first level entry
+                const auto chunk = static_cast<Entry>(m_chunks.size() / kChunkSize);
+                m_chunks.resize(m_chunks.size() + kChunkSize, first);
+                first = kChunkFlag | chunk;
+            }
+
+            const size_t base = static_cast<size_t>(first & ~kChunkFlag) * kChunkSize;
+            const size_t start = base + (network & (kChunkSize - 1));
+            const size_t count = size_t{1} << (IPV4_BITS_COUNT - route.len);
+
+            std::fill_n(m_chunks.begin() + static_cast<std::ptrdiff_t>(start), count, entry);
+        }
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // Search (LPM)
+    // ──────────────────────────────────────────────────────────────
+    std::optional<IPv4Subnet> Dir24_8Table::lookup(const addrIPv4 key) const {
+        Entry entry = m_firstLevel[key >> (IPV4_BITS_COUNT - kFirstLevelBits)];
+
+        if (entry & kChunkFlag) {
+            entry = m_chunks[static_cast<size_t>(entry & ~kChunkFlag) * kChunkSize + (key & (kChunkSize - 1))];
+        }
+
+        if (entry == 0) {
+            return std::nullopt;
+        }
+
+        const auto& route = m_routes[entry - 1];
+
+        return IPv4Subnet{route.key, static_cast<uint8_t>(route.len)};
+    }
+
+    void Dir24_8Table::lookupBatch(const std::vector<addrIPv4>& ips, std::vector<std::optional<IPv4Subnet>>& results) const {
+        results.resize(ips.size());
+
+        // First level entries of next group are prefetched while current group is resolved
+        for (size_t i = 0; i < ips.size(); ++i) {
+            if (const size_t ahead = i + TRIE_BATCH_WIDTH; ahead < ips.size()) {
+                const uint32_t key = ips[ahead];
+                prefetchNode(&m_firstLevel[key >> (IPV4_BITS_COUNT - kFirstLevelBits)]);
+            }
+
+            results[i] = lookup(ips[i]);
+        }
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // Other
+    // ──────────────────────────────────────────────────────────────
+    size_t Dir24_8Table::getAllocatedBytes() const {
+        return (m_firstLevel.capacity() + m_chunks.capacity()) * sizeof(Entry) + m_routes.capacity() * sizeof(Route);
+    }
+}
@@ -1,145 +1,447 @@
 #include <variant>
 #include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include <glob.h>
 
 #include "bgp_parse.hpp"
-#include "net_convert.hpp"
-#include "bgpdump_lib.h"
+#include "fs_utils_mmap.hpp"
+#include "libnetwork_settings.hpp"
+#include "mrt_reader.hpp"
 #include "log.hpp"
 
+// Plain dumps are split to chunks of this size for parallel parsing
+#define BGP_DUMP_CHUNK_BYTES    (64u << 20) // 64 MiB
+
 using namespace NetTypes;
 using namespace NetUtils;
 
-static std::optional<SubnetVariant> extractSubnetFromEntry(BGPDUMP_ENTRY *entry);
+namespace {
+    // Part of dump parsed by one thread: whole compressed dump or range of records of plain one
+    struct DumpTask {
+        fs::path path;
+        std::shared_ptr<const FS::Utils::MappedFile> file; // nullptr for compressed dump
+        size_t begin;
+        size_t end;
+
+        // PEER_INDEX_TABLE of plain dump, parts after the first one do not contain it (nullptr if peers are not collected)
+        std::shared_ptr<const std::vector<MRT::Peer>> peerTable;
+    };
+
+    // State of one thread which parses records of dumps
+    struct DumpParser {
+        TriePair& pair;
+        BGP::RoutePeers* peers;     // nullptr if peers are not collected
+
+        std::vector<MRT::Peer> peerTable;
+        std::vector<MRT::Peer> entryPeers;
+        std::vector<uint32_t> entryIndexes;
+        size_t routesCount = 0;
+
+        DumpParser(TriePair& outPair, BGP::RoutePeers* outPeers) : pair(outPair), peers(outPeers) {}
+    };
+
+    template <size_t BITS>
+    auto& getRoutePeers(BGP::RoutePeers& peers) {
+        if constexpr (BITS == IPV4_BITS_COUNT) {
+            return peers.v4;
+        } else {
+            return peers.v6;
+        }
+    }
+
+    // Same route may come from several dumps, so indexes are merged
+    template <typename Routes, typename Key>
+    void addRoutePeers(Routes& routes, const Key& key, const std::vector<uint32_t>& indexes) {
+        auto& routePeers = routes[key];
+        routePeers.insert(routePeers.end(), indexes.begin(), indexes.end());
+
+        std::sort(routePeers.begin(), routePeers.end());
+        routePeers.erase(std::unique(routePeers.begin(), routePeers.end()), routePeers.end());
+    }
 
-void BGP::parseDump(const std::string& path, TriePair& outPair) {
-    BGPDUMP* dump = nullptr;
-    BGPDUMP_ENTRY* entry = nullptr;
+    // Peers of thread are moved to common table, their indexes are translated
+    void mergeRoutePeers(BGP::RoutePeers& to, const BGP::RoutePeers& from) {
+        std::vector<uint32_t> translated(from.peers.size());
+        std::vector<uint32_t> indexes;
 
-    dump = bgpdump_open_dump(path.c_str());
+        for (size_t i = 0; i < from.peers.size(); ++i) {
+            translated[i] = to.getPeerIndex(from.peers[i]);
+        }
 
-    if (dump == nullptr) {
-        throw std::ios_base::failure(FILE_OPEN_ERROR_MSG + path);
+        const auto mergeRoutes = [&](auto& toRoutes, const auto& fromRoutes) {
+            for (const auto& [key, fromIndexes] : fromRoutes) {
+                indexes.clear();
+
+                for (const uint32_t index : fromIndexes) {
+                    indexes.push_back(translated[index]);
+                }
+
+                addRoutePeers(toRoutes, key, indexes);
+            }
+        };
+
+        mergeRoutes(to.v4, from.v4);
+        mergeRoutes(to.v6, from.v6);
     }
 
-    do {
-        entry = bgpdump_read_next(dump);
+    // Route exists while it has peers. Repeated announcement by the same peer is implicit replace,
+    // route of dump without known peers (TABLE_DUMP records) is already in trie and is not inserted again
+    template <size_t BITS>
+    void announcePeerRoute(BGPTrie<BITS>& trie, BGP::RoutePeers& peers, const uint32_t peerIndex,
+                           const IPvx<TrieKey<BITS>>& subnet) {
+        auto& routePeers = getRoutePeers<BITS>(peers)[{subnet.ip, subnet.prefix}];
+        const auto it = std::lower_bound(routePeers.begin(), routePeers.end(), peerIndex);
 
-        if (entry != nullptr) {
-            auto subnet = extractSubnetFromEntry(entry);
+        if (it != routePeers.end() && *it == peerIndex) {
+            return;
+        }
 
-            if (!subnet) {
-                return;
+        routePeers.insert(it, peerIndex);
+
+        if (routePeers.size() == 1 && trie.getRefs(subnet) == 0) {
+            trie.insert(subnet);
+        }
+    }
+
+    // True if route is removed from trie
+    template <size_t BITS>
+    bool withdrawPeerRoute(BGPTrie<BITS>& trie, BGP::RoutePeers& peers, const uint32_t peerIndex,
+                           const IPvx<TrieKey<BITS>>& subnet) {
+        auto& routes = getRoutePeers<BITS>(peers);
+        const auto routeIt = routes.find({subnet.ip, subnet.prefix});
+
+        if (routeIt == routes.end()) {
+            return false;
+        }
+
+        auto& routePeers = routeIt->second;
+        const auto it = std::lower_bound(routePeers.begin(), routePeers.end(), peerIndex);
+
+        // Peer does not announce route, so other announcements are kept
+        if (it == routePeers.end() || *it != peerIndex) {
+            return false;
+        }
+
+        routePeers.erase(it);
+
+        if (!routePeers.empty()) {
+            return false;
+        }
+
+        routes.erase(routeIt);
+
+        return trie.remove(subnet);
+    }
+
+    void insertRecordPrefix(DumpParser& parser, const MRT::RecordHeader& header, const uint8_t* body) {
+        // Compressed dump is parsed by one task, so its PEER_INDEX_TABLE is met in stream
+        if (parser.peers != nullptr && MRT::extractPeerIndexTable(header, body, parser.peerTable)) {
+            return;
+        }
+
+        uint32_t peersCount = 1;
+        const auto subnet = MRT::extractRibPrefix(header, body, &peersCount);
+
+        if (!subnet) {
+            // Records without routes (peer index, updates, etc.)
+            return;
+        }
+
+        // Every peer is one announcement of route, so withdraw from one peer does not remove it
+        std::visit([&parser, peersCount](auto &net){
+            using T = std::decay_t<decltype(net)>;
+
+            if constexpr (std::is_same_v<T, IPv4Subnet>) {
+                parser.pair.v4.insert(net, peersCount);
+            }
+            if constexpr (std::is_same_v<T, IPv6Subnet>) {
+                parser.pair.v6.insert(net, peersCount);
             }
+        }, *subnet);
 
-            std::visit([&outPair](auto &net){
-                using T = std::decay_t<decltype(net)>;
+        ++parser.routesCount;
 
-                if constexpr (std::is_same_v<T, IPv4Subnet>) {
-                    outPair.v4.insert(net);
-                }
-                if constexpr (std::is_same_v<T, IPv6Subnet>) {
-                    outPair.v6.insert(net);
-                }
-            }, *subnet);
+        if (parser.peers == nullptr) {
+            return;
+        }
+
+        MRT::extractRibPeers(header, body, parser.peerTable, parser.entryPeers);
 
-            bgpdump_free_mem(entry);
+        if (parser.entryPeers.empty()) {
+            return;
         }
-    } while (dump->eof == 0);
 
-    bgpdump_close_dump(dump);
-}
+        parser.entryIndexes.clear();
 
-void BGP::parseDumpToCache(const std::string& path) {
-    auto ptrie = getTrieFromCache();
-    parseDump(path, *ptrie);
-}
+        for (const auto& peer : parser.entryPeers) {
+            parser.entryIndexes.push_back(parser.peers->getPeerIndex(peer));
+        }
 
-TriePair* BGP::getTrieFromCache() {
-    static TriePair gCacheTrie;
-    return &gCacheTrie;
-}
+        std::visit([&parser](auto &net){
+            using T = std::decay_t<decltype(net)>;
+            constexpr size_t bits = std::is_same_v<T, IPv4Subnet> ? IPV4_BITS_COUNT : IPV6_BITS_COUNT;
 
-static std::optional<SubnetVariant> extractSubnetFromEntry(BGPDUMP_ENTRY *entry)
-{
-    if (!entry) {
-        return std::nullopt;
+            addRoutePeers(getRoutePeers<bits>(*parser.peers), std::make_pair(net.ip, net.prefix), parser.entryIndexes);
+        }, *subnet);
     }
 
-    // ===========================
-    // TYPE: MRTD_TABLE_DUMP
-    // ===========================
-    if (entry->type == BGPDUMP_TYPE_MRTD_TABLE_DUMP) {
+    // PEER_INDEX_TABLE precedes RIB records of TABLE_DUMP_V2 dump, so only begin of dump is read
+    std::vector<MRT::Peer> readPeerIndexTable(const uint8_t* data, const size_t size) {
+        std::vector<MRT::Peer> peerTable;
+        size_t offset = 0;
+
+        while (size - offset >= MRT::kRecordHeaderSize) {
+            const uint8_t* p = data + offset;
+            const MRT::RecordHeader header = {MRT::readBE32(p), MRT::readBE16(p + 4), MRT::readBE16(p + 6), MRT::readBE32(p + 8)};
+
+            if (header.length > size - offset - MRT::kRecordHeaderSize) {
+                break;
+            }
+
+            const uint8_t* body = p + MRT::kRecordHeaderSize;
 
-        if (entry->subtype == AFI_IP) {
-            const auto ip  = Convert::inetv4ToBitset(entry->body.mrtd_table_dump.prefix.v4_addr);
-            const auto mask = Convert::lengthv4ToBitset(entry->body.mrtd_table_dump.mask);
+            if (MRT::extractPeerIndexTable(header, body, peerTable) || MRT::extractRibPrefix(header, body)) {
+                break;
+            }
 
-            return IPv4Subnet{ip, mask};
+            offset += MRT::kRecordHeaderSize + header.length;
         }
 
-#ifdef BGPDUMP_HAVE_IPV6
-        if (entry->subtype == AFI_IP6) {
-            const auto ip  = Convert::inetv6ToBitset(entry->body.mrtd_table_dump.prefix.v6_addr);
-            const auto mask = Convert::lengthv6ToBitset(entry->body.mrtd_table_dump.mask);
+        return peerTable;
+    }
+
+    std::vector<DumpTask> makeDumpTasks(const std::vector<fs::path>& paths, const bool isCollectPeers) {
+        std::vector<DumpTask> tasks;
+
+        for (const auto& path : paths) {
+            auto file = std::make_shared<const FS::Utils::MappedFile>(path);
+
+            if (MRT::isCompressed(file->data(), file->size())) {
+                // Compressed stream can not be split
+                tasks.push_back({path, nullptr, 0, 0, nullptr});
+                continue;
+            }
+
+            const auto bounds = MRT::splitToChunks(file->data(), file->size(), BGP_DUMP_CHUNK_BYTES);
+
+            if (bounds.back() != file->size()) {
+                LOG_WARNING("BGP dump {} ends with truncated record ({} bytes)", path.string(), file->size() - bounds.back());
+            }
+
+            std::shared_ptr<const std::vector<MRT::Peer>> peerTable;
 
-            return IPv6Subnet{ip, mask};
+            if (isCollectPeers) {
+                peerTable = std::make_shared<const std::vector<MRT::Peer>>(readPeerIndexTable(file->data(), file->size()));
+            }
+
+            for (size_t i = 1; i < bounds.size(); ++i) {
+                tasks.push_back({path, file, bounds[i - 1], bounds[i], peerTable});
+            }
         }
-#endif
+
+        return tasks;
     }
 
+    void runDumpTask(const DumpTask& task, DumpParser& parser) {
+        parser.peerTable.clear();
 
+        if (task.peerTable) {
+            parser.peerTable = *task.peerTable;
+        }
 
+        const auto callback = [&parser](const MRT::RecordHeader& header, const uint8_t* body) {
+            insertRecordPrefix(parser, header, body);
+        };
 
-    // ===========================
-    // TYPE: TABLE_DUMP_V2
-    // ===========================
-    if (entry->type == BGPDUMP_TYPE_TABLE_DUMP_V2) {
-        auto *p = &entry->body.mrtd_table_dump_v2_prefix;
+        if (task.file) {
+            MRT::forEachRecord(task.file->data() + task.begin, task.end - task.begin, callback);
+        } else {
+            MRT::forEachRecord(task.path, callback);
+        }
+    }
 
-        if (p->afi == AFI_IP) {
-            const auto ip  = Convert::inetv4ToBitset(p->prefix.v4_addr);
-            const auto mask = Convert::lengthv4ToBitset(p->prefix_length);
+    unsigned getParseThreadsCount(const size_t tasksCount) {
+        unsigned count = gLibNetworkSettings.bgpParseThreadsCount;
 
-            return IPv4Subnet{ip, mask};
+        if (count == 0) {
+            count = std::max(1u, std::thread::hardware_concurrency());
         }
 
-#ifdef BGPDUMP_HAVE_IPV6
-        if (p->afi == AFI_IP6) {
-            const auto ip  = Convert::inetv6ToBitset(p->prefix.v6_addr);
-            const auto mask = Convert::lengthv6ToBitset(p->prefix_length);
+        return static_cast<unsigned>(std::min<size_t>(count, tasksCount));
+    }
+}
+
+void BGP::parseDump(const std::string& path, TriePair& outPair, RoutePeers* outPeers) {
+    DumpParser parser(outPair, outPeers);
+
+    MRT::forEachRecord(path, [&parser](const MRT::RecordHeader& header, const uint8_t* body) {
+        insertRecordPrefix(parser, header, body);
+    });
+
+    LOG_INFO("BGP dump {} is read, {} routes are found", path, parser.routesCount);
+}
+
+void BGP::parseDumps(const std::vector<fs::path>& paths, TriePair& outPair, RoutePeers* outPeers) {
+    const auto tasks = makeDumpTasks(paths, outPeers != nullptr);
+    const unsigned threadsCount = getParseThreadsCount(tasks.size());
+
+    if (threadsCount <= 1) {
+        DumpParser parser(outPair, outPeers);
 
-            return IPv6Subnet{ip, mask};
+        for (const auto& task : tasks) {
+            runDumpTask(task, parser);
         }
-#endif
+
+        LOG_INFO("{} BGP dumps are read, {} routes are found", paths.size(), parser.routesCount);
+        return;
+    }
+
+    // Every thread fills its own tries and peers, they are merged after all tasks are done
+    std::vector<std::unique_ptr<TriePair>> localPairs;
+    std::vector<RoutePeers> localPeers(outPeers != nullptr ? threadsCount : 0);
+    std::vector<std::exception_ptr> errors(threadsCount);
+    std::atomic<size_t> nextTask{0};
+    std::atomic<size_t> routesCount{0};
+
+    for (unsigned i = 0; i < threadsCount; ++i) {
+        localPairs.push_back(std::make_unique<TriePair>(outPair.v4.getType()));
     }
 
+    std::vector<std::thread> threads;
 
+    for (unsigned i = 0; i < threadsCount; ++i) {
+        threads.emplace_back([&, i]() {
+            DumpParser parser(*localPairs[i], outPeers != nullptr ? &localPeers[i] : nullptr);
 
+            try {
+                for (size_t taskInx = nextTask++; taskInx < tasks.size(); taskInx = nextTask++) {
+                    runDumpTask(tasks[taskInx], parser);
+                }
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
 
-    // ===========================
-    // TYPE: ZEBRA_BGP (берём source IP)
-    // ===========================
-    if (entry->type == BGPDUMP_TYPE_ZEBRA_BGP) {
-        auto &m = entry->body.zebra_message;
+            routesCount += parser.routesCount;
+        });
+    }
 
-        if (m.address_family == AFI_IP) {
-            // Zebra не даёт маску — считаем /32
-            const bitsetIPv4 ip = Convert::inetv4ToBitset(m.source_ip.v4_addr);
-            const bitsetIPv4 mask = Convert::lengthv4ToBitset(IPV4_BITS_COUNT);
+    for (auto& thread : threads) {
+        thread.join();
+    }
 
-            return IPv4Subnet{ip, mask};
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
         }
+    }
+
+    for (auto& localPair : localPairs) {
+        localPair->v4.forEachRouteWithRefs([&outPair](const IPv4Subnet& subnet, const uint32_t refs) { outPair.v4.insert(subnet, refs); });
+        localPair->v6.forEachRouteWithRefs([&outPair](const IPv6Subnet& subnet, const uint32_t refs) { outPair.v6.insert(subnet, refs); });
+
+        // Memory of merged tries is released at once
+        localPair.reset();
+    }
+
+    for (auto& peers : localPeers) {
+        mergeRoutePeers(*outPeers, peers);
+        peers = RoutePeers();
+    }
+
+    LOG_INFO("{} BGP dumps are read by {} threads ({} parts), {} routes are found",
+        paths.size(), threadsCount, tasks.size(), routesCount.load());
+}
+
+uint32_t BGP::RoutePeers::getPeerIndex(const MRT::Peer& peer) {
+    const auto [it, isInserted] = peerIndexes.emplace(peer, static_cast<uint32_t>(peers.size()));
+
+    if (isInserted) {
+        peers.push_back(peer);
+    }
+
+    return it->second;
+}
+
+BGP::UpdateStats BGP::applyUpdates(const std::vector<fs::path>& paths, TriePair& pair, RoutePeers& peers) {
+    UpdateStats stats;
+    MRT::UpdatePrefixes prefixes;
+
+    // Files are applied in order of paths, so later messages of peer override earlier ones
+    for (const auto& path : paths) {
+        const UpdateStats before = stats;
+
+        MRT::forEachRecord(path, [&](const MRT::RecordHeader& header, const uint8_t* body) {
+            prefixes.announced.clear();
+            prefixes.withdrawn.clear();
+
+            if (!MRT::extractUpdatePrefixes(header, body, prefixes)) {
+                return;
+            }
+
+            ++stats.messagesCount;
+
+            const uint32_t peerIndex = peers.getPeerIndex(prefixes.peer);
+
+            // Withdrawals of message are applied before announcements
+            for (const auto& subnet : prefixes.withdrawn) {
+                std::visit([&](auto &net){
+                    using T = std::decay_t<decltype(net)>;
 
-#ifdef BGPDUMP_HAVE_IPV6
-        if (m.address_family == AFI_IP6) {
-            const bitsetIPv6 ip = Convert::inetv6ToBitset(m.source_ip.v6_addr);
-            const bitsetIPv6 mask = Convert::lengthv6ToBitset(IPV6_BITS_COUNT);
+                    if constexpr (std::is_same_v<T, IPv4Subnet>) {
+                        stats.removedCount += withdrawPeerRoute(pair.v4, peers, peerIndex, net);
+                    } else {
+                        stats.removedCount += withdrawPeerRoute(pair.v6, peers, peerIndex, net);
+                    }
+                }, subnet);
+            }
+
+            for (const auto& subnet : prefixes.announced) {
+                std::visit([&](auto &net){
+                    using T = std::decay_t<decltype(net)>;
+
+                    if constexpr (std::is_same_v<T, IPv4Subnet>) {
+                        announcePeerRoute(pair.v4, peers, peerIndex, net);
+                    } else {
+                        announcePeerRoute(pair.v6, peers, peerIndex, net);
+                    }
+                }, subnet);
+            }
 
-            return IPv6Subnet{ip, mask};
+            stats.announcedCount += prefixes.announced.size();
+            stats.withdrawnCount += prefixes.withdrawn.size();
+        });
+
+        LOG_INFO("BGP updates {} are applied: {} messages, {} announced, {} withdrawn ({} routes removed)",
+            path.string(), stats.messagesCount - before.messagesCount, stats.announcedCount - before.announcedCount,
+            stats.withdrawnCount - before.withdrawnCount, stats.removedCount - before.removedCount);
+    }
+
+    return stats;
+}
+
+std::vector<fs::path> BGP::expandDumpPaths(const std::vector<std::string>& patterns) {
+    std::vector<fs::path> paths;
+
+    for (const auto& pattern : patterns) {
+        glob_t globResult{};
+
+        if (glob(pattern.c_str(), 0, nullptr, &globResult) == 0) {
+            for (size_t i = 0; i < globResult.gl_pathc; ++i) {
+                paths.emplace_back(globResult.gl_pathv[i]);
+            }
+        } else {
+            LOG_WARNING("No BGP dumps are found for path: {}", pattern);
         }
-#endif
+
+        globfree(&globResult);
     }
 
-    // Ничего не нашли
-    return std::nullopt;
-}
\ No newline at end of file
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+
+    return paths;
+}
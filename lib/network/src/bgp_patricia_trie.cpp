@@ -0,0 +1,412 @@
+#include <algorithm>
+#include <limits>
+
+#include "bgp_patricia_trie.hpp"
+#include "trie_batch.hpp"
+
+namespace NetTypes {
+    // ──────────────────────────────────────────────────────────────
+    // ctor
+    // ──────────────────────────────────────────────────────────────
+    template <size_t BITS>
+    BGPPatriciaTrie<BITS>::BGPPatriciaTrie() {
+        m_nodes.allocate(); // root (/0)
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // Utils
+    // ──────────────────────────────────────────────────────────────
+    template <size_t BITS>
+    TrieIndex BGPPatriciaTrie<BITS>::createNode(const Key key, const unsigned len) {
+        const TrieIndex index = m_nodes.allocate();
+        auto& node = m_nodes[index];
+
+        node.key = key & keyMask<BITS>(len);
+        node.len = static_cast<uint8_t>(len);
+
+        return index;
+    }
+
+    template <size_t BITS>
+    void BGPPatriciaTrie<BITS>::setRoute(const TrieIndex index, const Key key, const uint32_t refs) {
+        if (auto& node = m_nodes[index]; node.route == kTrieNoRoute) {
+            node.route = m_routes.allocate();
+        }
+
+        auto& route = m_routes[m_nodes[index].route];
+        route.key = key;
+        route.refs += refs;
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // Insert
+    // ──────────────────────────────────────────────────────────────
+    template <size_t BITS>
+    void BGPPatriciaTrie<BITS>::insert(const IPvxT& subnet, const uint32_t refs) {
+        const Key key = subnet.ip;
+        const unsigned len = subnet.prefix;
+
+        // Root always matches, start from its child
+        TrieIndex parent = 0;
+
+        if (len == 0) {
+            setRoute(parent, key, refs);
+            return;
+        }
+
+        int side = keyBit<BITS>(key, 0);
+
+        while (true) {
+            const TrieIndex cur = m_nodes[parent].child[side];
+
+            if (cur == kTrieNullIndex) {
+                const TrieIndex leaf = createNode(key, len);
+                m_nodes[parent].child[side] = leaf;
+                setRoute(leaf, key, refs);
+                return;
+            }
+
+            const Key curKey = m_nodes[cur].key;
+            const unsigned curLen = m_nodes[cur].len;
+            const unsigned common = std::min({keyCommonPrefix<BITS>(key, curKey), len, curLen});
+
+            if (common < curLen) {
+                // Key diverges inside of edge segment, split it
+                TrieIndex split;
+
+                if (common == len) {
+                    // New prefix is an ancestor of current node
+                    split = createNode(key, len);
+                    setRoute(split, key, refs);
+                } else {
+                    // New branching node with new leaf
+                    const TrieIndex leaf = createNode(key, len);
+                    setRoute(leaf, key, refs);
+
+                    split = createNode(key, common);
+                    m_nodes[split].child[keyBit<BITS>(key, common)] = leaf;
+                }
+
+                m_nodes[split].child[keyBit<BITS>(curKey, common)] = cur;
+                m_nodes[parent].child[side] = split;
+                return;
+            }
+
+            if (curLen == len) {
+                // Exact prefix already exists (may be branching node)
+                setRoute(cur, key, refs);
+                return;
+            }
+
+            parent = cur;
+            side = keyBit<BITS>(key, curLen);
+        }
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // Withdraw
+    // ──────────────────────────────────────────────────────────────
+    template <size_t BITS>
+    bool BGPPatriciaTrie<BITS>::withdraw(const IPvxT& subnet, const uint32_t refs) {
+        const Key key = subnet.ip;
+        const unsigned len = subnet.prefix;
+
+        // Nodes of path (from root) are kept to merge nodes which are not needed anymore
+        std::array<TrieIndex, BITS + 1> path;
+        size_t depth = 0;
+
+        path[depth++] = 0;
+
+        if (len != 0) {
+            TrieIndex cur = m_nodes[0].child[keyBit<BITS>(key, 0)];
+
+            while (true) {
+                if (cur == kTrieNullIndex) {
+                    return false;
+                }
+
+                const Node& node = m_nodes[cur];
+
+                if (node.len > len || (key & keyMask<BITS>(node.len)) != node.key) {
+                    return false;
+                }
+
+                path[depth++] = cur;
+
+                if (node.len == len) {
+                    break;
+                }
+
+                cur = node.child[keyBit<BITS>(key, node.len)];
+            }
+        }
+
+        const TrieIndex target = path[depth - 1];
+        const TrieIndex routeIndex = m_nodes[target].route;
+
+        if (routeIndex == kTrieNoRoute) {
+            return false;
+        }
+
+        if (auto& route = m_routes[routeIndex]; route.refs > refs) {
+            // Route is still announced by other peers
+            route.refs -= refs;
+            return false;
+        }
+
+        m_routes.release(routeIndex);
+        m_nodes[target].route = kTrieNoRoute;
+
+        // Node without route is needed only as a branching point, otherwise
+        // it is replaced by its single child (or removed). Root is kept.
+        for (size_t i = depth - 1; i > 0; --i) {
+            const TrieIndex index = path[i];
+            const TrieIndex parent = path[i - 1];
+            const Node node = m_nodes[index];
+
+            if (node.route != kTrieNoRoute || (node.child[0] != kTrieNullIndex && node.child[1] != kTrieNullIndex)) {
+                break;
+            }
+
+            const TrieIndex replacement = node.child[0] != kTrieNullIndex ? node.child[0] : node.child[1];
+
+            m_nodes[parent].child[keyBit<BITS>(node.key, m_nodes[parent].len)] = replacement;
+            m_nodes.release(index);
+
+            if (replacement != kTrieNullIndex) {
+                // Parent keeps the same count of children
+                break;
+            }
+        }
+
+        return true;
+    }
+
+    template <size_t BITS>
+    bool BGPPatriciaTrie<BITS>::remove(const IPvxT& subnet) {
+        return withdraw(subnet, std::numeric_limits<uint32_t>::max());
+    }
+
+    template <size_t BITS>
+    uint32_t BGPPatriciaTrie<BITS>::getRefs(const IPvxT& subnet) const {
+        const Key key = subnet.ip;
+        const unsigned len = subnet.prefix;
+
+        TrieIndex cur = 0;
+
+        if (len != 0) {
+            cur = m_nodes[0].child[keyBit<BITS>(key, 0)];
+
+            while (true) {
+                if (cur == kTrieNullIndex) {
+                    return 0;
+                }
+
+                const Node& node = m_nodes[cur];
+
+                if (node.len > len || (key & keyMask<BITS>(node.len)) != node.key) {
+                    return 0;
+                }
+
+                if (node.len == len) {
+                    break;
+                }
+
+                cur = node.child[keyBit<BITS>(key, node.len)];
+            }
+        }
+
+        const TrieIndex routeIndex = m_nodes[cur].route;
+
+        return routeIndex == kTrieNoRoute ? 0 : m_routes[routeIndex].refs;
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // Search (LPM)
+    // ──────────────────────────────────────────────────────────────
+    template <size_t BITS>
+    std::optional<typename BGPPatriciaTrie<BITS>::IPvxT>
+    BGPPatriciaTrie<BITS>::lookup(const Key key) const {
+        TrieIndex bestRoute = m_nodes[0].route;
+        unsigned bestLen = 0;
+
+        TrieIndex cur = m_nodes[0].child[keyBit<BITS>(key, 0)];
+
+        while (cur != kTrieNullIndex) {
+            const Node& node = m_nodes[cur];
+
+            // Whole segment of node must match, not only one bit
+            if ((key & keyMask<BITS>(node.len)) != node.key) {
+                break;
+            }
+
+            if (node.route != kTrieNoRoute) {
+                bestRoute = node.route;
+                bestLen = node.len;
+            }
+
+            if (node.len == BITS) {
+                break;
+            }
+
+            cur = node.child[keyBit<BITS>(key, node.len)];
+        }
+
+        if (bestRoute == kTrieNoRoute) {
+            return std::nullopt;
+        }
+
+        return IPvxT{m_routes[bestRoute].key, static_cast<uint8_t>(bestLen)};
+    }
+
+    template <size_t BITS>
+    void BGPPatriciaTrie<BITS>::lookupBatch(const std::vector<Key>& ips, std::vector<std::optional<IPvxT>>& results) const {
+        struct Lane {
+            Key key;
+            size_t slot;
+            TrieIndex cur;
+            TrieIndex bestRoute;
+            unsigned bestLen;
+        };
+
+        results.assign(ips.size(), std::nullopt);
+
+        runInterleavedLookups<Lane>(ips.size(),
+            [&](Lane& lane, const size_t slot) {
+                const Key key = ips[slot];
+                lane = {key, slot, m_nodes[0].child[keyBit<BITS>(key, 0)], m_nodes[0].route, 0};
+                prefetchNode(&m_nodes[lane.cur]);
+            },
+            [&](Lane& lane) {
+                if (lane.cur == kTrieNullIndex) {
+                    return false;
+                }
+
+                const Node& node = m_nodes[lane.cur];
+
+                if ((lane.key & keyMask<BITS>(node.len)) != node.key) {
+                    return false;
+                }
+
+                if (node.route != kTrieNoRoute) {
+                    lane.bestRoute = node.route;
+                    lane.bestLen = node.len;
+                }
+
+                if (node.len == BITS) {
+                    return false;
+                }
+
+                lane.cur = node.child[keyBit<BITS>(lane.key, node.len)];
+                prefetchNode(&m_nodes[lane.cur]);
+
+                return true;
+            },
+            [&](const Lane& lane) {
+                if (lane.bestRoute != kTrieNoRoute) {
+                    results[lane.slot] = IPvxT{m_routes[lane.bestRoute].key, static_cast<uint8_t>(lane.bestLen)};
+                }
+            });
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // Other
+    // ──────────────────────────────────────────────────────────────
+    template <size_t BITS>
+    bool BGPPatriciaTrie<BITS>::isEmpty() const {
+        return m_nodes[0].route == kTrieNoRoute && m_nodes[0].child[0] == kTrieNullIndex && m_nodes[0].child[1] == kTrieNullIndex;
+    }
+
+    template <size_t BITS>
+    size_t BGPPatriciaTrie<BITS>::getAllocatedBytes() const {
+        return m_nodes.getAllocatedBytes() + m_routes.getAllocatedBytes();
+    }
+
+    template <size_t BITS>
+    TrieStats BGPPatriciaTrie<BITS>::getStats(const size_t samplesCount) const {
+        TrieStats stats;
+        TrieStatsSampler<Key> sampler(m_routes.getUsedCount(), samplesCount);
+
+        stats.allocatedBytes = getAllocatedBytes();
+        stats.depthHistogram.assign(BITS + 1, 0);
+
+        // Depth is a count of nodes passed from root, not a length of prefix
+        std::vector<std::pair<TrieIndex, unsigned>> stack;
+        stack.emplace_back(0, 0);
+
+        while (!stack.empty()) {
+            const auto [index, depth] = stack.back();
+            stack.pop_back();
+
+            const Node& node = m_nodes[index];
+            ++stats.nodesCount;
+
+            if (node.route != kTrieNoRoute) {
+                ++stats.routesCount;
+                ++stats.depthHistogram[depth];
+                sampler.addRoute(m_routes[node.route].key);
+            }
+
+            for (const TrieIndex child : node.child) {
+                if (child != kTrieNullIndex) {
+                    stack.emplace_back(child, depth + 1);
+                }
+            }
+        }
+
+        sampler.measure(stats, [this](const Key key) { return getLookupDepth(key); });
+
+        return stats;
+    }
+
+    template <size_t BITS>
+    unsigned BGPPatriciaTrie<BITS>::getLookupDepth(const Key key) const {
+        TrieIndex cur = m_nodes[0].child[keyBit<BITS>(key, 0)];
+        unsigned depth = 1;
+
+        while (cur != kTrieNullIndex) {
+            const Node& node = m_nodes[cur];
+            ++depth;
+
+            if ((key & keyMask<BITS>(node.len)) != node.key || node.len == BITS) {
+                break;
+            }
+
+            cur = node.child[keyBit<BITS>(key, node.len)];
+        }
+
+        return depth;
+    }
+
+    template <size_t BITS>
+    void BGPPatriciaTrie<BITS>::forEachRoute(const std::function<void(const IPvxT&)>& callback) const {
+        forEachRouteWithRefs([&callback](const IPvxT& subnet, uint32_t) { callback(subnet); });
+    }
+
+    template <size_t BITS>
+    void BGPPatriciaTrie<BITS>::forEachRouteWithRefs(const std::function<void(const IPvxT&, uint32_t)>& callback) const {
+        // Every node keeps its length, so arena is walked without recursion
+        for (size_t i = 0; i < m_nodes.size(); ++i) {
+            const Node& node = m_nodes[static_cast<TrieIndex>(i)];
+
+            if (node.route != kTrieNoRoute) {
+                const Route& route = m_routes[node.route];
+                callback(IPvxT{route.key, static_cast<uint8_t>(node.len)}, route.refs);
+            }
+        }
+    }
+
+    template <size_t BITS>
+    bool BGPPatriciaTrie<BITS>::attachStorage(const std::array<TrieArenaView, 2>& views) {
+        // Root must be present, layout of elements must be the same
+        if (views[0].count == 0 || views[0].itemSize != sizeof(Node) || views[1].itemSize != sizeof(Route)) {
+            return false;
+        }
+
+        return m_nodes.attach(views[0]) && m_routes.attach(views[1]);
+    }
+
+    // Explicit instantiation for compilation
+    template class BGPPatriciaTrie<IPV4_BITS_COUNT>;
+    template class BGPPatriciaTrie<IPV6_BITS_COUNT>;
+}
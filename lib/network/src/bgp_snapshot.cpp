@@ -0,0 +1,328 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+#include "bgp_snapshot.hpp"
+#include "fs_utils_mmap.hpp"
+#include "log.hpp"
+
+using namespace NetTypes;
+using namespace NetUtils;
+
+namespace {
+    constexpr std::array<char, 8> kSnapshotMagic = {'R', 'G', 'L', 'C', 'B', 'G', 'P', '\0'};
+
+    // Must be increased on any change of header or node layout
+    constexpr uint32_t kSnapshotVersion = 3u;
+
+    // Sections are aligned, so 128-bit keys can be read from mapped memory directly
+    constexpr uint64_t kSectionAlign = 64u;
+
+    constexpr size_t kFingerprintSampleSize = 64u * 1024u;
+
+    // v4 nodes, v4 routes, v6 nodes, v6 routes, then peers: table, v4 routes, v6 routes, indexes
+    constexpr size_t kSectionsCount = 8u;
+
+    // Snapshot has peers of routes
+    constexpr uint64_t kSnapshotFlagPeers = 1u;
+
+    // Peers of one route, their indexes are stored in section of indexes
+    template <size_t BITS>
+    struct SnapshotRoutePeers {
+        TrieKey<BITS> key;
+        uint64_t firstIndex;
+        uint32_t count;
+        uint8_t prefix;
+    };
+
+    static_assert(std::is_trivially_copyable_v<MRT::Peer>, "Peers are written in native layout");
+
+    // RoutePeers in layout of snapshot sections
+    struct FlatRoutePeers {
+        std::vector<SnapshotRoutePeers<IPV4_BITS_COUNT>> v4;
+        std::vector<SnapshotRoutePeers<IPV6_BITS_COUNT>> v6;
+        std::vector<uint32_t> indexes;
+    };
+
+    struct SnapshotSection {
+        uint64_t offset;
+        uint64_t count;
+        uint64_t itemSize;
+    };
+
+    struct SnapshotHeader {
+        std::array<char, 8> magic;
+        uint32_t version;
+        uint32_t trieType;
+        uint64_t dumpSize;
+        int64_t dumpMtime;
+        uint64_t dumpHash;
+        uint64_t flags;
+        std::array<SnapshotSection, kSectionsCount> sections;
+    };
+
+    uint64_t hashFNV1a(const char* data, const size_t size, uint64_t hash) {
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= static_cast<uint8_t>(data[i]);
+            hash *= 0x100000001b3ull;
+        }
+
+        return hash;
+    }
+
+    uint64_t alignOffset(const uint64_t offset) {
+        return (offset + kSectionAlign - 1) / kSectionAlign * kSectionAlign;
+    }
+
+    template <size_t BITS, typename Routes>
+    void flattenRoutes(const Routes& routes, std::vector<SnapshotRoutePeers<BITS>>& out, std::vector<uint32_t>& indexes) {
+        out.reserve(routes.size());
+
+        for (const auto& [key, routeIndexes] : routes) {
+            out.push_back({key.first, indexes.size(), static_cast<uint32_t>(routeIndexes.size()), key.second});
+            indexes.insert(indexes.end(), routeIndexes.begin(), routeIndexes.end());
+        }
+    }
+
+    // Routes are written in order of map, so they are appended to the end. False if indexes are broken
+    template <size_t BITS, typename Routes>
+    bool unflattenRoutes(const TrieArenaView& entries, const TrieArenaView& indexes, const size_t peersCount, Routes& out) {
+        const auto* entriesData = static_cast<const SnapshotRoutePeers<BITS>*>(entries.data);
+        const auto* indexesData = static_cast<const uint32_t*>(indexes.data);
+
+        for (size_t i = 0; i < entries.count; ++i) {
+            const auto& entry = entriesData[i];
+
+            if (entry.firstIndex > indexes.count || entry.count > indexes.count - entry.firstIndex) {
+                return false;
+            }
+
+            const uint32_t* first = indexesData + entry.firstIndex;
+            const uint32_t* last = first + entry.count;
+
+            if (std::any_of(first, last, [peersCount](const uint32_t index) { return index >= peersCount; })) {
+                return false;
+            }
+
+            out.emplace_hint(out.end(), std::make_pair(entry.key, entry.prefix), std::vector<uint32_t>(first, last));
+        }
+
+        return true;
+    }
+}
+
+BGP::DumpFingerprint BGP::getDumpFingerprint(const std::vector<fs::path>& dumpPaths) {
+    DumpFingerprint fingerprint;
+    std::vector<char> buffer(kFingerprintSampleSize);
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (const auto& dumpPath : dumpPaths) {
+        const uint64_t size = fs::file_size(dumpPath);
+
+        fingerprint.size += size;
+        fingerprint.mtime = std::max<int64_t>(fingerprint.mtime, fs::last_write_time(dumpPath).time_since_epoch().count());
+
+        std::ifstream file(dumpPath, std::ios::binary);
+
+        if (!file.is_open()) {
+            throw std::ios_base::failure(FILE_OPEN_ERROR_MSG + dumpPath.string());
+        }
+
+        // Whole dump is not read, mtime and size are checked too
+        const std::array<uint64_t, 3> sampleOffsets = {
+            0,
+            size / 2,
+            size > kFingerprintSampleSize ? size - kFingerprintSampleSize : 0
+        };
+
+        for (const uint64_t offset : sampleOffsets) {
+            file.clear();
+            file.seekg(static_cast<std::streamoff>(offset));
+            file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+
+            hash = hashFNV1a(buffer.data(), static_cast<size_t>(file.gcount()), hash);
+        }
+    }
+
+    fingerprint.sampleHash = hash;
+
+    return fingerprint;
+}
+
+fs::path BGP::getSnapshotPath(const fs::path& dir, const std::vector<fs::path>& dumpPaths, const BGPTrieType type) {
+    uint64_t pathHash = 0xcbf29ce484222325ull;
+
+    for (const auto& dumpPath : dumpPaths) {
+        const std::string absPath = fs::absolute(dumpPath).lexically_normal().string() + '\n';
+        pathHash = hashFNV1a(absPath.data(), absPath.size(), pathHash);
+    }
+
+    const char* typeName = type == BGPTrieType::RADIX ? "radix" : "patricia";
+
+    return dir / fmt::format("{:016x}_{}.snapshot", pathHash, typeName);
+}
+
+void BGP::writeSnapshot(const fs::path& path, const TriePair& pair, const DumpFingerprint& fingerprint,
+                        const RoutePeers* peers) {
+    const auto v4Views = pair.v4.getStorageViews();
+    const auto v6Views = pair.v6.getStorageViews();
+
+    FlatRoutePeers flatPeers;
+
+    if (peers != nullptr) {
+        flattenRoutes<IPV4_BITS_COUNT>(peers->v4, flatPeers.v4, flatPeers.indexes);
+        flattenRoutes<IPV6_BITS_COUNT>(peers->v6, flatPeers.v6, flatPeers.indexes);
+    }
+
+    const std::array<TrieArenaView, kSectionsCount> views = {
+        v4Views[0], v4Views[1], v6Views[0], v6Views[1],
+        TrieArenaView{peers != nullptr ? peers->peers.data() : nullptr, peers != nullptr ? peers->peers.size() : 0, sizeof(MRT::Peer)},
+        TrieArenaView{flatPeers.v4.data(), flatPeers.v4.size(), sizeof(SnapshotRoutePeers<IPV4_BITS_COUNT>)},
+        TrieArenaView{flatPeers.v6.data(), flatPeers.v6.size(), sizeof(SnapshotRoutePeers<IPV6_BITS_COUNT>)},
+        TrieArenaView{flatPeers.indexes.data(), flatPeers.indexes.size(), sizeof(uint32_t)}
+    };
+
+    SnapshotHeader header{};
+    header.magic = kSnapshotMagic;
+    header.version = kSnapshotVersion;
+    header.trieType = static_cast<uint32_t>(pair.v4.getType());
+    header.dumpSize = fingerprint.size;
+    header.dumpMtime = fingerprint.mtime;
+    header.dumpHash = fingerprint.sampleHash;
+    header.flags = peers != nullptr ? kSnapshotFlagPeers : 0;
+
+    uint64_t offset = alignOffset(sizeof(SnapshotHeader));
+
+    for (size_t i = 0; i < kSectionsCount; ++i) {
+        header.sections[i] = {offset, views[i].count, views[i].itemSize};
+        offset = alignOffset(offset + views[i].count * views[i].itemSize);
+    }
+
+    if (path.has_parent_path()) {
+        fs::create_directories(path.parent_path());
+    }
+
+    // Readers never see partially written snapshot
+    const fs::path tempPath = path.string() + ".tmp";
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+
+    if (!file.is_open()) {
+        throw std::ios_base::failure(FILE_OPEN_ERROR_MSG + tempPath.string());
+    }
+
+    const std::array<char, kSectionAlign> padding{};
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    for (size_t i = 0; i < kSectionsCount; ++i) {
+        file.write(padding.data(), static_cast<std::streamsize>(header.sections[i].offset - file.tellp()));
+        file.write(static_cast<const char*>(views[i].data), static_cast<std::streamsize>(views[i].count * views[i].itemSize));
+    }
+
+    file.close();
+
+    if (!file) {
+        fs::remove(tempPath);
+        throw std::ios_base::failure("Failed to write BGP snapshot on path: " + path.string());
+    }
+
+    fs::rename(tempPath, path);
+}
+
+bool BGP::loadSnapshot(const fs::path& path, TriePair& outPair, const DumpFingerprint& fingerprint,
+                       RoutePeers* outPeers) {
+    if (!fs::exists(path)) {
+        return false;
+    }
+
+    auto mapped = std::make_unique<FS::Utils::MappedFile>(path);
+
+    if (mapped->size() < sizeof(SnapshotHeader)) {
+        LOG_WARNING("BGP snapshot is too small and will be rebuilt: {}", path.string());
+        return false;
+    }
+
+    SnapshotHeader header{};
+    std::memcpy(&header, mapped->data(), sizeof(header));
+
+    if (header.magic != kSnapshotMagic || header.version != kSnapshotVersion) {
+        LOG_WARNING("BGP snapshot has unsupported format and will be rebuilt: {}", path.string());
+        return false;
+    }
+
+    const DumpFingerprint snapshotFingerprint{header.dumpSize, header.dumpMtime, header.dumpHash};
+
+    if (header.trieType != static_cast<uint32_t>(outPair.v4.getType()) || !(snapshotFingerprint == fingerprint)) {
+        // Dump was changed since snapshot was written
+        return false;
+    }
+
+    if (outPeers != nullptr && (header.flags & kSnapshotFlagPeers) == 0) {
+        // Snapshot was written without updates, peers of routes are collected by parsing of dump
+        return false;
+    }
+
+    // Views of empty tries give expected size of elements
+    const auto v4Views = outPair.v4.getStorageViews();
+    const auto v6Views = outPair.v6.getStorageViews();
+
+    const std::array<size_t, kSectionsCount> itemSizes = {
+        v4Views[0].itemSize, v4Views[1].itemSize, v6Views[0].itemSize, v6Views[1].itemSize,
+        sizeof(MRT::Peer), sizeof(SnapshotRoutePeers<IPV4_BITS_COUNT>), sizeof(SnapshotRoutePeers<IPV6_BITS_COUNT>), sizeof(uint32_t)
+    };
+
+    std::array<TrieArenaView, kSectionsCount> views;
+
+    for (size_t i = 0; i < kSectionsCount; ++i) {
+        const auto& section = header.sections[i];
+
+        if (section.itemSize != itemSizes[i]) {
+            LOG_WARNING("BGP snapshot does not match layout of tries and will be rebuilt: {}", path.string());
+            return false;
+        }
+
+        if (section.offset % kSectionAlign != 0 ||
+            section.offset > mapped->size() ||
+            section.count * section.itemSize > mapped->size() - section.offset) {
+            LOG_WARNING("BGP snapshot is broken and will be rebuilt: {}", path.string());
+            return false;
+        }
+
+        views[i] = {mapped->data() + section.offset, section.count, section.itemSize};
+    }
+
+    // Root node is always present
+    if (views[0].count == 0 || views[2].count == 0) {
+        LOG_WARNING("BGP snapshot is broken and will be rebuilt: {}", path.string());
+        return false;
+    }
+
+    if (outPeers != nullptr) {
+        // Peers are small comparing to tries, so they are copied to maps used by updates
+        RoutePeers peers;
+        const auto* peersData = static_cast<const MRT::Peer*>(views[4].data);
+
+        peers.peers.assign(peersData, peersData + views[4].count);
+
+        for (size_t i = 0; i < peers.peers.size(); ++i) {
+            peers.peerIndexes.emplace(peers.peers[i], static_cast<uint32_t>(i));
+        }
+
+        if (!unflattenRoutes<IPV4_BITS_COUNT>(views[5], views[7], peers.peers.size(), peers.v4) ||
+            !unflattenRoutes<IPV6_BITS_COUNT>(views[6], views[7], peers.peers.size(), peers.v6)) {
+            LOG_WARNING("BGP snapshot is broken and will be rebuilt: {}", path.string());
+            return false;
+        }
+
+        *outPeers = std::move(peers);
+    }
+
+    outPair.v4.attachStorage({views[0], views[1]});
+    outPair.v6.attachStorage({views[2], views[3]});
+
+    outPair.snapshot = std::move(mapped);
+
+    return true;
+}
@@ -0,0 +1,164 @@
+#include <algorithm>
+
+#include "bgp_tree_bitmap.hpp"
+#include "bgp_trie.hpp"
+
+namespace NetTypes {
+    // ──────────────────────────────────────────────────────────────
+    // Bitmap utils
+    // ──────────────────────────────────────────────────────────────
+    template <typename T>
+    static bool testBit(const T& bitmap, const unsigned pos) {
+        return (bitmap[pos >> 6] >> (pos & 63u)) & 1u;
+    }
+
+    template <typename T>
+    static void setBit(T& bitmap, const unsigned pos) {
+        bitmap[pos >> 6] |= uint64_t{1} << (pos & 63u);
+    }
+
+    // Count of set bits before position
+    template <typename T>
+    static unsigned rankBit(const T& bitmap, const unsigned pos) {
+        unsigned count = 0;
+
+        for (unsigned word = 0; word < (pos >> 6); ++word) {
+            count += __builtin_popcountll(bitmap[word]);
+        }
+
+        if (const unsigned rest = pos & 63u) {
+            count += __builtin_popcountll(bitmap[pos >> 6] & ((uint64_t{1} << rest) - 1));
+        }
+
+        return count;
+    }
+
+    // 8-bit chunk of key for node depth
+    static unsigned getChunk(const uint128 key, const unsigned depth) {
+        return static_cast<unsigned>(key >> (IPV6_BITS_COUNT - IPv6TreeBitmap::kStride * (depth + 1))) & 0xFFu;
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // Build
+    // ──────────────────────────────────────────────────────────────
+    IPv6TreeBitmap::IPv6TreeBitmap(const BGPTrie<IPV6_BITS_COUNT>& trie) {
+        trie.forEachRoute([this](const IPv6Subnet& subnet) {
+            m_routes.push_back({subnet.ip, subnet.prefix});
+        });
+
+        std::vector<uint32_t> routes(m_routes.size());
+        for (uint32_t i = 0; i < routes.size(); ++i) {
+            routes[i] = i;
+        }
+
+        m_nodes.emplace_back(); // root
+        buildNode(0, 0, routes);
+    }
+
+    void IPv6TreeBitmap::buildNode(const uint32_t index, const unsigned depth, const std::vector<uint32_t>& routes) {
+        const unsigned nodeLen = depth * kStride;
+
+        std::vector<std::pair<unsigned, uint32_t>> internal;
+        std::array<std::vector<uint32_t>, 1u << kStride> children;
+
+        for (const uint32_t routeIndex : routes) {
+            const auto& route = m_routes[routeIndex];
+            const unsigned localLen = route.len - nodeLen;
+
+            if (localLen < kStride) {
+                // Prefix ends inside of this node
+                const unsigned value = (localLen == 0) ? 0u : (getChunk(route.key, depth) >> (kStride - localLen));
+                internal.emplace_back((1u << localLen) - 1 + value, routeIndex);
+            } else {
+                children[getChunk(route.key, depth)].push_back(routeIndex);
+            }
+        }
+
+        // Results are ordered by position in internal bitmap
+        std::sort(internal.begin(), internal.end());
+
+        Node node;
+        node.resultBase = static_cast<uint32_t>(m_results.size());
+
+        for (const auto& [pos, routeIndex] : internal) {
+            setBit(node.internal, pos);
+            m_results.push_back(routeIndex);
+        }
+
+        // Children of node are allocated as one block before going deeper
+        node.childBase = static_cast<uint32_t>(m_nodes.size());
+
+        uint32_t childrenCount = 0;
+        for (unsigned chunk = 0; chunk < children.size(); ++chunk) {
+            if (!children[chunk].empty()) {
+                setBit(node.external, chunk);
+                ++childrenCount;
+            }
+        }
+
+        m_nodes[index] = node;
+        m_nodes.resize(m_nodes.size() + childrenCount);
+
+        uint32_t child = node.childBase;
+        for (const auto& childRoutes : children) {
+            if (!childRoutes.empty()) {
+                buildNode(child++, depth + 1, childRoutes);
+            }
+        }
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // Search (LPM)
+    // ──────────────────────────────────────────────────────────────
+    std::optional<IPv6Subnet> IPv6TreeBitmap::lookup(const addrIPv6 key) const {
+        const Node* node = &m_nodes[0];
+        const uint32_t* best = nullptr;
+
+        for (unsigned depth = 0;; ++depth) {
+            // Node on the last level only holds /128 prefixes with local length 0
+            const bool isLast = (depth == kMaxDepth);
+            const unsigned chunk = isLast ? 0u : getChunk(key, depth);
+
+            for (int localLen = isLast ? 0 : kStride - 1; localLen >= 0; --localLen) {
+                const unsigned pos = (1u << localLen) - 1 + (chunk >> (kStride - localLen));
+
+                if (testBit(node->internal, pos)) {
+                    best = &m_results[node->resultBase + rankBit(node->internal, pos)];
+                    break;
+                }
+            }
+
+            if (isLast || !testBit(node->external, chunk)) {
+                break;
+            }
+
+            node = &m_nodes[node->childBase + rankBit(node->external, chunk)];
+        }
+
+        if (best == nullptr) {
+            return std::nullopt;
+        }
+
+        const auto& route = m_routes[*best];
+
+        return IPv6Subnet{route.key, static_cast<uint8_t>(route.len)};
+    }
+
+    void IPv6TreeBitmap::lookupBatch(const std::vector<addrIPv6>& ips, std::vector<std::optional<IPv6Subnet>>& results) const {
+        // Tree Bitmap walk is short (at most 17 nodes), plain loop is used
+        results.resize(ips.size());
+
+        for (size_t i = 0; i < ips.size(); ++i) {
+            results[i] = lookup(ips[i]);
+        }
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // Other
+    // ──────────────────────────────────────────────────────────────
+    size_t IPv6TreeBitmap::getAllocatedBytes() const {
+        return m_nodes.capacity() * sizeof(Node) +
+            m_results.capacity() * sizeof(uint32_t) +
+            m_routes.capacity() * sizeof(Route);
+    }
+}
@@ -1,70 +1,122 @@
-#include <array>
+#include <limits>
+#include <stdexcept>
 
 #include "bgp_trie.hpp"
+#include "trie_batch.hpp"
 
 namespace NetTypes {
     // ──────────────────────────────────────────────────────────────
-    // Внутренняя структура Node
+    // ctor
     // ──────────────────────────────────────────────────────────────
     template <size_t BITS>
-    struct BGPRadixTrie<BITS>::Node {
-        std::array<Node*, 2> child{nullptr, nullptr};
-        std::optional<IPvxT> route;
-        ~Node() { delete child[0]; delete child[1]; }
-    };
+    BGPRadixTrie<BITS>::BGPRadixTrie() {
+        m_nodes.allocate(); // root
+    }
 
     // ──────────────────────────────────────────────────────────────
-    // ctor/~ctor
+    // Insert
     // ──────────────────────────────────────────────────────────────
     template <size_t BITS>
-    BGPRadixTrie<BITS>::BGPRadixTrie() : root(new Node()) {}
+    void BGPRadixTrie<BITS>::insert(const IPvxT& subnet, const uint32_t refs) {
+        const Key key = subnet.ip;
+        const unsigned prefixLen = subnet.prefix;
 
-    template <size_t BITS>
-    BGPRadixTrie<BITS>::~BGPRadixTrie() { delete root; }
+        TrieIndex cur = 0;
 
-    // ──────────────────────────────────────────────────────────────
-    // Utils
-    // ──────────────────────────────────────────────────────────────
-    template <size_t BITS>
-    int BGPRadixTrie<BITS>::getMaskLength(const Bitset& mask) {
-        int n = 0;
-        for (int i = 0; i < BITS; ++i) {
-            if (!mask.test(BITS - 1 - i)) {
-                break;
+        for (unsigned pos = 0; pos < prefixLen; ++pos) {
+            const int bit = keyBit<BITS>(key, pos);
+
+            if (m_nodes[cur].child[bit] == kTrieNullIndex) {
+                // Arena may be reallocated, so index is saved before access
+                const TrieIndex created = m_nodes.allocate();
+                m_nodes[cur].child[bit] = created;
             }
-            ++n;
+
+            cur = m_nodes[cur].child[bit];
         }
-        return n;
+
+        // Save route when prefix is passed (or it is /32, /128)
+        if (auto& node = m_nodes[cur]; node.route == kTrieNoRoute) {
+            node.route = m_routes.allocate();
+        }
+
+        auto& route = m_routes[m_nodes[cur].route];
+        route.key = key;
+        route.refs += refs;
     }
 
     // ──────────────────────────────────────────────────────────────
-    // Insert
+    // Withdraw
     // ──────────────────────────────────────────────────────────────
     template <size_t BITS>
-    void BGPRadixTrie<BITS>::insert(const IPvxT& subnet) {
-        Node* cur = root;
+    bool BGPRadixTrie<BITS>::withdraw(const IPvxT& subnet, const uint32_t refs) {
+        const Key key = subnet.ip;
+        const unsigned prefixLen = subnet.prefix;
 
-        const int prefix_len = getMaskLength(subnet.mask);
+        // Nodes of path are kept to remove empty tail after route
+        std::array<TrieIndex, BITS + 1> path;
+        path[0] = 0;
 
-        int bit_index = 0;
-        for (int i = BITS - 1; i >= 0; --i, ++bit_index) {
+        for (unsigned pos = 0; pos < prefixLen; ++pos) {
+            const TrieIndex next = m_nodes[path[pos]].child[keyBit<BITS>(key, pos)];
 
-            // If we already passed prefix, then save
-            if (bit_index >= prefix_len) {
-                cur->route = subnet;
-                return;
+            if (next == kTrieNullIndex) {
+                return false;
             }
 
-            int bit = subnet.ip.test(i) ? 1 : 0;
+            path[pos + 1] = next;
+        }
+
+        const TrieIndex routeIndex = m_nodes[path[prefixLen]].route;
 
-            if (!cur->child[bit]) {
-                cur->child[bit] = new Node();
+        if (routeIndex == kTrieNoRoute) {
+            return false;
+        }
+
+        if (auto& route = m_routes[routeIndex]; route.refs > refs) {
+            // Route is still announced by other peers
+            route.refs -= refs;
+            return false;
+        }
+
+        m_routes.release(routeIndex);
+        m_nodes[path[prefixLen]].route = kTrieNoRoute;
+
+        // Nodes without route and children are not needed anymore (root is kept)
+        for (unsigned depth = prefixLen; depth > 0; --depth) {
+            const Node& node = m_nodes[path[depth]];
+
+            if (node.route != kTrieNoRoute || node.child[0] != kTrieNullIndex || node.child[1] != kTrieNullIndex) {
+                break;
             }
-            cur = cur->child[bit];
+
+            m_nodes[path[depth - 1]].child[keyBit<BITS>(key, depth - 1)] = kTrieNullIndex;
+            m_nodes.release(path[depth]);
         }
 
-        // If prefix is /32 or /128
-        cur->route = subnet;
+        return true;
+    }
+
+    template <size_t BITS>
+    bool BGPRadixTrie<BITS>::remove(const IPvxT& subnet) {
+        return withdraw(subnet, std::numeric_limits<uint32_t>::max());
+    }
+
+    template <size_t BITS>
+    uint32_t BGPRadixTrie<BITS>::getRefs(const IPvxT& subnet) const {
+        TrieIndex cur = 0;
+
+        for (unsigned pos = 0; pos < subnet.prefix; ++pos) {
+            cur = m_nodes[cur].child[keyBit<BITS>(subnet.ip, pos)];
+
+            if (cur == kTrieNullIndex) {
+                return 0;
+            }
+        }
+
+        const TrieIndex routeIndex = m_nodes[cur].route;
+
+        return routeIndex == kTrieNoRoute ? 0 : m_routes[routeIndex].refs;
     }
 
     // ──────────────────────────────────────────────────────────────
@@ -72,30 +124,87 @@ namespace NetTypes {
     // ──────────────────────────────────────────────────────────────
     template <size_t BITS>
     std::optional<typename BGPRadixTrie<BITS>::IPvxT>
-    BGPRadixTrie<BITS>::lookup(const Bitset& ip) const {
-        Node* cur = root;
-        std::optional<IPvxT> best;
-
-        // обходим биты от старшего к младшему (BITS-1..0)
-        for (int i = BITS - 1; i >= 0; --i) {
-            if (cur->route) {
-                best = cur->route;
+    BGPRadixTrie<BITS>::lookup(const Key key) const {
+        TrieIndex cur = 0;
+        TrieIndex bestRoute = kTrieNoRoute;
+        unsigned bestLen = 0;
+        unsigned pos = 0;
+
+        // Walk bits from the most significant one
+        for (;; ++pos) {
+            const Node& node = m_nodes[cur];
+
+            if (node.route != kTrieNoRoute) {
+                bestRoute = node.route;
+                bestLen = pos;
+            }
+
+            if (pos == BITS) {
+                break;
             }
 
-            int bit = ip[i] ? 1 : 0;
+            const TrieIndex next = node.child[keyBit<BITS>(key, pos)];
 
-            if (!cur->child[bit]) {
+            if (next == kTrieNullIndex) {
                 break;
             }
 
-            cur = cur->child[bit];
+            cur = next;
         }
 
-        if (cur->route) {
-            best = cur->route;
+        if (bestRoute == kTrieNoRoute) {
+            return std::nullopt;
         }
 
-        return best;
+        return IPvxT{m_routes[bestRoute].key, static_cast<uint8_t>(bestLen)};
+    }
+
+    template <size_t BITS>
+    void BGPRadixTrie<BITS>::lookupBatch(const std::vector<Key>& ips, std::vector<std::optional<IPvxT>>& results) const {
+        struct Lane {
+            Key key;
+            size_t slot;
+            TrieIndex cur;
+            TrieIndex bestRoute;
+            unsigned bestLen;
+            unsigned pos;
+        };
+
+        results.assign(ips.size(), std::nullopt);
+
+        runInterleavedLookups<Lane>(ips.size(),
+            [&](Lane& lane, const size_t slot) {
+                lane = {ips[slot], slot, 0, kTrieNoRoute, 0, 0};
+            },
+            [&](Lane& lane) {
+                const Node& node = m_nodes[lane.cur];
+
+                if (node.route != kTrieNoRoute) {
+                    lane.bestRoute = node.route;
+                    lane.bestLen = lane.pos;
+                }
+
+                if (lane.pos == BITS) {
+                    return false;
+                }
+
+                const TrieIndex next = node.child[keyBit<BITS>(lane.key, lane.pos)];
+
+                if (next == kTrieNullIndex) {
+                    return false;
+                }
+
+                lane.cur = next;
+                ++lane.pos;
+                prefetchNode(&m_nodes[next]);
+
+                return true;
+            },
+            [&](const Lane& lane) {
+                if (lane.bestRoute != kTrieNoRoute) {
+                    results[lane.slot] = IPvxT{m_routes[lane.bestRoute].key, static_cast<uint8_t>(lane.bestLen)};
+                }
+            });
     }
 
     // ──────────────────────────────────────────────────────────────
@@ -103,15 +212,288 @@ namespace NetTypes {
     // ──────────────────────────────────────────────────────────────
     template <size_t BITS>
     bool BGPRadixTrie<BITS>::isEmpty() const {
-        return root->child[0] == nullptr && root->child[1] == nullptr;
+        return m_nodes[0].route == kTrieNoRoute && m_nodes[0].child[0] == kTrieNullIndex && m_nodes[0].child[1] == kTrieNullIndex;
+    }
+
+    template <size_t BITS>
+    size_t BGPRadixTrie<BITS>::getAllocatedBytes() const {
+        return m_nodes.getAllocatedBytes() + m_routes.getAllocatedBytes();
+    }
+
+    template <size_t BITS>
+    TrieStats BGPRadixTrie<BITS>::getStats(const size_t samplesCount) const {
+        TrieStats stats;
+        TrieStatsSampler<Key> sampler(m_routes.getUsedCount(), samplesCount);
+
+        stats.allocatedBytes = getAllocatedBytes();
+        stats.depthHistogram.assign(BITS + 1, 0);
+
+        std::vector<std::pair<TrieIndex, unsigned>> stack;
+        stack.emplace_back(0, 0);
+
+        while (!stack.empty()) {
+            const auto [index, depth] = stack.back();
+            stack.pop_back();
+
+            const Node& node = m_nodes[index];
+            ++stats.nodesCount;
+
+            if (node.route != kTrieNoRoute) {
+                ++stats.routesCount;
+                ++stats.depthHistogram[depth];
+                sampler.addRoute(m_routes[node.route].key);
+            }
+
+            for (const TrieIndex child : node.child) {
+                if (child != kTrieNullIndex) {
+                    stack.emplace_back(child, depth + 1);
+                }
+            }
+        }
+
+        sampler.measure(stats, [this](const Key key) { return getLookupDepth(key); });
+
+        return stats;
+    }
+
+    template <size_t BITS>
+    unsigned BGPRadixTrie<BITS>::getLookupDepth(const Key key) const {
+        TrieIndex cur = 0;
+        unsigned depth = 1;
+
+        for (unsigned pos = 0; pos < BITS; ++pos) {
+            cur = m_nodes[cur].child[keyBit<BITS>(key, pos)];
+
+            if (cur == kTrieNullIndex) {
+                break;
+            }
+
+            ++depth;
+        }
+
+        return depth;
+    }
+
+    template <size_t BITS>
+    void BGPRadixTrie<BITS>::forEachRoute(const std::function<void(const IPvxT&)>& callback) const {
+        forEachRouteWithRefs([&callback](const IPvxT& subnet, uint32_t) { callback(subnet); });
+    }
+
+    template <size_t BITS>
+    void BGPRadixTrie<BITS>::forEachRouteWithRefs(const std::function<void(const IPvxT&, uint32_t)>& callback) const {
+        // Depth of node is a length of its prefix, so it is kept in stack
+        std::vector<std::pair<TrieIndex, unsigned>> stack;
+        stack.emplace_back(0, 0);
+
+        while (!stack.empty()) {
+            const auto [index, depth] = stack.back();
+            stack.pop_back();
+
+            const Node& node = m_nodes[index];
+
+            if (node.route != kTrieNoRoute) {
+                const Route& route = m_routes[node.route];
+                callback(IPvxT{route.key, static_cast<uint8_t>(depth)}, route.refs);
+            }
+
+            for (const TrieIndex child : node.child) {
+                if (child != kTrieNullIndex) {
+                    stack.emplace_back(child, depth + 1);
+                }
+            }
+        }
+    }
+
+    template <size_t BITS>
+    bool BGPRadixTrie<BITS>::attachStorage(const std::array<TrieArenaView, 2>& views) {
+        // Root must be present, layout of elements must be the same
+        if (views[0].count == 0 || views[0].itemSize != sizeof(Node) || views[1].itemSize != sizeof(Route)) {
+            return false;
+        }
+
+        return m_nodes.attach(views[0]) && m_routes.attach(views[1]);
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // BGPTrie (dispatch to selected implementation)
+    // ──────────────────────────────────────────────────────────────
+    template <size_t BITS>
+    BGPTrie<BITS>::BGPTrie(const BGPTrieType type) : m_type(type) {
+        if (type == BGPTrieType::RADIX) {
+            m_radix = std::make_unique<BGPRadixTrie<BITS>>();
+        } else {
+            m_patricia = std::make_unique<BGPPatriciaTrie<BITS>>();
+        }
+    }
+
+    template <size_t BITS>
+    void BGPTrie<BITS>::insert(const IPvxT& subnet, const uint32_t refs) {
+        if (m_radix) {
+            m_radix->insert(subnet, refs);
+        } else {
+            m_patricia->insert(subnet, refs);
+        }
+    }
+
+    template <size_t BITS>
+    bool BGPTrie<BITS>::withdraw(const IPvxT& subnet, const uint32_t refs) {
+        return m_radix ? m_radix->withdraw(subnet, refs) : m_patricia->withdraw(subnet, refs);
+    }
+
+    template <size_t BITS>
+    bool BGPTrie<BITS>::remove(const IPvxT& subnet) {
+        return m_radix ? m_radix->remove(subnet) : m_patricia->remove(subnet);
+    }
+
+    template <size_t BITS>
+    uint32_t BGPTrie<BITS>::getRefs(const IPvxT& subnet) const {
+        return m_radix ? m_radix->getRefs(subnet) : m_patricia->getRefs(subnet);
+    }
+
+    template <size_t BITS>
+    bool BGPTrie<BITS>::isEmpty() const {
+        return m_radix ? m_radix->isEmpty() : m_patricia->isEmpty();
+    }
+
+    template <size_t BITS>
+    std::optional<typename BGPTrie<BITS>::IPvxT> BGPTrie<BITS>::lookup(const Key ip) const {
+        return m_radix ? m_radix->lookup(ip) : m_patricia->lookup(ip);
+    }
+
+    template <size_t BITS>
+    void BGPTrie<BITS>::lookupBatch(const std::vector<Key>& ips, std::vector<std::optional<IPvxT>>& results) const {
+        if (m_radix) {
+            m_radix->lookupBatch(ips, results);
+        } else {
+            m_patricia->lookupBatch(ips, results);
+        }
+    }
+
+    template <size_t BITS>
+    size_t BGPTrie<BITS>::getAllocatedBytes() const {
+        return m_radix ? m_radix->getAllocatedBytes() : m_patricia->getAllocatedBytes();
+    }
+
+    template <size_t BITS>
+    TrieStats BGPTrie<BITS>::getStats(const size_t samplesCount) const {
+        return m_radix ? m_radix->getStats(samplesCount) : m_patricia->getStats(samplesCount);
+    }
+
+    template <size_t BITS>
+    void BGPTrie<BITS>::forEachRoute(const std::function<void(const IPvxT&)>& callback) const {
+        if (m_radix) {
+            m_radix->forEachRoute(callback);
+        } else {
+            m_patricia->forEachRoute(callback);
+        }
     }
 
+    template <size_t BITS>
+    void BGPTrie<BITS>::forEachRouteWithRefs(const std::function<void(const IPvxT&, uint32_t)>& callback) const {
+        if (m_radix) {
+            m_radix->forEachRouteWithRefs(callback);
+        } else {
+            m_patricia->forEachRouteWithRefs(callback);
+        }
+    }
+
+    template <size_t BITS>
+    std::array<TrieArenaView, 2> BGPTrie<BITS>::getStorageViews() const {
+        return m_radix ? m_radix->getStorageViews() : m_patricia->getStorageViews();
+    }
+
+    template <size_t BITS>
+    bool BGPTrie<BITS>::attachStorage(const std::array<TrieArenaView, 2>& views) {
+        return m_radix ? m_radix->attachStorage(views) : m_patricia->attachStorage(views);
+    }
+
+    template <size_t BITS>
+    void BGPTrie<BITS>::copyFrom(const BGPTrie& other) {
+        if (other.m_type != m_type) {
+            throw std::invalid_argument("Trie can not be copied from trie of another type");
+        }
+
+        if (m_radix) {
+            m_radix->copyFrom(*other.m_radix);
+        } else {
+            m_patricia->copyFrom(*other.m_patricia);
+        }
+    }
+
+    TriePair::TriePair() : TriePair(gLibNetworkSettings.bgpTrieType) {}
+
+    TriePair::TriePair(const BGPTrieType type) : v4(type), v6(type) {}
+
     bool TriePair::isEmpty() const {
         return v4.isEmpty() && v6.isEmpty();
     }
 
+    size_t TriePair::getAllocatedBytes() const {
+        const size_t compiledBytes = (v4Compiled ? v4Compiled->getAllocatedBytes() : 0) +
+            (v6Compiled ? v6Compiled->getAllocatedBytes() : 0);
+
+        return v4.getAllocatedBytes() + v6.getAllocatedBytes() + compiledBytes;
+    }
+
+    TriePairStats TriePair::getStats(const size_t samplesCount) const {
+        TriePairStats stats;
+
+        stats.v4 = v4.getStats(samplesCount);
+        stats.v6 = v6.getStats(samplesCount);
+        stats.compiledBytes = (v4Compiled ? v4Compiled->getAllocatedBytes() : 0) +
+            (v6Compiled ? v6Compiled->getAllocatedBytes() : 0);
+
+        return stats;
+    }
+
+    void TriePair::copyTriesFrom(const TriePair& other) {
+        v4.copyFrom(other.v4);
+        v6.copyFrom(other.v6);
+    }
+
+    void TriePair::compileLookupTables() {
+        v4Compiled.reset();
+
+        if (gLibNetworkSettings.ipv4LookupType == IPv4LookupType::DIR_24_8 && !v4.isEmpty()) {
+            v4Compiled = std::make_unique<Dir24_8Table>(v4);
+        }
+
+        v6Compiled.reset();
+
+        if (gLibNetworkSettings.ipv6LookupType == IPv6LookupType::TREE_BITMAP && !v6.isEmpty()) {
+            v6Compiled = std::make_unique<IPv6TreeBitmap>(v6);
+        }
+    }
+
+    std::optional<IPv4Subnet> TriePair::lookup(const addrIPv4 ip) const {
+        return v4Compiled ? v4Compiled->lookup(ip) : v4.lookup(ip);
+    }
+
+    std::optional<IPv6Subnet> TriePair::lookup(const addrIPv6 ip) const {
+        return v6Compiled ? v6Compiled->lookup(ip) : v6.lookup(ip);
+    }
+
+    void TriePair::lookupBatch(const std::vector<addrIPv4>& ips, std::vector<std::optional<IPv4Subnet>>& results) const {
+        if (v4Compiled) {
+            v4Compiled->lookupBatch(ips, results);
+        } else {
+            v4.lookupBatch(ips, results);
+        }
+    }
+
+    void TriePair::lookupBatch(const std::vector<addrIPv6>& ips, std::vector<std::optional<IPv6Subnet>>& results) const {
+        if (v6Compiled) {
+            v6Compiled->lookupBatch(ips, results);
+        } else {
+            v6.lookupBatch(ips, results);
+        }
+    }
+
     // Явная инстанциация для компиляции
     template class BGPRadixTrie<32>;
     template class BGPRadixTrie<128>;
 
+    template class BGPTrie<IPV4_BITS_COUNT>;
+    template class BGPTrie<IPV6_BITS_COUNT>;
+
 }
\ No newline at end of file
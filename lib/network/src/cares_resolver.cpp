@@ -23,12 +23,14 @@ void NetUtils::CAresResolver::resolveCallback(void *arg, int status, int, struct
     qd->promise.set_value(std::move(ips));
 }
 
-bool NetUtils::CAresResolver::resolveDomains(const NetTypes::ListAddress& hosts, NetTypes::ListAddress& uniqueIPs) {
+bool NetUtils::CAresResolver::resolveHosts(const NetTypes::ListAddress& hosts, ResolvedHosts& resolved) {
     if (!m_initialized) {
         LOG_ERROR("Tried to call not initialized CAres domain resolver");
         return false;
     }
 
+    std::lock_guard<std::mutex> lock(m_mtx);
+
     std::vector<ResolveQueryData> queries;
     std::vector<std::future<std::forward_list<std::string>>> futures;
 
@@ -48,8 +50,22 @@ bool NetUtils::CAresResolver::resolveDomains(const NetTypes::ListAddress& hosts,
 
     runEventLoop(futures);
 
-    for (auto &f : futures) {
-        auto ips = f.get();
+    // Future has the same index as query of its host
+    for (size_t i = 0; i < futures.size(); ++i) {
+        resolved[queries[i].host] = futures[i].get();
+    }
+
+    return true;
+}
+
+bool NetUtils::CAresResolver::resolveDomains(const NetTypes::ListAddress& hosts, NetTypes::ListAddress& uniqueIPs) {
+    ResolvedHosts resolved;
+
+    if (!resolveHosts(hosts, resolved)) {
+        return false;
+    }
+
+    for (auto &[host, ips] : resolved) {
         for (auto &ip : ips) {
             uniqueIPs.push_front(ip);
         }
@@ -85,7 +101,8 @@ bool NetUtils::CAresResolver::init() {
 }
 
 void NetUtils::CAresResolver::runEventLoop(std::vector<std::future<std::forward_list<std::string>>>& futures) const {
-    bool done = false;
+    // Without pending queries select() would wait without timeout
+    bool done = futures.empty();
     while (!done) {
         fd_set rfds, wfds;
         FD_ZERO(&rfds);
@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <cctype>
+
+#include "domain_suffix_set.hpp"
+
+using namespace NetTypes;
+
+DomainSuffixSet::DomainSuffixSet(const ListAddress& domains) {
+    for (const auto& domain : domains) {
+        insert(domain);
+    }
+}
+
+std::string DomainSuffixSet::normalize(std::string_view domain) {
+    if (domain.substr(0, 2) == "*.") {
+        domain.remove_prefix(2);
+    }
+
+    while (!domain.empty() && domain.front() == '.') {
+        domain.remove_prefix(1);
+    }
+
+    while (!domain.empty() && domain.back() == '.') {
+        domain.remove_suffix(1);
+    }
+
+    std::string out(domain);
+    std::transform(out.begin(), out.end(), out.begin(), [](const unsigned char c) { return std::tolower(c); });
+
+    return out;
+}
+
+void DomainSuffixSet::insert(const std::string_view domain) {
+    std::string normalized = normalize(domain);
+
+    if (normalized.empty() || m_suffixes.count(normalized) != 0) {
+        return;
+    }
+
+    m_storage.push_back(std::move(normalized));
+    m_suffixes.insert(m_storage.back());
+}
+
+bool DomainSuffixSet::isMatches(const std::string_view domain) const {
+    if (m_suffixes.empty()) {
+        return false;
+    }
+
+    const std::string normalized = normalize(domain);
+    std::string_view suffix = normalized;
+
+    // Domain itself, then every parent domain: a.b.example.ru -> b.example.ru -> example.ru -> ru
+    while (!suffix.empty()) {
+        if (m_suffixes.count(suffix) != 0) {
+            return true;
+        }
+
+        const size_t pos = suffix.find('.');
+
+        if (pos == std::string_view::npos) {
+            break;
+        }
+
+        suffix.remove_prefix(pos + 1);
+    }
+
+    return false;
+}
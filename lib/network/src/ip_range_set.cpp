@@ -0,0 +1,167 @@
+#include <algorithm>
+
+#include "ip_range_set.hpp"
+
+namespace NetTypes {
+    // ──────────────────────────────────────────────────────────────
+    // Build
+    // ──────────────────────────────────────────────────────────────
+    template <typename T>
+    IPRangeSet<T>::IPRangeSet(const ListIPvx<T>& subnets) {
+        for (const auto& subnet : subnets) {
+            if (!subnet.isCorrupted()) {
+                m_ranges.push_back(toRange(subnet));
+            }
+        }
+
+        normalize();
+    }
+
+    template <typename T>
+    IPRangeSet<T>::IPRangeSet(std::vector<Range> ranges) : m_ranges(std::move(ranges)) {
+        normalize();
+    }
+
+    template <typename T>
+    void IPRangeSet<T>::normalize() {
+        std::sort(m_ranges.begin(), m_ranges.end(), [](const Range& a, const Range& b) {
+            return a.first < b.first;
+        });
+
+        // Overlapping and adjacent ranges are merged in place
+        size_t count = 0;
+
+        for (const auto& range : m_ranges) {
+            if (count != 0 && (range.first <= m_ranges[count - 1].last || range.first - m_ranges[count - 1].last == 1)) {
+                m_ranges[count - 1].last = std::max(m_ranges[count - 1].last, range.last);
+            } else {
+                m_ranges[count++] = range;
+            }
+        }
+
+        m_ranges.resize(count);
+        m_ranges.shrink_to_fit();
+    }
+
+    template <typename T>
+    typename IPRangeSet<T>::Range IPRangeSet<T>::toRange(const IPvxT& subnet) {
+        const T mask = subnet.mask();
+        const T first = subnet.ip & mask;
+
+        return {first, static_cast<T>(first | static_cast<T>(~mask))};
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // Conversion to subnets
+    // ──────────────────────────────────────────────────────────────
+    template <typename T>
+    void IPRangeSet<T>::appendSubnets(const Range& range, std::vector<IPvxT>& subnets) {
+        constexpr unsigned kBits = IPvxT::kBitsCount;
+        T first = range.first;
+
+        while (true) {
+            // Widest block which starts at first (aligned) and does not pass over end of range
+            unsigned hostBits = 0;
+
+            while (hostBits < kBits) {
+                const T hostMask = static_cast<T>(~IPvxT::lengthToMask(kBits - hostBits - 1));
+
+                if ((first & hostMask) != 0 || (first | hostMask) > range.last) {
+                    break;
+                }
+
+                ++hostBits;
+            }
+
+            const T last = first | static_cast<T>(~IPvxT::lengthToMask(kBits - hostBits));
+            subnets.push_back(IPvxT{first, static_cast<uint8_t>(kBits - hostBits)});
+
+            if (last == range.last) {
+                break;
+            }
+
+            first = last + 1;
+        }
+    }
+
+    template <typename T>
+    std::vector<typename IPRangeSet<T>::IPvxT> IPRangeSet<T>::toSubnets() const {
+        std::vector<IPvxT> subnets;
+
+        for (const auto& range : m_ranges) {
+            appendSubnets(range, subnets);
+        }
+
+        return subnets;
+    }
+
+    template <typename T>
+    std::vector<typename IPRangeSet<T>::IPvxT> IPRangeSet<T>::subtract(const IPvxT& subnet) const {
+        std::vector<IPvxT> subnets;
+
+        if (subnet.isCorrupted()) {
+            // Corrupted subnet never overlaps set
+            subnets.push_back(subnet);
+            return subnets;
+        }
+
+        const Range range = toRange(subnet);
+        T first = range.first;
+
+        // Ranges are sorted, so gaps between overlapped ones are collected in one pass
+        for (auto it = findRange(range.first); it != m_ranges.end() && it->first <= range.last; ++it) {
+            if (it->first > first) {
+                appendSubnets({first, static_cast<T>(it->first - 1)}, subnets);
+            }
+
+            if (it->last >= range.last) {
+                return subnets;
+            }
+
+            first = it->last + 1;
+        }
+
+        appendSubnets({first, range.last}, subnets);
+
+        return subnets;
+    }
+
+    // ──────────────────────────────────────────────────────────────
+    // Search
+    // ──────────────────────────────────────────────────────────────
+    template <typename T>
+    typename std::vector<typename IPRangeSet<T>::Range>::const_iterator IPRangeSet<T>::findRange(const T addr) const {
+        // Ranges do not overlap, so their ends are sorted too
+        return std::lower_bound(m_ranges.begin(), m_ranges.end(), addr, [](const Range& range, const T value) {
+            return range.last < value;
+        });
+    }
+
+    template <typename T>
+    bool IPRangeSet<T>::isOverlaps(const IPvxT& subnet) const {
+        if (subnet.isCorrupted()) {
+            return false;
+        }
+
+        const Range range = toRange(subnet);
+        const auto it = findRange(range.first);
+
+        return it != m_ranges.end() && it->first <= range.last;
+    }
+
+    template <typename T>
+    bool IPRangeSet<T>::isIncludes(const IPvxT& subnet) const {
+        if (subnet.isCorrupted()) {
+            return false;
+        }
+
+        const Range range = toRange(subnet);
+        const auto it = findRange(range.first);
+
+        return it != m_ranges.end() && it->first <= range.first && range.last <= it->last;
+    }
+
+    // Explicit instantiation for compilation
+    template class IPRangeSet<addrIPv4>;
+    template class IPRangeSet<addrIPv6>;
+}
@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <cstring>
+
+#include "ipv4_bulk_parse.hpp"
+#include "libnetwork_settings.hpp"
+#include "net_convert.hpp"
+
+// SIMD versions are compiled with per-function target attributes and selected at runtime,
+// so binary still runs on CPUs without them
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define IPV4_BULK_PARSE_X86
+#include <immintrin.h>
+#endif
+
+using namespace NetTypes;
+using namespace NetUtils;
+
+// Shortest and longest lines with IPv4: "0.0.0.0" and "255.255.255.255/32"
+#define IPV4_LINE_MIN_LENGTH    7u
+#define IPV4_LINE_MAX_LENGTH    18u
+#define IPV4_ADDR_MAX_LENGTH    15u
+
+#define IPV4_PREFIX_MAX_LENGTH  2u
+
+namespace {
+    using LineParser = bool (*)(std::string_view line, IPv4Subnet& out);
+
+    using BulkParser = void (*)(std::string_view buffer,
+        std::vector<IPv4Subnet>& subnets,
+        std::vector<std::string_view>& otherLines);
+
+    struct BulkParserImpl {
+        const char* name;
+        BulkParser parse;
+    };
+}
+
+// Rest of line after address: empty or "/<prefix>" without leading zeros
+static bool parseLinePrefix(std::string_view rest, IPv4Subnet& out) {
+    unsigned value = 0;
+
+    out.prefix = 0;
+
+    if (rest.empty()) {
+        return true;
+    }
+
+    if (rest.front() != '/') {
+        return false;
+    }
+
+    rest.remove_prefix(1);
+
+    if (rest.empty() || rest.size() > IPV4_PREFIX_MAX_LENGTH || (rest.size() > 1 && rest.front() == '0')) {
+        return false;
+    }
+
+    const char* last = rest.data() + rest.size();
+    const auto [ptr, ec] = std::from_chars(rest.data(), last, value);
+
+    if (ec != std::errc() || ptr != last || value > IPV4_BITS_COUNT) {
+        return false;
+    }
+
+    // "/0" is a host like in parseIPv4
+    out.prefix = static_cast<uint8_t>(value == 0 ? IPV4_BITS_COUNT : value);
+
+    return true;
+}
+
+static bool parseLineScalar(const std::string_view line, IPv4Subnet& out) {
+    const char* last = line.data() + line.size();
+    const auto [ptr, ec] = Convert::fromCharsIPv4(line.data(), last, out.ip);
+
+    if (ec != std::errc()) {
+        return false;
+    }
+
+    return parseLinePrefix(std::string_view(ptr, last - ptr), out);
+}
+
+template <LineParser parseLine>
+static void handleLine(std::string_view line, std::vector<IPv4Subnet>& subnets, std::vector<std::string_view>& otherLines) {
+    IPv4Subnet subnet;
+
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+
+    if (line.empty()) {
+        return;
+    }
+
+    if (parseLine(line, subnet)) {
+        subnets.push_back(subnet);
+    } else {
+        otherLines.push_back(line);
+    }
+}
+
+template <LineParser parseLine>
+static void parseBulkByMemchr(const std::string_view buffer, std::vector<IPv4Subnet>& subnets, std::vector<std::string_view>& otherLines) {
+    const char* first = buffer.data();
+    const char* last = buffer.data() + buffer.size();
+
+    while (first != last) {
+        const auto* end = static_cast<const char*>(std::memchr(first, '\n', last - first));
+
+        if (end == nullptr) {
+            end = last;
+        }
+
+        handleLine<parseLine>(std::string_view(first, end - first), subnets, otherLines);
+
+        first = (end == last) ? last : end + 1;
+    }
+}
+
+#ifdef IPV4_BULK_PARSE_X86
+namespace {
+    // Shuffle for every combination of lengths of octets (1-3 digits each, 3^4 combinations).
+    // Digits of octet i are moved right-aligned to bytes 4i..4i+2, other bytes are zeroed
+    struct OctetShuffles {
+        alignas(16) uint8_t masks[81][16];
+    };
+
+    constexpr OctetShuffles makeOctetShuffles() {
+        OctetShuffles table{};
+
+        for (unsigned pattern = 0; pattern < 81; ++pattern) {
+            const unsigned lengths[4] = {pattern / 27 % 3 + 1, pattern / 9 % 3 + 1, pattern / 3 % 3 + 1, pattern % 3 + 1};
+            unsigned start = 0;
+
+            for (unsigned i = 0; i < 4; ++i) {
+                for (unsigned k = 0; k < 4; ++k) {
+                    table.masks[pattern][4 * i + k] = 0x80;
+                }
+
+                for (unsigned k = 0; k < lengths[i]; ++k) {
+                    table.masks[pattern][4 * i + 3 - lengths[i] + k] = static_cast<uint8_t>(start + k);
+                }
+
+                start += lengths[i] + 1;
+            }
+        }
+
+        return table;
+    }
+
+    constexpr OctetShuffles kOctetShuffles = makeOctetShuffles();
+}
+
+__attribute__((target("sse4.1")))
+static bool parseLineSSE41(const std::string_view line, IPv4Subnet& out) {
+    if (line.size() < IPV4_LINE_MIN_LENGTH || line.size() > IPV4_LINE_MAX_LENGTH) {
+        return false;
+    }
+
+    // Line may end with the end of mapped file, so it is copied to zeroed block
+    alignas(16) char block[16] = {};
+    std::memcpy(block, line.data(), std::min(line.size(), sizeof(block)));
+
+    const __m128i chars = _mm_load_si128(reinterpret_cast<const __m128i*>(block));
+    const __m128i digits = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+    const __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+    const __m128i isDot = _mm_cmpeq_epi8(chars, _mm_set1_epi8('.'));
+
+    const unsigned digitMask = static_cast<unsigned>(_mm_movemask_epi8(isDigit));
+    unsigned dotMask = static_cast<unsigned>(_mm_movemask_epi8(isDot));
+
+    // Address ends at first byte which is neither digit nor dot
+    const unsigned addrLength = static_cast<unsigned>(__builtin_ctz(~(digitMask | dotMask)));
+
+    if (addrLength > IPV4_ADDR_MAX_LENGTH) {
+        return false;
+    }
+
+    dotMask &= (1u << addrLength) - 1;
+
+    unsigned dots[3];
+
+    for (auto& dot : dots) {
+        if (dotMask == 0) {
+            return false;
+        }
+
+        dot = static_cast<unsigned>(__builtin_ctz(dotMask));
+        dotMask &= dotMask - 1;
+    }
+
+    if (dotMask != 0) {
+        // More than 3 dots
+        return false;
+    }
+
+    const unsigned starts[4] = {0, dots[0] + 1, dots[1] + 1, dots[2] + 1};
+    const unsigned ends[4] = {dots[0], dots[1], dots[2], addrLength};
+    unsigned pattern = 0;
+
+    for (unsigned i = 0; i < 4; ++i) {
+        const unsigned length = ends[i] - starts[i];
+
+        if (length == 0 || length > 3 || (length > 1 && block[starts[i]] == '0')) {
+            return false;
+        }
+
+        pattern = pattern * 3 + length - 1;
+    }
+
+    // Octets are summed from digits with weights 100, 10 and 1
+    const __m128i aligned = _mm_shuffle_epi8(digits, _mm_load_si128(reinterpret_cast<const __m128i*>(kOctetShuffles.masks[pattern])));
+    const __m128i weights = _mm_setr_epi8(100, 10, 1, 0, 100, 10, 1, 0, 100, 10, 1, 0, 100, 10, 1, 0);
+    const __m128i octets = _mm_madd_epi16(_mm_maddubs_epi16(aligned, weights), _mm_set1_epi16(1));
+
+    if (!_mm_testz_si128(octets, _mm_set1_epi32(~0xFF))) {
+        // Octet is greater than 255
+        return false;
+    }
+
+    // Low bytes of octets in reversed order give host-order address
+    const __m128i order = _mm_setr_epi8(12, 8, 4, 0, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128);
+    out.ip = static_cast<addrIPv4>(_mm_cvtsi128_si32(_mm_shuffle_epi8(octets, order)));
+
+    return parseLinePrefix(line.substr(addrLength), out);
+}
+
+__attribute__((target("avx2")))
+static void parseBulkAVX2(const std::string_view buffer, std::vector<IPv4Subnet>& subnets, std::vector<std::string_view>& otherLines) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t lineStart = 0;
+    size_t pos = 0;
+
+    // Line breaks of 32 bytes are found at once, so every byte is compared only once
+    for (; pos + 32 <= buffer.size(); pos += 32) {
+        const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buffer.data() + pos));
+        auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chars, newline)));
+
+        while (mask != 0) {
+            const size_t end = pos + static_cast<size_t>(__builtin_ctz(mask));
+
+            handleLine<parseLineSSE41>(buffer.substr(lineStart, end - lineStart), subnets, otherLines);
+
+            lineStart = end + 1;
+            mask &= mask - 1;
+        }
+    }
+
+    parseBulkByMemchr<parseLineSSE41>(buffer.substr(lineStart), subnets, otherLines);
+}
+#endif
+
+static BulkParserImpl selectBulkParser() {
+    if (gLibNetworkSettings.ipv4BulkParseType == IPv4BulkParseType::SCALAR) {
+        return {"scalar", parseBulkByMemchr<parseLineScalar>};
+    }
+
+#ifdef IPV4_BULK_PARSE_X86
+    // CPU features are detected once
+    static const bool isAVX2 = __builtin_cpu_supports("avx2");
+    static const bool isSSE41 = __builtin_cpu_supports("sse4.1");
+
+    if (isAVX2 && isSSE41) {
+        return {"avx2", parseBulkAVX2};
+    }
+
+    if (isSSE41) {
+        return {"sse4.1", parseBulkByMemchr<parseLineSSE41>};
+    }
+#endif
+
+    return {"scalar", parseBulkByMemchr<parseLineScalar>};
+}
+
+void Convert::parseIPv4Bulk(const std::string_view buffer,
+    std::vector<IPv4Subnet>& subnets,
+    std::vector<std::string_view>& otherLines) {
+    selectBulkParser().parse(buffer, subnets, otherLines);
+}
+
+const char* Convert::getIPv4BulkParserName() {
+    return selectBulkParser().name;
+}
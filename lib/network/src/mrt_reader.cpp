@@ -0,0 +1,596 @@
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <archive.h>
+#include <archive_entry.h>
+
+#include "mrt_reader.hpp"
+#include "fs_utils_mmap.hpp"
+#include "trie_key.hpp"
+#include "log.hpp"
+
+using namespace NetTypes;
+using namespace NetUtils;
+
+// Size of block for decompression, grows if record does not fit
+#define MRT_DECOMPRESS_BLOCK_BYTES      (1u << 20) // 1 MiB
+
+// BGP message header (marker + length + type) and type of UPDATE
+#define BGP_MESSAGE_HEADER_SIZE     19u
+#define BGP_MESSAGE_TYPE_UPDATE     2u
+
+// Path attributes with IPv6 prefixes
+#define BGP_ATTR_MP_REACH_NLRI      14u
+#define BGP_ATTR_MP_UNREACH_NLRI    15u
+#define BGP_ATTR_FLAG_EXT_LENGTH    0x10u
+
+// Bits of peer type in PEER_INDEX_TABLE
+#define MRT_PEER_TYPE_IPV6          0x01u
+#define MRT_PEER_TYPE_AS4           0x02u
+
+#define BGP_AFI_IPV4                1u
+#define BGP_AFI_IPV6                2u
+#define BGP_SAFI_UNICAST            1u
+#define BGP_SAFI_MULTICAST          2u
+
+namespace {
+    struct ArchiveDeleter {
+        void operator()(archive* a) const { archive_read_free(a); }
+    };
+
+    template <size_t BITS>
+    IPvx<TrieKey<BITS>> makeSubnet(const uint8_t* bytes, const size_t bytesCount, const unsigned len) {
+        TrieKey<BITS> key = 0;
+
+        for (size_t i = 0; i < bytesCount; ++i) {
+            key |= static_cast<TrieKey<BITS>>(bytes[i]) << (BITS - 8 * (i + 1));
+        }
+
+        return {key & keyMask<BITS>(len), static_cast<uint8_t>(len)};
+    }
+
+    // Sequence of NLRI prefixes (ADD-PATH prefixes start with 4-byte path identifier)
+    bool decodePrefixList(const uint8_t* data, const size_t size, const bool isIPv6, const bool isAddPath,
+                          std::vector<SubnetVariant>& out) {
+        size_t offset = 0;
+
+        while (offset < size) {
+            if (isAddPath) {
+                offset += 4;
+
+                if (offset > size) {
+                    return false;
+                }
+            }
+
+            SubnetVariant subnet;
+            const size_t prefixSize = MRT::decodePrefix(data + offset, size - offset, isIPv6, subnet);
+
+            if (prefixSize == 0) {
+                return false;
+            }
+
+            out.push_back(subnet);
+            offset += prefixSize;
+        }
+
+        return true;
+    }
+
+    // MP_REACH_NLRI / MP_UNREACH_NLRI attribute value
+    bool decodeMultiprotocolNLRI(const uint8_t* data, const size_t size, const bool isReach, const bool isAddPath,
+                                 std::vector<SubnetVariant>& out) {
+        // AFI (2) + SAFI (1)
+        if (size < 3) {
+            return false;
+        }
+
+        const uint16_t afi = MRT::readBE16(data);
+        const uint8_t safi = data[2];
+
+        if ((afi != BGP_AFI_IPV4 && afi != BGP_AFI_IPV6) || (safi != BGP_SAFI_UNICAST && safi != BGP_SAFI_MULTICAST)) {
+            // Other families have another encoding of NLRI, they are skipped
+            return true;
+        }
+
+        size_t offset = 3;
+
+        if (isReach) {
+            // Next hop (length + value) and reserved byte
+            if (offset >= size || offset + 1 + data[offset] + 1 > size) {
+                return false;
+            }
+
+            offset += 1 + data[offset] + 1;
+        }
+
+        return decodePrefixList(data + offset, size - offset, afi == BGP_AFI_IPV6, isAddPath, out);
+    }
+
+    void readCompressedDump(const fs::path& path, const uint8_t* data, const size_t size, const MRT::RecordCallback& callback) {
+        const std::unique_ptr<archive, ArchiveDeleter> reader(archive_read_new());
+        archive_entry* entry;
+
+        if (reader == nullptr) {
+            throw std::ios_base::failure("Failed to init decompressor for BGP dump: " + path.string());
+        }
+
+        archive_read_support_filter_gzip(reader.get());
+        archive_read_support_filter_bzip2(reader.get());
+        archive_read_support_format_raw(reader.get());
+
+        if (archive_read_open_memory(reader.get(), data, size) != ARCHIVE_OK ||
+            archive_read_next_header(reader.get(), &entry) != ARCHIVE_OK) {
+            throw std::ios_base::failure("Failed to decompress BGP dump " + path.string() + ": " + archive_error_string(reader.get()));
+        }
+
+        std::vector<uint8_t> buffer(MRT_DECOMPRESS_BLOCK_BYTES);
+        size_t filled = 0;
+
+        while (true) {
+            if (filled == buffer.size()) {
+                // Record is larger than buffer
+                buffer.resize(buffer.size() * 2);
+            }
+
+            const la_ssize_t readBytes = archive_read_data(reader.get(), buffer.data() + filled, buffer.size() - filled);
+
+            if (readBytes < 0) {
+                throw std::ios_base::failure("Failed to decompress BGP dump " + path.string() + ": " + archive_error_string(reader.get()));
+            }
+
+            if (readBytes == 0) {
+                break;
+            }
+
+            filled += static_cast<size_t>(readBytes);
+
+            // Incomplete record at the end is moved to the begin of buffer
+            const size_t consumed = MRT::forEachRecord(buffer.data(), filled, callback);
+            std::memmove(buffer.data(), buffer.data() + consumed, filled - consumed);
+            filled -= consumed;
+        }
+
+        if (filled != 0) {
+            LOG_WARNING("BGP dump {} ends with truncated record ({} bytes)", path.string(), filled);
+        }
+    }
+}
+
+bool MRT::isCompressed(const uint8_t* data, const size_t size) {
+    const bool isGzip = size >= 2 && data[0] == 0x1f && data[1] == 0x8b;
+    const bool isBzip2 = size >= 3 && data[0] == 'B' && data[1] == 'Z' && data[2] == 'h';
+
+    return isGzip || isBzip2;
+}
+
+std::vector<size_t> MRT::splitToChunks(const uint8_t* data, const size_t size, const size_t chunkBytes) {
+    std::vector<size_t> bounds = {0};
+    size_t offset = 0;
+
+    // Only headers are read, bodies are skipped by length
+    while (size - offset >= kRecordHeaderSize) {
+        const uint32_t length = readBE32(data + offset + 8);
+
+        if (length > size - offset - kRecordHeaderSize) {
+            break;
+        }
+
+        offset += kRecordHeaderSize + length;
+
+        if (offset - bounds.back() >= chunkBytes) {
+            bounds.push_back(offset);
+        }
+    }
+
+    if (bounds.back() != offset) {
+        bounds.push_back(offset);
+    }
+
+    return bounds;
+}
+
+size_t MRT::forEachRecord(const uint8_t* data, const size_t size, const RecordCallback& callback) {
+    size_t offset = 0;
+
+    while (size - offset >= kRecordHeaderSize) {
+        const uint8_t* p = data + offset;
+
+        const RecordHeader header = {readBE32(p), readBE16(p + 4), readBE16(p + 6), readBE32(p + 8)};
+
+        if (header.length > size - offset - kRecordHeaderSize) {
+            break;
+        }
+
+        callback(header, p + kRecordHeaderSize);
+        offset += kRecordHeaderSize + header.length;
+    }
+
+    return offset;
+}
+
+void MRT::forEachRecord(const fs::path& path, const RecordCallback& callback) {
+    const FS::Utils::MappedFile file(path);
+    file.adviseSequential();
+
+    if (isCompressed(file.data(), file.size())) {
+        readCompressedDump(path, file.data(), file.size(), callback);
+        return;
+    }
+
+    // Plain dump is parsed without copies
+    if (const size_t consumed = forEachRecord(file.data(), file.size(), callback); consumed != file.size()) {
+        LOG_WARNING("BGP dump {} ends with truncated record ({} bytes)", path.string(), file.size() - consumed);
+    }
+}
+
+size_t MRT::decodePrefix(const uint8_t* data, const size_t size, const bool isIPv6, SubnetVariant& outSubnet) {
+    if (size < 1) {
+        return 0;
+    }
+
+    const unsigned len = data[0];
+    const size_t bytesCount = (len + 7) / 8;
+
+    if (len > (isIPv6 ? IPV6_BITS_COUNT : IPV4_BITS_COUNT) || size < 1 + bytesCount) {
+        return 0;
+    }
+
+    if (isIPv6) {
+        outSubnet = makeSubnet<IPV6_BITS_COUNT>(data + 1, bytesCount, len);
+    } else {
+        outSubnet = makeSubnet<IPV4_BITS_COUNT>(data + 1, bytesCount, len);
+    }
+
+    return 1 + bytesCount;
+}
+
+std::optional<SubnetVariant> MRT::extractRibPrefix(const RecordHeader& header, const uint8_t* body, uint32_t* outPeersCount) {
+    SubnetVariant subnet;
+
+    // ===========================
+    // TYPE: TABLE_DUMP_V2 (sequence number + prefix in NLRI encoding)
+    // ===========================
+    if (header.type == kTypeTableDumpV2) {
+        bool isIPv6;
+
+        switch (header.subtype) {
+            case kRibIPv4Unicast:
+            case kRibIPv4Multicast:
+            case kRibIPv4UnicastAddPath:
+            case kRibIPv4MulticastAddPath:
+                isIPv6 = false;
+                break;
+            case kRibIPv6Unicast:
+            case kRibIPv6Multicast:
+            case kRibIPv6UnicastAddPath:
+            case kRibIPv6MulticastAddPath:
+                isIPv6 = true;
+                break;
+            default:
+                // PEER_INDEX_TABLE and RIB_GENERIC do not give prefix
+                return std::nullopt;
+        }
+
+        if (header.length < 4) {
+            return std::nullopt;
+        }
+
+        const size_t prefixSize = decodePrefix(body + 4, header.length - 4, isIPv6, subnet);
+
+        // Count of RIB entries follows prefix
+        if (prefixSize == 0 || header.length < 4 + prefixSize + 2) {
+            return std::nullopt;
+        }
+
+        if (outPeersCount != nullptr) {
+            *outPeersCount = readBE16(body + 4 + prefixSize);
+        }
+
+        return subnet;
+    }
+
+    // ===========================
+    // TYPE: TABLE_DUMP (view + sequence number + full address + length)
+    // ===========================
+    if (header.type == kTypeTableDump) {
+        const bool isIPv6 = header.subtype == kTableDumpAfiIPv6;
+
+        if (!isIPv6 && header.subtype != kTableDumpAfiIPv4) {
+            return std::nullopt;
+        }
+
+        const size_t addrSize = isIPv6 ? 16u : 4u;
+        const unsigned maxLen = isIPv6 ? IPV6_BITS_COUNT : IPV4_BITS_COUNT;
+
+        if (header.length < 4 + addrSize + 1) {
+            return std::nullopt;
+        }
+
+        const unsigned len = body[4 + addrSize];
+
+        if (len > maxLen) {
+            return std::nullopt;
+        }
+
+        // One record per peer
+        if (outPeersCount != nullptr) {
+            *outPeersCount = 1;
+        }
+
+        if (isIPv6) {
+            return makeSubnet<IPV6_BITS_COUNT>(body + 4, addrSize, len);
+        }
+
+        return makeSubnet<IPV4_BITS_COUNT>(body + 4, addrSize, len);
+    }
+
+    return std::nullopt;
+}
+
+bool MRT::extractPeerIndexTable(const RecordHeader& header, const uint8_t* body, std::vector<Peer>& outPeers) {
+    if (header.type != kTypeTableDumpV2 || header.subtype != kPeerIndexTable) {
+        return false;
+    }
+
+    const uint8_t* p = body;
+    const uint8_t* end = body + header.length;
+
+    // Collector BGP ID, length and name of view
+    if (end - p < 6) {
+        return false;
+    }
+
+    const uint16_t viewNameLength = readBE16(p + 4);
+    p += 6;
+
+    if (end - p < viewNameLength + 2) {
+        return false;
+    }
+
+    p += viewNameLength;
+
+    const uint16_t peersCount = readBE16(p);
+    p += 2;
+
+    outPeers.clear();
+    outPeers.reserve(peersCount);
+
+    // Peer type, BGP ID, IP and AS (sizes of IP and AS depend on type)
+    for (uint16_t i = 0; i < peersCount; ++i) {
+        if (end - p < 5) {
+            return false;
+        }
+
+        const uint8_t type = p[0];
+        const size_t addrSize = (type & MRT_PEER_TYPE_IPV6) ? 16u : 4u;
+        const size_t asSize = (type & MRT_PEER_TYPE_AS4) ? 4u : 2u;
+
+        p += 5;
+
+        if (end - p < static_cast<ptrdiff_t>(addrSize + asSize)) {
+            return false;
+        }
+
+        Peer peer;
+        std::memcpy(peer.ip.data(), p, addrSize);
+        peer.as = asSize == 4 ? readBE32(p + addrSize) : readBE16(p + addrSize);
+
+        outPeers.push_back(peer);
+        p += addrSize + asSize;
+    }
+
+    return true;
+}
+
+std::optional<SubnetVariant> MRT::extractRibPeers(const RecordHeader& header, const uint8_t* body,
+                                                  const std::vector<Peer>& peerTable, std::vector<Peer>& outPeers) {
+    auto subnet = extractRibPrefix(header, body);
+
+    outPeers.clear();
+
+    if (!subnet) {
+        return std::nullopt;
+    }
+
+    // ===========================
+    // TYPE: TABLE_DUMP (peer IP and 2-byte AS follow status and originated time)
+    // ===========================
+    if (header.type == kTypeTableDump) {
+        const size_t addrSize = header.subtype == kTableDumpAfiIPv6 ? 16u : 4u;
+        const size_t peerOffset = 4 + addrSize + 1 + 1 + 4;
+
+        if (header.length >= peerOffset + addrSize + 2) {
+            Peer peer;
+            std::memcpy(peer.ip.data(), body + peerOffset, addrSize);
+            peer.as = readBE16(body + peerOffset + addrSize);
+
+            outPeers.push_back(peer);
+        }
+
+        return subnet;
+    }
+
+    // ===========================
+    // TYPE: TABLE_DUMP_V2 (entries with peer index follow count of entries)
+    // ===========================
+    const bool isAddPath = header.subtype >= kRibIPv4UnicastAddPath;
+    const size_t prefixBytes = (body[4] + 7) / 8;
+
+    const uint8_t* p = body + 4 + 1 + prefixBytes;
+    const uint8_t* end = body + header.length;
+
+    const uint16_t entriesCount = readBE16(p);
+    p += 2;
+
+    // Peer index, originated time, path identifier (ADD-PATH only) and attributes
+    const size_t entryHeaderSize = 2 + 4 + (isAddPath ? 4u : 0u) + 2;
+
+    for (uint16_t i = 0; i < entriesCount; ++i) {
+        if (end - p < static_cast<ptrdiff_t>(entryHeaderSize)) {
+            break;
+        }
+
+        const uint16_t peerIndex = readBE16(p);
+        const uint16_t attrsLength = readBE16(p + entryHeaderSize - 2);
+
+        if (peerIndex < peerTable.size()) {
+            outPeers.push_back(peerTable[peerIndex]);
+        }
+
+        p += entryHeaderSize;
+
+        if (end - p < attrsLength) {
+            break;
+        }
+
+        p += attrsLength;
+    }
+
+    return subnet;
+}
+
+bool MRT::extractUpdatePrefixes(const RecordHeader& header, const uint8_t* body, UpdatePrefixes& out) {
+    if (header.type != kTypeBGP4MP && header.type != kTypeBGP4MP_ET) {
+        return false;
+    }
+
+    bool isAS4;
+    bool isAddPath;
+
+    switch (header.subtype) {
+        case kBGP4MPMessage:
+        case kBGP4MPMessageLocal:
+            isAS4 = false;
+            isAddPath = false;
+            break;
+        case kBGP4MPMessageAS4:
+        case kBGP4MPMessageAS4Local:
+            isAS4 = true;
+            isAddPath = false;
+            break;
+        case kBGP4MPMessageAddPath:
+        case kBGP4MPMessageLocalAddPath:
+            isAS4 = false;
+            isAddPath = true;
+            break;
+        case kBGP4MPMessageAS4AddPath:
+        case kBGP4MPMessageAS4LocalAddPath:
+            isAS4 = true;
+            isAddPath = true;
+            break;
+        default:
+            // State changes
+            return false;
+    }
+
+    const uint8_t* p = body;
+    const uint8_t* end = body + header.length;
+
+    // Extended timestamp has microseconds before message
+    if (header.type == kTypeBGP4MP_ET) {
+        if (header.length < 4) {
+            return false;
+        }
+
+        p += 4;
+    }
+
+    // Peer AS, local AS, interface index, AFI
+    const size_t asSize = isAS4 ? 4u : 2u;
+
+    if (end - p < static_cast<ptrdiff_t>(2 * asSize + 4)) {
+        return false;
+    }
+
+    out.peer.as = isAS4 ? readBE32(p) : readBE16(p);
+    p += 2 * asSize + 2;
+
+    const uint16_t afi = readBE16(p);
+    p += 2;
+
+    // Peer IP and local IP
+    const size_t addrSize = afi == BGP_AFI_IPV6 ? 16u : 4u;
+
+    if (end - p < static_cast<ptrdiff_t>(2 * addrSize + BGP_MESSAGE_HEADER_SIZE)) {
+        return false;
+    }
+
+    out.peer.ip = {};
+    std::memcpy(out.peer.ip.data(), p, addrSize);
+    p += 2 * addrSize;
+
+    // BGP message: marker (16), length (2), type (1)
+    const uint16_t messageLength = readBE16(p + 16);
+
+    if (p[18] != BGP_MESSAGE_TYPE_UPDATE) {
+        return false;
+    }
+
+    if (messageLength < BGP_MESSAGE_HEADER_SIZE + 4 || messageLength > end - p) {
+        return false;
+    }
+
+    end = p + messageLength;
+    p += BGP_MESSAGE_HEADER_SIZE;
+
+    // Withdrawn routes (IPv4)
+    const uint16_t withdrawnLength = readBE16(p);
+    p += 2;
+
+    if (withdrawnLength + 2 > end - p || !decodePrefixList(p, withdrawnLength, false, isAddPath, out.withdrawn)) {
+        return false;
+    }
+
+    p += withdrawnLength;
+
+    // Path attributes, only multiprotocol ones are decoded
+    const uint16_t attrsLength = readBE16(p);
+    p += 2;
+
+    if (attrsLength > end - p) {
+        return false;
+    }
+
+    const uint8_t* attrsEnd = p + attrsLength;
+
+    while (p < attrsEnd) {
+        if (attrsEnd - p < 3) {
+            return false;
+        }
+
+        const uint8_t flags = p[0];
+        const uint8_t type = p[1];
+        size_t attrLength;
+
+        if (flags & BGP_ATTR_FLAG_EXT_LENGTH) {
+            if (attrsEnd - p < 4) {
+                return false;
+            }
+
+            attrLength = readBE16(p + 2);
+            p += 4;
+        } else {
+            attrLength = p[2];
+            p += 3;
+        }
+
+        if (attrLength > static_cast<size_t>(attrsEnd - p)) {
+            return false;
+        }
+
+        if (type == BGP_ATTR_MP_REACH_NLRI && !decodeMultiprotocolNLRI(p, attrLength, true, isAddPath, out.announced)) {
+            return false;
+        }
+
+        if (type == BGP_ATTR_MP_UNREACH_NLRI && !decodeMultiprotocolNLRI(p, attrLength, false, isAddPath, out.withdrawn)) {
+            return false;
+        }
+
+        p += attrLength;
+    }
+
+    // Rest of message is announced routes (IPv4)
+    return decodePrefixList(attrsEnd, end - attrsEnd, false, isAddPath, out.announced);
+}
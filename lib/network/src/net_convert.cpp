@@ -1,246 +1,354 @@
 #include "net_convert.hpp"
 #include "libnetwork_settings.hpp"
 #include "net_types_base.hpp"
-#include "bgp_parse.hpp"
+#include "bgp_cache.hpp"
 #include "log.hpp"
 
+#include <array>
 #include <cstdint>
+#include <optional>
+
+#define IPV4_OCTETS_COUNT           4u
+#define IPV6_HEX_GROUP_MAX_LENGTH   4u
 
 using namespace NetTypes;
 using namespace NetUtils;
 
-static constexpr bool validateOctetIPv4(const int value) {
-    return (value >= 0 && value <= 255);
+// Current version of tries is held by caller, so it is not freed during lookups
+static BGP::TrieSnapshot getLoadedTrie() {
+    if (auto ptrie = BGP::getTrieFromCache()) {
+        return ptrie;
+    }
+
+    if (gLibNetworkSettings.bgpDumpPaths.empty()) {
+        LOG_WARNING("Subnet cant be found using BGP dump because of incorrect dump path");
+        return nullptr;
+    }
+
+    auto ptrie = BGP::loadTrieToCache(gLibNetworkSettings.bgpDumpPaths);
+
+    if (ptrie == nullptr) {
+        LOG_WARNING("Subnet cant be found using BGP dump because no dumps are loaded");
+    }
+
+    return ptrie;
 }
 
-// TODO: VALIDATION FOR IPV6
+template <typename T>
+static int getMaskLimitByBGP() {
+    if constexpr (std::is_same_v<T, IPv4Subnet>) {
+        return gLibNetworkSettings.autoFixMaskLimitByBGP.v4;
+    } else {
+        return gLibNetworkSettings.autoFixMaskLimitByBGP.v6;
+    }
+}
 
+// Apply found subnet to IP, false if IP must be skipped
 template <typename T>
-static bool parseSubnetIP(const std::string& ip, T& outIPVx) {
-    int buffer;
-    const auto pos = ip.find('/');
-    const auto size = outIPVx.mask.size();
-    bool searchStatus = true;
-    bool filterStatus = true;
+static bool applyBGPLookupResult(const std::optional<T>& found, T& outIPVx) {
+    if (!found) {
+        LOG_WARNING("Failed to find subnet for IP using BGP dump: " + outIPVx.to_string());
+        return false;
+    }
+
+    outIPVx.prefix = found->prefix;
 
-    outIPVx.mask.reset();
+    // TODO: Add log, but not in every tact
+    return found->prefix >= getMaskLimitByBGP<T>();
+}
 
-    if (pos != std::string::npos) {
+// Rest of entry after address: empty or "/<prefix>"
+template <typename T>
+static bool parseSubnetIP(const std::string_view rest, T& outIPVx, const bool isFixByBGP) {
+    outIPVx.prefix = 0;
+
+    if (!rest.empty()) {
         // Subnet is specified
-        buffer = std::stoi(ip.substr(pos + 1, 2));
+        unsigned buffer = 0;
+        const char* last = rest.data() + rest.size();
 
-        for (int i(0); i < buffer; ++i) {
-            outIPVx.mask.set(size - 1 - i);
+        if (rest.front() != '/') {
+            return false;
         }
-    } else if (gLibNetworkSettings.isSearchSubnetByBGP) {
-        auto ptrie = BGP::getTrieFromCache();
 
-        if (ptrie->isEmpty()) {
-            if (gLibNetworkSettings.bgpDumpPath.empty()) {
-                LOG_WARNING("Subnet cant be found using BGP dump because of incorrect dump path");
-                return false;
-            }
+        const auto [ptr, ec] = std::from_chars(rest.data() + 1, last, buffer);
 
-            BGP::parseDumpToCache(gLibNetworkSettings.bgpDumpPath);
+        if (ec != std::errc() || ptr != last || buffer > T::kBitsCount) {
+            return false;
         }
 
-        if constexpr (std::is_same_v<T, IPv4Subnet>) {
-            if (auto ipb = ptrie->v4.lookup(outIPVx.ip)) {
-                outIPVx.mask = ipb->mask;
-                filterStatus = Convert::bitsetToLength(ipb->mask) >= gLibNetworkSettings.autoFixMaskLimitByBGP.v4;
-            } else {
-                searchStatus = false;
-            }
-        } else if (std::is_same_v<T, IPv6Subnet>) {
-            if (auto ipb = ptrie->v6.lookup(outIPVx.ip)) {
-                outIPVx.mask = ipb->mask;
-                filterStatus = Convert::bitsetToLength(ipb->mask) >= gLibNetworkSettings.autoFixMaskLimitByBGP.v6;
-            } else {
-                searchStatus = false;
-            }
-        }
+        outIPVx.prefix = static_cast<uint8_t>(buffer);
+    } else if (isFixByBGP && gLibNetworkSettings.isSearchSubnetByBGP) {
+        const auto ptrie = getLoadedTrie();
 
-        if (!searchStatus) {
-            LOG_WARNING("Failed to find subnet for IP using BGP dump: " + outIPVx.to_string());
+        if (ptrie == nullptr) {
             return false;
-        } else if (!filterStatus) {
-            // TODO: Add log, but not in every tact
+        }
+
+        if (!applyBGPLookupResult(ptrie->lookup(outIPVx.ip), outIPVx)) {
             return false;
         }
     }
 
-    if (outIPVx.mask.count() == 0) {
-        outIPVx.mask.set();
+    if (outIPVx.prefix == 0) {
+        outIPVx.prefix = T::kBitsCount;
     }
 
-    return searchStatus && filterStatus;
+    return true;
 }
 
-bitsetIPv4 Convert::inetv4ToBitset(const in_addr& a) {
-    uint32_t v = ntohl(a.s_addr);
-    return {v};
+template <typename T>
+static void markSubnetsByBGPImpl(std::vector<T>& subnets, std::vector<bool>& outIsFixed) {
+    outIsFixed.assign(subnets.size(), false);
+
+    if (subnets.empty()) {
+        return;
+    }
+
+    const auto ptrie = getLoadedTrie();
+
+    if (ptrie == nullptr) {
+        return;
+    }
+
+    std::vector<decltype(T::ip)> ips;
+    std::vector<std::optional<T>> found;
+
+    ips.reserve(subnets.size());
+
+    for (const auto& subnet : subnets) {
+        ips.push_back(subnet.ip);
+    }
+
+    ptrie->lookupBatch(ips, found);
+
+    for (size_t i = 0; i < subnets.size(); ++i) {
+        outIsFixed[i] = applyBGPLookupResult(found[i], subnets[i]);
+    }
 }
 
-bitsetIPv6 Convert::inetv6ToBitset(const in6_addr& a) {
-    bitsetIPv6 b;
-    for (int i = 0; i < 16; i++) {
-        const uint8_t byte = a.s6_addr[i];
-        for (int bit = 0; bit < 8; ++bit) {
-            b[(15 - i) * 8 + (7 - bit)] = (byte >> bit) & 1;
+template <typename T>
+static size_t fixSubnetsByBGPImpl(std::vector<T>& subnets) {
+    const size_t count = subnets.size();
+    std::vector<bool> isFixed;
+
+    markSubnetsByBGPImpl(subnets, isFixed);
+
+    // Successful results are compacted to the beginning
+    size_t kept = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        if (isFixed[i]) {
+            subnets[kept++] = subnets[i];
         }
     }
-    return b;
+
+    subnets.resize(kept);
+
+    return count - kept;
 }
 
-bitsetIPv4 Convert::lengthv4ToBitset(const int len) {
-    uint32_t m = (len == 0) ? 0 : (0xFFFFFFFFu << (32 - len));
-    return {m};
+size_t Convert::fixSubnetsByBGP(std::vector<IPv4Subnet>& subnets) {
+    return fixSubnetsByBGPImpl(subnets);
 }
 
-bitsetIPv6 Convert::lengthv6ToBitset(const int len) {
-    bitsetIPv6 m;
-    for (int i = 0; i < len; i++) {
-        m[127 - i] = true;
-    }
-    return m;
+size_t Convert::fixSubnetsByBGP(std::vector<IPv6Subnet>& subnets) {
+    return fixSubnetsByBGPImpl(subnets);
 }
 
-template <size_t N>
-int Convert::bitsetToLength(const std::bitset<N>& bs) {
-    int prefix = 0;
+void Convert::fixSubnetsByBGP(std::vector<IPv4Subnet>& subnets, std::vector<bool>& outIsFixed) {
+    markSubnetsByBGPImpl(subnets, outIsFixed);
+}
 
-    for (int i = N - 1; i >= 0; --i) {
-        if (!bs.test(i))
-            break;
-        ++prefix;
+void Convert::fixSubnetsByBGP(std::vector<IPv6Subnet>& subnets, std::vector<bool>& outIsFixed) {
+    markSubnetsByBGPImpl(subnets, outIsFixed);
+}
+
+addrIPv4 Convert::inetv4ToAddr(const in_addr& a) {
+    return ntohl(a.s_addr);
+}
+
+addrIPv6 Convert::inetv6ToAddr(const in6_addr& a) {
+    addrIPv6 v = 0;
+
+    for (const uint8_t byte : a.s6_addr) {
+        v = (v << 8) | byte;
     }
 
-    return prefix;
+    return v;
 }
 
-bool Convert::parseIPv4(const std::string& ip, IPv4Subnet& out) {
-    int buffer;
-    size_t pos;
-    size_t start_pos(0);
-    int8_t part_offset(24);
+addrIPv4 Convert::lengthv4ToMask(const int len) {
+    return IPv4Subnet::lengthToMask(len);
+}
 
-    out.ip.reset();
+addrIPv6 Convert::lengthv6ToMask(const int len) {
+    return IPv6Subnet::lengthToMask(len);
+}
 
-    do {
-        if (part_offset) {
-            pos = ip.find('.', start_pos);
-        } else {
-            pos = ip.find('/', start_pos);
-        }
+std::from_chars_result Convert::fromCharsIPv4(const char* first, const char* last, addrIPv4& out) {
+    addrIPv4 value = 0;
+
+    for (unsigned i = 0; i < IPV4_OCTETS_COUNT; ++i) {
+        unsigned octet = 0;
 
-        if (!part_offset && pos == std::string::npos) {
-            pos = std::distance(ip.begin() + start_pos, ip.end());
+        if (i != 0) {
+            if (first == last || *first != '.') {
+                return {first, std::errc::invalid_argument};
+            }
+
+            ++first;
         }
 
-        if (pos == std::string::npos) {
-            // Failed to find octet end
-            return false;
+        const auto [ptr, ec] = std::from_chars(first, last, octet);
+
+        if (ec != std::errc()) {
+            return {first, ec};
         }
 
-        buffer = std::stoi(ip.substr(start_pos, pos - start_pos));
+        if (ptr - first > 1 && *first == '0') {
+            // Leading zero may be read as octal by other tools
+            return {first, std::errc::invalid_argument};
+        }
 
-        if (!validateOctetIPv4(buffer)) {
-            // Value is out of bound in octet
-            return false;
+        if (octet > 255) {
+            return {first, std::errc::result_out_of_range};
         }
 
-        out.ip |= (buffer << part_offset);
+        value = (value << 8) | octet;
+        first = ptr;
+    }
 
-        part_offset -= 8;
-        start_pos = pos + 1;
-    } while (part_offset >= 0);
+    out = value;
 
-    return parseSubnetIP(ip, out);
+    return {first, std::errc()};
 }
 
-bool Convert::parseIPv6(const std::string& ip, IPv6Subnet& out) {
-    // найдём часть до '/': parseSubnetIP сам распарсит префикс
-    size_t slash_pos = ip.find('/');
-    std::string addr = (slash_pos == std::string::npos) ? ip : ip.substr(0, slash_pos);
+std::from_chars_result Convert::fromCharsIPv6(const char* first, const char* last, addrIPv6& out) {
+    std::array<uint16_t, IPV6_HEX_GROUPS_COUNT> groups{};
+    size_t count = 0;
+    size_t gapInx = 0;                  // Index of first group after "::"
+    bool hasGap = false;
+    bool isGroupExpected = false;       // After single ':'
+
+    const auto isColonAt = [last](const char* p) { return p != last && *p == ':'; };
+
+    if (isColonAt(first)) {
+        if (!isColonAt(first + 1)) {
+            return {first, std::errc::invalid_argument};
+        }
+
+        first += 2;
+        hasGap = true;
+    }
+
+    while (true) {
+        uint32_t value = 0;
+        const auto [ptr, ec] = std::from_chars(first, last, value, 16);
+
+        if (ec == std::errc() && ptr != last && *ptr == '.') {
+            // Embedded IPv4 takes two last groups
+            addrIPv4 ipv4 = 0;
+
+            if (count + 2 > IPV6_HEX_GROUPS_COUNT) {
+                return {first, std::errc::invalid_argument};
+            }
+
+            const auto result = fromCharsIPv4(first, last, ipv4);
+
+            if (result.ec != std::errc()) {
+                return result;
+            }
+
+            groups[count++] = static_cast<uint16_t>(ipv4 >> 16);
+            groups[count++] = static_cast<uint16_t>(ipv4);
+            first = result.ptr;
+            break;
+        }
 
-    out.ip.reset();
+        if (ec == std::errc::invalid_argument) {
+            // No group here, it is the end of address
+            if (isGroupExpected) {
+                return {first, std::errc::invalid_argument};
+            }
 
-    // split helper (разделитель ':')
-    auto split_by_colon = [](const std::string& s) {
-        std::vector<std::string> res;
-        size_t start = 0;
-        size_t pos;
-        while ((pos = s.find(':', start)) != std::string::npos) {
-            res.push_back(s.substr(start, pos - start));
-            start = pos + 1;
+            break;
         }
-        res.push_back(s.substr(start));
-        return res;
-    };
 
-    std::vector<std::string> parts;
+        if (ec != std::errc() || ptr - first > static_cast<std::ptrdiff_t>(IPV6_HEX_GROUP_MAX_LENGTH)) {
+            return {first, std::errc::result_out_of_range};
+        }
 
-    size_t dbl_pos = addr.find("::");
-    if (dbl_pos != std::string::npos) {
-        // есть сокращение
-        std::string left = addr.substr(0, dbl_pos);
-        std::string right = addr.substr(dbl_pos + 2);
+        if (count == IPV6_HEX_GROUPS_COUNT) {
+            return {first, std::errc::invalid_argument};
+        }
 
-        std::vector<std::string> left_parts;
-        std::vector<std::string> right_parts;
-        if (!left.empty()) left_parts = split_by_colon(left);
-        if (!right.empty()) right_parts = split_by_colon(right);
+        groups[count++] = static_cast<uint16_t>(value);
+        isGroupExpected = false;
+        first = ptr;
 
-        // special case: "::" alone -> left_parts.empty() && right_parts.empty()
-        size_t missing = 8;
-        if (left_parts.size() + right_parts.size() <= 8) {
-            missing = 8 - (left_parts.size() + right_parts.size());
+        if (!isColonAt(first)) {
+            break;
+        }
+
+        ++first;
+
+        if (!isColonAt(first)) {
+            isGroupExpected = true;
+        } else if (hasGap) {
+            // Only one "::" is allowed
+            return {first, std::errc::invalid_argument};
         } else {
-            return false; // слишком много групп
+            ++first;
+            hasGap = true;
+            gapInx = count;
         }
+    }
 
-        parts = left_parts;
-        for (size_t i = 0; i < missing; ++i) parts.emplace_back("0");
-        parts.insert(parts.end(), right_parts.begin(), right_parts.end());
-    } else {
-        parts = split_by_colon(addr);
+    // "::" replaces at least one group
+    if (hasGap ? count >= IPV6_HEX_GROUPS_COUNT : count != IPV6_HEX_GROUPS_COUNT) {
+        return {first, std::errc::invalid_argument};
+    }
+
+    out = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        const size_t position = (hasGap && i >= gapInx) ? i + IPV6_HEX_GROUPS_COUNT - count : i;
+        out |= static_cast<addrIPv6>(groups[i]) << (16u * (IPV6_HEX_GROUPS_COUNT - 1 - position));
     }
 
-    if (parts.size() != 8) {
-        // возможно IPv4-совместимый формат не поддерживаем здесь
+    return {first, std::errc()};
+}
+
+bool Convert::parseIPv4(const std::string_view ip, IPv4Subnet& out, const bool isFixByBGP) {
+    const char* last = ip.data() + ip.size();
+    const auto [ptr, ec] = fromCharsIPv4(ip.data(), last, out.ip);
+
+    if (ec != std::errc()) {
         return false;
     }
 
-    // Парсим каждую 16-битную группу и записываем в bitset
-    // group_index = 0..7 (0 — самая левая группа), внутри группы j = 0..15 (старший бит — j=0)
-    for (size_t group_index = 0; group_index < 8; ++group_index) {
-        const std::string& grp = parts[group_index];
-        if (grp.empty()) return false; // на всякий случай
+    return parseSubnetIP(std::string_view(ptr, last - ptr), out, isFixByBGP);
+}
 
-        // допускаем 1..4 hex-символа
-        if (grp.size() > 4) return false;
+bool Convert::parseIPv6(const std::string_view ip, IPv6Subnet& out, const bool isFixByBGP) {
+    const char* last = ip.data() + ip.size();
+    const auto [ptr, ec] = fromCharsIPv6(ip.data(), last, out.ip);
 
-        unsigned long value = 0;
-        try {
-            value = std::stoul(grp, nullptr, 16);
-        } catch (...) {
+    if (ec != std::errc()) {
+        return false;
+    }
+
+    std::string_view rest(ptr, last - ptr);
+
+    if (!rest.empty() && rest.front() == '%') {
+        if (rest.size() == 1) {
+            // Empty zone
             return false;
         }
-        if (value > 0xFFFFUL) return false;
-
-        // для каждого бита внутри 16-битной группы:
-        // j = 0..15 — это позиция внутри группы, где j=0 соответствует старшему биту группы (1<<15)
-        for (int j = 0; j < 16; ++j) {
-            // проверяем старший первый (1 << (15 - j))
-            if (value & (1u << (15 - j))) {
-                // позиция в 128-битовом числе (0..127), где 127 — самый старший бит всего адреса
-                int ipv6_bit_index = static_cast<int>(group_index * 16 + j); // 0..127 (0 — старший бит группы0)
-                // переводим в индекс std::bitset (где 0 — LSB)
-                int bitset_index = 127 - ipv6_bit_index;
-                out.ip.set(bitset_index);
-            }
-        }
+
+        rest = {};
     }
 
-    return parseSubnetIP(ip, out);
+    return parseSubnetIP(rest, out, isFixByBGP);
 }
@@ -1,64 +1,34 @@
 #include "net_types_base.hpp"
 #include "exception.hpp"
 
+#include <arpa/inet.h>
 #include <netdb.h>
 #include <regex>
 
 template <>
 std::string NetTypes::IPv4Subnet::to_string() const {
-    auto v = static_cast<uint32_t>(ip.to_ullong());
-    int len = 0;
-    auto m = static_cast<uint32_t>(mask.to_ullong());
-    while (m) { len++; m <<= 1; }
-    len = 32 - len;
-
     std::ostringstream oss;
-    oss << ((v >> 24) & 0xFF) << '.'
-        << ((v >> 16) & 0xFF) << '.'
-        << ((v >>  8) & 0xFF) << '.'
-        << (v & 0xFF) << '/' << len;
+    oss << ((ip >> 24) & 0xFF) << '.'
+        << ((ip >> 16) & 0xFF) << '.'
+        << ((ip >>  8) & 0xFF) << '.'
+        << (ip & 0xFF) << '/' << static_cast<int>(prefix);
     return oss.str();
 }
 
 template <>
 std::string NetTypes::IPv6Subnet::to_string() const {
-    std::ostringstream oss;
-    bool started = false;
-
-    // Extract one 16-bit block (hextet) from the 128-bit IPv6 address
-    auto get16 = [&](int block) -> uint16_t {  // block: 0 to 7
-        uint16_t v = 0;
-        int bit_offset = 127 - block * 16;  // starting bit: 127, 111, ..., 15
-        for (int b = 0; b < 16; ++b) {
-            int bit = bit_offset - b;
-            if (ip.test(bit)) {
-                v |= static_cast<uint16_t>(1) << (15 - b);
-            }
-        }
-        return v;
-    };
-
-    auto print_part = [&](uint16_t p) {
-        if (started) oss << ':';
-        oss << std::hex << p;
-        started = true;
-    };
+    // Only 16 bytes in IPv6, the first one is in the highest bits
+    uint8_t bytes[16];
+    char ipstr[INET6_ADDRSTRLEN];
 
-    // Only 8 hextets in IPv6
-    for (int blk = 0; blk < 8; ++blk) {
-        print_part(get16(blk));
+    for (int i = 0; i < 16; ++i) {
+        bytes[i] = static_cast<uint8_t>(ip >> (120 - i * 8));
     }
 
-    // Count prefix length
-    int prefix = 0;
-    for (int i = 127; i >= 0; --i) {
-        if (mask.test(i)) ++prefix;
-        else break;
-    }
+    // Canonical text form (RFC 5952): lowercase hextets without leading zeros, longest zero run as "::"
+    inet_ntop(AF_INET6, bytes, ipstr, sizeof(ipstr));
 
-    oss << '/' << std::dec << prefix;
-    return oss.str();
+    return std::string(ipstr) + '/' + std::to_string(prefix);
 }
 
-
 // ===========================
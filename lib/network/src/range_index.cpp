@@ -0,0 +1,144 @@
+#include <array>
+#include <fstream>
+
+#include "range_index.hpp"
+#include "log.hpp"
+
+using namespace NetTypes;
+using namespace NetUtils;
+
+namespace {
+    constexpr std::array<char, 8> kIndexMagic = {'R', 'G', 'L', 'C', 'W', 'L', 'I', '\0'};
+
+    // Must be increased on any change of file layout
+    constexpr uint32_t kIndexVersion = 1u;
+
+    struct IndexHeader {
+        std::array<char, 8> magic;
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t key;           // Hash of source list and settings of its parsing
+        uint64_t createdAt;     // Unix time when domains of list were resolved
+        uint64_t v4Count;
+        uint64_t v6Count;
+        uint64_t domainsCount;
+    };
+
+    template <typename T>
+    void writeValue(std::ostream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    bool readValue(std::istream& in, T& value) {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+    }
+
+    template <typename T>
+    bool readRanges(std::istream& in, const uint64_t count, IPRangeSet<T>& outSet) {
+        std::vector<typename IPRangeSet<T>::Range> ranges(count);
+
+        for (auto& range : ranges) {
+            if (!readValue(in, range)) {
+                return false;
+            }
+        }
+
+        outSet = IPRangeSet<T>(std::move(ranges));
+
+        return true;
+    }
+}
+
+void RangeIndex::write(const fs::path& path, const IPRangeSetPair& ranges, const DomainSuffixSet& domains,
+                       const uint64_t key, const uint64_t createdAt) {
+    const auto& v4Ranges = ranges.v4.getRanges();
+    const auto& v6Ranges = ranges.v6.getRanges();
+
+    IndexHeader header{};
+    header.magic = kIndexMagic;
+    header.version = kIndexVersion;
+    header.key = key;
+    header.createdAt = createdAt;
+    header.v4Count = v4Ranges.size();
+    header.v6Count = v6Ranges.size();
+    header.domainsCount = domains.getDomains().size();
+
+    fs::create_directories(path.parent_path());
+
+    // Readers never see partially written index
+    const fs::path tempPath = path.string() + ".tmp";
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+
+    if (!file.is_open()) {
+        throw std::ios_base::failure(FILE_OPEN_ERROR_MSG + tempPath.string());
+    }
+
+    writeValue(file, header);
+
+    for (const auto& range : v4Ranges) {
+        writeValue(file, range);
+    }
+
+    for (const auto& range : v6Ranges) {
+        writeValue(file, range);
+    }
+
+    for (const auto& domain : domains.getDomains()) {
+        writeValue(file, static_cast<uint32_t>(domain.size()));
+        file.write(domain.data(), static_cast<std::streamsize>(domain.size()));
+    }
+
+    file.close();
+
+    if (!file) {
+        fs::remove(tempPath);
+        throw std::ios_base::failure("Failed to write range index on path: " + path.string());
+    }
+
+    fs::rename(tempPath, path);
+}
+
+bool RangeIndex::read(const fs::path& path, const uint64_t key, IPRangeSetPair& outRanges,
+                      DomainSuffixSet& outDomains, uint64_t& outCreatedAt) {
+    std::ifstream file(path, std::ios::binary);
+    IndexHeader header{};
+
+    if (!file.is_open() || !readValue(file, header)) {
+        return false;
+    }
+
+    if (header.magic != kIndexMagic || header.version != kIndexVersion || header.key != key) {
+        LOG_WARNING("Range index has unsupported format and will be rebuilt: {}", path.string());
+        return false;
+    }
+
+    IPRangeSetPair ranges;
+    DomainSuffixSet domains;
+
+    if (!readRanges(file, header.v4Count, ranges.v4) || !readRanges(file, header.v6Count, ranges.v6)) {
+        return false;
+    }
+
+    for (uint64_t i = 0; i < header.domainsCount; ++i) {
+        uint32_t size = 0;
+
+        if (!readValue(file, size)) {
+            return false;
+        }
+
+        std::string domain(size, '\0');
+
+        if (!file.read(domain.data(), size)) {
+            return false;
+        }
+
+        domains.insert(domain);
+    }
+
+    outRanges = std::move(ranges);
+    outDomains = std::move(domains);
+    outCreatedAt = header.createdAt;
+
+    return true;
+}
@@ -305,44 +305,3 @@ bool NetUtils::tryDownloadFile(const std::string& url, const std::string& filePa
     return false;
 }
 
-NetTypes::AddressType NetUtils::getAddressType(const std::string& input) {
-    try {
-        // IPv4 with mask /0–32
-        static const std::regex kPatternIPv4(
-            R"(^(25[0-5]|2[0-4]\d|1\d\d|[1-9]?\d)\.)"
-            R"((25[0-5]|2[0-4]\d|1\d\d|[1-9]?\d)\.)"
-            R"((25[0-5]|2[0-4]\d|1\d\d|[1-9]?\d)\.)"
-            R"((25[0-5]|2[0-4]\d|1\d\d|[1-9]?\d))"
-            R"((/(3[0-2]|[12]?\d))?$)"
-        );
-
-        // IPv6 (simplified, ECMAScript-compatible)
-        static const std::regex kPatternIPv6(
-            R"(([0-9a-fA-F]{1,4}:){7,7}[0-9a-fA-F]{1,4}|([0-9a-fA-F]{1,4}:){1,7}:|([0-9a-fA-F]{1,4}:){1,6}:[0-9a-fA-F]{1,4}|([0-9a-fA-F]{1,4}:){1,5}(:[0-9a-fA-F]{1,4}){1,2}|([0-9a-fA-F]{1,4}:){1,4}(:[0-9a-fA-F]{1,4}){1,3}|([0-9a-fA-F]{1,4}:){1,3}(:[0-9a-fA-F]{1,4}){1,4}|([0-9a-fA-F]{1,4}:){1,2}(:[0-9a-fA-F]{1,4}){1,5}|[0-9a-fA-F]{1,4}:((:[0-9a-fA-F]{1,4}){1,6})|:((:[0-9a-fA-F]{1,4}){1,7}|:)|fe80:(:[0-9a-fA-F]{0,4}){0,4}%[0-9a-zA-Z]{1,}|::(ffff(:0{1,4}){0,1}:){0,1}((25[0-5]|(2[0-4]|1{0,1}[0-9]){0,1}[0-9])\.){3,3}(25[0-5]|(2[0-4]|1{0,1}[0-9]){0,1}[0-9])|([0-9a-fA-F]{1,4}:){1,4}:((25[0-5]|(2[0-4]|1{0,1}[0-9]){0,1}[0-9])\.){3,3}(25[0-5]|(2[0-4]|1{0,1}[0-9]){0,1}[0-9]))"
-        );
-
-        static const std::regex kPatternDomain(
-            // Доменное имя: одна или более меток, разделённых точкой
-            // Каждая метка: 1–63 символа, не начинается и не заканчивается дефисом
-            // TLD: только буквы, минимум 2 символа
-            R"(^((?![0-9-])[A-Za-z0-9-]{0,62}[A-Za-z0-9]\.)*(?![0-9-])[A-Za-z0-9-]{0,62}[A-Za-z0-9]\.[A-Za-z]{2,63}$)"
-        );
-
-        if (std::regex_match(input, kPatternIPv4)) {
-            return NetTypes::AddressType::IPV4;
-        }
-        if (std::regex_match(input, kPatternIPv6)) {
-            return NetTypes::AddressType::IPV6;
-        }
-        if (std::regex_match(input, kPatternDomain) || input == "localhost") {
-            return NetTypes::AddressType::DOMAIN;
-        }
-
-        return NetTypes::AddressType::UNKNOWN;
-    }
-    catch (const std::regex_error& e) {
-        LOG_ERROR("Regex error occured after trying to get address type: ", e.what());
-        return NetTypes::AddressType::UNKNOWN;
-    }
-}
-
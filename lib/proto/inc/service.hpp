@@ -15,6 +15,7 @@ struct ServiceSettings {
     std::string addr = "0.0.0.0";
     in_port_t port = 50051;
     time_t timeout_sec = 10;
+    time_t bgp_refresh_sec = 0;     // Period of BGP dumps check, 0 disables background refresh
 };
 
 void runService(const ServiceSettings& settings, const ServiceCallbacks& callbacks);
@@ -18,6 +18,19 @@
 #include "v2ip_toolchain.hpp"
 #include "time_tools.hpp"
 
+static const fs::path gkBGPSnapshotDir = fs::path(std::getenv("HOME")) / ".cache" / "rglc" / "bgp";
+
+void initBGPSettings() {
+    const auto config = getCachedConfig();
+
+    gLibNetworkSettings.bgpDumpPaths = config->bgpDumpPaths;
+    gLibNetworkSettings.bgpUpdatePaths = config->bgpUpdatePaths;
+    gLibNetworkSettings.bgpTrieType = config->bgpTrieType;
+    gLibNetworkSettings.ipv4LookupType = config->ipv4LookupType;
+    gLibNetworkSettings.ipv6LookupType = config->ipv6LookupType;
+    gLibNetworkSettings.bgpSnapshotDir = gkBGPSnapshotDir.string();
+}
+
 std::optional<GeoReleases> buildListsHandler(const CmdArgs& args) {
     bool status = validateParsedFormats(args);
     std::optional<fs::path> outGeoipPath, outGeositePath;
@@ -41,7 +54,6 @@ std::optional<GeoReleases> buildListsHandler(const CmdArgs& args) {
 
     // ======== Init network lib settings
     gLibNetworkSettings.isSearchSubnetByBGP = args.isUseWhitelist;
-    gLibNetworkSettings.bgpDumpPath = config->bgpDumpPath;
     // ========
 
     const auto outDirPath = fs::path(args.outDirPath);
@@ -104,7 +116,7 @@ std::optional<GeoReleases> buildListsHandler(const CmdArgs& args) {
         }
 
         // Apply preprocessing
-        for (const auto&[fst, snd] : *downloads) {
+        for (const auto&[fst, snd, linesCount] : *downloads) {
             const auto& src = sourcesStorage.at(fst);
 
             status = true;
@@ -136,17 +148,38 @@ std::optional<GeoReleases> buildListsHandler(const CmdArgs& args) {
         }
 
         // SECTION - Preprocessing for removing duplicates
-        for (const auto& pair : *downloads) {
+        for (auto& pair : *downloads) {
             const auto& source = sourcesStorage.at(pair.first);
             const auto& path = pair.second.string();
             try {
-                const size_t removedCount = removeDuplicateLines(path);
+                size_t linesCount;
+                const size_t removedCount = removeDuplicateLines(path, nullptr, &linesCount);
+                pair.linesCount = linesCount;
                 LOG_INFO("Count of removed duplicates (id: {}, file: {}): {}", source.id, path, removedCount);
             } catch (std::ios_base::failure& e) {
                 LOG_WARNING("Failed to remove duplicates (id: {}, file: {}): {}", source.id, path, std::string(e.what()));
             }
         }
 
+        // SECTION - Aggregation of subnets in IP sources
+        for (auto& pair : *downloads) {
+            const auto& source = sourcesStorage.at(pair.first);
+            const auto& path = pair.second;
+
+            if (source.inetType != Source::InetType::IP) {
+                continue;
+            }
+
+            try {
+                size_t linesCount;
+                const size_t removedCount = aggregateAddressFile(path, &linesCount);
+                pair.linesCount = linesCount;
+                LOG_INFO("Count of subnets removed by aggregation (id: {}, file: {}): {}", source.id, path.string(), removedCount);
+            } catch (std::ios_base::failure& e) {
+                LOG_WARNING("Failed to aggregate subnets (id: {}, file: {}): {}", source.id, path.string(), std::string(e.what()));
+            }
+        }
+
         // SECTION - Move sources to toolchains
         clearDlcDataSection(config->dlcRootPath);
         v2ipSections.reserve(downloads->size());
@@ -312,14 +345,17 @@ std::optional<GeoReleases> buildListsHandler(const CmdArgs& args) {
                 const fs::path componentsDirPath = targetPath / "components";
                 fs::create_directories(componentsDirPath);
 
-                for (const auto&[id, path] : *downloads) {
+                for (const auto&[id, path, linesCount] : *downloads) {
                     const auto& source = sourcesStorage.at(id);
 
+                    // Count is recorded by deduplication or aggregation, file is read only if both failed
+                    const size_t count = linesCount.has_value() ? *linesCount : countLinesInFile(path);
+
                     if (source.inetType == Source::IP) {
-                        buildStats.subnetsCount += countLinesInFile(path);
+                        buildStats.subnetsCount += count;
                         ++buildStats.subnetsFilesCount;
                     } else {
-                        buildStats.domainsCount += countLinesInFile(path);
+                        buildStats.domainsCount += count;
                         ++buildStats.domainsFilesCount;
                     }
 
@@ -24,10 +24,13 @@
 #define SORT_SOURCES_BY_STORAGE_TYPE_DESCRIPTION    "Sort sources by storage type"
 #define SORT_SOURCES_BY_INET_TYPE_DESCRIPTION       "Sort sources by inet type"
 
+#define BGP_STATS_SUBCMD_DESC                   "Show memory and shape of tries built from BGP dumps in config"
+
 #define SERVICE_SUBCMD_DESC                     "Settings for service mode"
 #define SERVICE_ADDR_OPT_DESC                   "IP address for service"
 #define SERVICE_PORT_OPT_DESC                   "System port for service"
 #define SERVICE_TIMEOUT_OPT_DESC                "Timeout (sec) for service watchdog (leads to shutdown, 0 is infinite work)"
+#define SERVICE_BGP_REFRESH_OPT_DESC            "Period (sec) of BGP dumps reload in background (0 is loading on first request)"
 
 #define BUILD_MESSAGE_MAX_SIZE                  500
 
@@ -38,10 +41,12 @@ CLI::App* gServiceSubCmd;
 CLI::App* gBuildSubCmd;
 CLI::App* gCheckSubCmd;
 CLI::App* gShowSubCmd;
+CLI::App* gBGPStatsSubCmd;
 CLI::Option* gOutPathOption;
 
 static const CLI::Range gkServicePortRange = { 49152, 65535 };
 static const CLI::Range gkServiceTimeoutRange = { 0, HOURS_TO_SEC(1) };
+static const CLI::Range gkServiceBGPRefreshRange = { 0, HOURS_TO_SEC(24) };
 
 static const std::vector<std::string> gkAvailableGeoFormats = {
     GEO_FORMAT_DAT_CAPTION,
@@ -92,6 +97,10 @@ static void setupServiceSubcommand(CLI::App& app) {
     gServiceSubCmd->add_option("-t,--timeout", gServiceSettings.timeout_sec, SERVICE_TIMEOUT_OPT_DESC)
                    ->check(gkServiceTimeoutRange) // Extra timeout validation
                    ->capture_default_str();
+
+    gServiceSubCmd->add_option("-r,--bgp-refresh", gServiceSettings.bgp_refresh_sec, SERVICE_BGP_REFRESH_OPT_DESC)
+                   ->check(gkServiceBGPRefreshRange)
+                   ->capture_default_str();
 }
 
 static void setupShowSubcommand(CLI::App& app) {
@@ -121,6 +130,10 @@ static void setupShowSubcommand(CLI::App& app) {
         ->multi_option_policy(CLI::MultiOptionPolicy::TakeAll);
 }
 
+static void setupBGPStatsSubcommand(CLI::App& app) {
+    gBGPStatsSubCmd = app.add_subcommand("bgp-stats", BGP_STATS_SUBCMD_DESC);
+}
+
 void prepareCmdArgs(CLI::App& app) {
     app.description(RGC_DESCRIPTION);
 
@@ -128,6 +141,7 @@ void prepareCmdArgs(CLI::App& app) {
     setupShowSubcommand(app);
     setupBuildSubcommand(app);
     setupCheckSubcommand(app);
+    setupBGPStatsSubcommand(app);
 
     app.add_flag("--about", gCmdArgs.isShowAbout, ABOUT_OPTION_DESCRIPTION);
     app.add_flag("--init", gCmdArgs.isInit, INIT_OPTION_DESCRIPTION);
@@ -1,3 +1,6 @@
+#include <array>
+#include <utility>
+
 #include "config.hpp"
 #include "log.hpp"
 #include "json_io.hpp"
@@ -12,8 +15,88 @@
 const fs::path gkConfigPath = fs::path(std::getenv("HOME")) / ".config" / "ru-geolists-creator" / "config.json";
 
 static RgcConfig gkConfig;
+
+// Names of values of enum setting in config
+template <typename T, size_t N>
+using EnumNames = std::array<std::pair<const char*, T>, N>;
+
+static const EnumNames<BGPTrieType, 2> gkBGPTrieTypeNames = {{
+    {"patricia", BGPTrieType::PATRICIA},
+    {"radix", BGPTrieType::RADIX}
+}};
+
+static const EnumNames<IPv4LookupType, 2> gkIPv4LookupTypeNames = {{
+    {"trie", IPv4LookupType::TRIE},
+    {"dir-24-8", IPv4LookupType::DIR_24_8}
+}};
+
+static const EnumNames<IPv6LookupType, 2> gkIPv6LookupTypeNames = {{
+    {"trie", IPv6LookupType::TRIE},
+    {"tree-bitmap", IPv6LookupType::TREE_BITMAP}
+}};
+
+template <typename T, size_t N>
+static const char* enumToName(const T value, const EnumNames<T, N>& names) {
+    for (const auto& [name, namedValue] : names) {
+        if (namedValue == value) {
+            return name;
+        }
+    }
+
+    return names.front().first;
+}
+
+// Absent or null value keeps default one, false if name is unknown
+template <typename T, size_t N>
+static bool jsonToEnum(const Json::Value& value, const char* key, const EnumNames<T, N>& names, T& outValue) {
+    if (value[key].isNull()) {
+        return true;
+    }
+
+    const std::string name = value[key].asString();
+
+    for (const auto& [knownName, namedValue] : names) {
+        if (name == knownName) {
+            outValue = namedValue;
+            return true;
+        }
+    }
+
+    LOG_ERROR("Unknown value of '{}' in config: {}", key, name);
+
+    return false;
+}
 static bool gIsConfigSet = false;
 
+// One path is saved as string, several paths as array
+static Json::Value pathsToJson(const std::vector<std::string>& paths) {
+    if (paths.size() == 1) {
+        return paths.front();
+    }
+
+    if (paths.empty()) {
+        return Json::nullValue;
+    }
+
+    Json::Value pathsArray(Json::arrayValue);
+    for (const auto& path : paths) {
+        pathsArray.append(path);
+    }
+
+    return pathsArray;
+}
+
+// Path (or glob pattern) or array of them
+static void jsonToPaths(const Json::Value& value, std::vector<std::string>& outPaths) {
+    if (value.isArray()) {
+        for (const auto& path : value) {
+            outPaths.push_back(path.asString());
+        }
+    } else if (value.isString() && !value.asString().empty()) {
+        outPaths.push_back(value.asString());
+    }
+}
+
 bool writeConfig(const RgcConfig& config) {
     Json::Value value;
 
@@ -23,7 +106,11 @@ bool writeConfig(const RgcConfig& config) {
 
     SET_NULL_IF_EMPTY(value["apiToken"], config.apiToken);
     SET_NULL_IF_EMPTY(value["whitelistPath"], config.whitelistPath);
-    SET_NULL_IF_EMPTY(value["bgpDumpPath"], config.bgpDumpPath);
+    value["bgpDumpPath"] = pathsToJson(config.bgpDumpPaths);
+    value["bgpUpdatePath"] = pathsToJson(config.bgpUpdatePaths);
+    value["bgpTrieType"] = enumToName(config.bgpTrieType, gkBGPTrieTypeNames);
+    value["ipv4LookupType"] = enumToName(config.ipv4LookupType, gkIPv4LookupTypeNames);
+    value["ipv6LookupType"] = enumToName(config.ipv6LookupType, gkIPv6LookupTypeNames);
     SET_NULL_IF_EMPTY(value["singBoxBinaryPath"], config.singBoxBinaryPath);
 
     Json::Value sourcesArray(Json::arrayValue);
@@ -93,7 +180,19 @@ bool readConfig(RgcConfig& config) {
     config.geoMgrBinaryPath = value["geoMgrBinaryPath"].asString();
     config.apiToken = value["apiToken"].asString();
     config.whitelistPath = value["whitelistPath"].asString();
-    config.bgpDumpPath = value["bgpDumpPath"].asString();
+
+    // BGP dumps and MRT updates files applied on top of them
+    jsonToPaths(value["bgpDumpPath"], config.bgpDumpPaths);
+    jsonToPaths(value["bgpUpdatePath"], config.bgpUpdatePaths);
+
+    // Structures of BGP lookups, defaults are used for absent keys
+    if (!jsonToEnum(value, "bgpTrieType", gkBGPTrieTypeNames, config.bgpTrieType) ||
+        !jsonToEnum(value, "ipv4LookupType", gkIPv4LookupTypeNames, config.ipv4LookupType) ||
+        !jsonToEnum(value, "ipv6LookupType", gkIPv6LookupTypeNames, config.ipv6LookupType)) {
+        config = {};
+        return false;
+    }
+
     config.singBoxBinaryPath = value["singBoxBinaryPath"].asString();
 
     if (value["sources"].isArray()) {
@@ -1,39 +1,72 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <set>
+#include <sstream>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <string>
 #include <regex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "filter.hpp"
+#include "bounded_queue.hpp"
 #include "log.hpp"
 #include "common.hpp"
 #include "net_convert.hpp"
+#include "ipv4_bulk_parse.hpp"
+#include "fs_utils_lines.hpp"
 #include "url_handle.hpp"
 #include "cares_resolver.hpp"
 #include "config.hpp"
+#include "libnetwork_settings.hpp"
 
 #define FILTER_FILENAME_POSTFIX     "temp_filter"
+#define AGGREGATE_FILENAME_POSTFIX  "temp_aggregate"
 
-static bool parseAddress(const std::string& buffer, const NetTypes::ListIPvxPair& listsPair, NetTypes::ListAddress* domainBuffer=nullptr) {
+// Lines of file checked together by one stage of filter pipeline
+#define FILTER_CHUNK_LINES_COUNT    4096u
+// Chunks which may wait between two stages of pipeline
+#define FILTER_QUEUE_CHUNKS_COUNT   4u
+
+// Mask-less IPs, which subnets are searched in BGP dump by one batch
+struct PendingBGPFix {
+    std::vector<NetTypes::IPv4Subnet> v4;
+    std::vector<NetTypes::IPv6Subnet> v6;
+};
+
+static bool parseAddress(const std::string_view buffer, const NetTypes::ListIPvxPair& listsPair, NetTypes::ListAddress* domainBuffer=nullptr, PendingBGPFix* pending=nullptr) {
     bool status;
     NetTypes::AddressType type;
     NetTypes::IPv4Subnet bufferIPv4;
     NetTypes::IPv6Subnet bufferIPv6;
 
+    const bool isDeferFix = pending != nullptr &&
+                            gLibNetworkSettings.isSearchSubnetByBGP &&
+                            buffer.find('/') == std::string_view::npos;
+
     type = NetUtils::getAddressType(buffer);
 
     if (type == NetTypes::AddressType::IPV4) {
-        status = NetUtils::Convert::parseIPv4(buffer, bufferIPv4);
-        if (status) {
+        status = NetUtils::Convert::parseIPv4(buffer, bufferIPv4, !isDeferFix);
+        if (status && isDeferFix) {
+            pending->v4.push_back(bufferIPv4);
+        } else if (status) {
             listsPair.v4.push_front(bufferIPv4);
         }
     } else if (type == NetTypes::AddressType::IPV6) {
-        status = NetUtils::Convert::parseIPv6(buffer, bufferIPv6);
-        if (status) {
+        status = NetUtils::Convert::parseIPv6(buffer, bufferIPv6, !isDeferFix);
+        if (status && isDeferFix) {
+            pending->v6.push_back(bufferIPv6);
+        } else if (status) {
             listsPair.v6.push_front(bufferIPv6);
         }
     } else if (type == NetTypes::AddressType::DOMAIN && (domainBuffer != nullptr)) {
-        domainBuffer->push_front(buffer);
+        domainBuffer->emplace_front(buffer);
     } else if (type == NetTypes::AddressType::DOMAIN) {
         // Nothing to do, skipping
     } else { // NetTypes::AddressType::UNKNOWN
@@ -54,34 +87,75 @@ static bool parseAddress(const NetTypes::ListAddress& addrs, const NetTypes::Lis
     return status;
 }
 
-void parseAddressFile(const fs::path& path, NetTypes::ListIPvxPair& listsPair) {
-    std::ifstream file(path);
-    std::string buffer;
+static void applyPendingBGPFix(PendingBGPFix& pending, const NetTypes::ListIPvxPair& listsPair) {
+    const size_t skipped = NetUtils::Convert::fixSubnetsByBGP(pending.v4) +
+                           NetUtils::Convert::fixSubnetsByBGP(pending.v6);
+
+    listsPair.v4.insert_after(listsPair.v4.before_begin(), pending.v4.begin(), pending.v4.end());
+    listsPair.v6.insert_after(listsPair.v6.before_begin(), pending.v6.begin(), pending.v6.end());
+
+    if (skipped) {
+        LOG_INFO("{} IPs were skipped after subnet search in BGP dump", skipped);
+    }
+
+    pending.v4.clear();
+    pending.v6.clear();
+}
+
+// Mask-less IPs are deferred for batched subnet search in BGP dump like in parseAddress
+static void addBulkIPv4(const std::vector<NetTypes::IPv4Subnet>& subnets, const NetTypes::ListIPvxPair& listsPair, PendingBGPFix& pending) {
+    for (auto subnet : subnets) {
+        if (subnet.prefix != 0) {
+            listsPair.v4.push_front(subnet);
+            continue;
+        }
+
+        subnet.prefix = IPV4_BITS_COUNT;
+
+        if (gLibNetworkSettings.isSearchSubnetByBGP) {
+            pending.v4.push_back(subnet);
+        } else {
+            listsPair.v4.push_front(subnet);
+        }
+    }
+}
+
+void parseAddressFile(const fs::path& path, NetTypes::ListIPvxPair& listsPair, NetTypes::ListAddress* domains) {
+    const FS::Utils::LineSource file(path);
     bool status;
 
+    std::vector<NetTypes::IPv4Subnet> bulkIPv4;
+    std::vector<std::string_view> otherLines;
+
     NetTypes::ListAddress domainsBuffer;
     NetTypes::ListAddress uniqueIPs;
+    PendingBGPFix pendingFix;
 
     size_t ipv4Size;
     size_t ipv6Size;
 
-    if (!file.is_open()) {
-        throw std::ios_base::failure(FILE_OPEN_ERROR_MSG + path.string());
-    }
+    // IPv4 lines, which are the most of large lists, are parsed at once
+    NetUtils::Convert::parseIPv4Bulk(file.content(), bulkIPv4, otherLines);
+    addBulkIPv4(bulkIPv4, listsPair, pendingFix);
 
-    while (std::getline(file, buffer)) {
-        status = parseAddress(buffer, listsPair, &domainsBuffer);
+    for (const auto& line : otherLines) {
+        status = parseAddress(line, listsPair, &domainsBuffer, &pendingFix);
 
         if (!status) {
-            LOG_WARNING("An unknown entry was found in file with addresses, type could not be determined: " + buffer);
+            LOG_WARNING("An unknown entry was found in file with addresses, type could not be determined: {}", line);
         }
     }
 
+    if (domains != nullptr) {
+        domains->insert_after(domains->before_begin(), domainsBuffer.begin(), domainsBuffer.end());
+    }
+
     // ======== Convert all domains to IPv4 or IPv6
     NetUtils::CAresResolver resolver;
 
     if (!resolver.isInitialized()) {
         std::cerr << "Failed to init resolver\n";
+        applyPendingBGPFix(pendingFix, listsPair);
         return;
     }
 
@@ -90,16 +164,128 @@ void parseAddressFile(const fs::path& path, NetTypes::ListIPvxPair& listsPair) {
     domainsBuffer.clear();
 
     for (const auto& ip : uniqueIPs) {
-        parseAddress(ip, listsPair);
+        parseAddress(ip, listsPair, nullptr, &pendingFix);
     }
     // ========
 
+    // Subnets of all mask-less IPs are searched at once
+    applyPendingBGPFix(pendingFix, listsPair);
+
     ipv4Size = std::distance(listsPair.v4.begin(), listsPair.v4.end());
     ipv6Size = std::distance(listsPair.v6.begin(), listsPair.v6.end());
 
     LOG_INFO("File " + path.string() + " parsed to " + std::to_string(ipv4Size) + " IPv4 entities and " + std::to_string(ipv6Size) + " IPv6 entities");
 }
 
+size_t aggregateAddressFile(const fs::path& path, size_t* linesCount) {
+    const fs::path tempFilePath = addPathPostfix(path, AGGREGATE_FILENAME_POSTFIX);
+
+    std::ofstream fileTemp;
+
+    NetTypes::ListIPv4 ipv4;
+    NetTypes::ListIPv6 ipv6;
+    std::vector<std::string> otherLines;
+
+    size_t inCount = 0;
+
+    {
+        const FS::Utils::LineSource file(path);
+
+        std::vector<NetTypes::IPv4Subnet> bulkIPv4;
+        std::vector<std::string_view> bulkOtherLines;
+
+        NetUtils::Convert::parseIPv4Bulk(file.content(), bulkIPv4, bulkOtherLines);
+
+        inCount = bulkIPv4.size() + bulkOtherLines.size();
+
+        // Mask-less IP is a single host here, subnets are not searched in BGP dump
+        for (auto subnet : bulkIPv4) {
+            const bool hasPrefix = subnet.prefix != 0;
+
+            if (!hasPrefix) {
+                subnet.prefix = IPV4_BITS_COUNT;
+            }
+
+            if (!subnet.isCorrupted()) {
+                ipv4.push_front(subnet);
+            } else if (hasPrefix) {
+                otherLines.push_back(subnet.to_string());
+            } else {
+                // Only zero address is corrupted, it is kept as is
+                otherLines.emplace_back("0.0.0.0");
+            }
+        }
+
+        for (const auto& line : bulkOtherLines) {
+            const auto info = NetUtils::classifyAddress(line);
+
+            if (info.type == NetTypes::AddressType::IPV6) {
+                auto subnet = std::get<NetTypes::IPv6Subnet>(info.subnet);
+
+                if (subnet.prefix == 0) {
+                    subnet.prefix = IPV6_BITS_COUNT;
+                }
+
+                if (!subnet.isCorrupted()) {
+                    ipv6.push_front(subnet);
+                    continue;
+                }
+            }
+
+            // Entry is kept as is, if it can not be aggregated
+            otherLines.emplace_back(line);
+        }
+    }
+
+    const auto subnetsIPv4 = NetTypes::IPv4RangeSet(ipv4).toSubnets();
+    const auto subnetsIPv6 = NetTypes::IPv6RangeSet(ipv6).toSubnets();
+
+    fileTemp.open(tempFilePath);
+
+    if (!fileTemp.is_open()) {
+        throw std::ios_base::failure(FILE_OPEN_ERROR_MSG + tempFilePath.string());
+    }
+
+    try {
+        for (const auto& line : otherLines) {
+            fileTemp << line << '\n';
+        }
+
+        for (const auto& subnet : subnetsIPv4) {
+            fileTemp << subnet.to_string() << '\n';
+        }
+
+        for (const auto& subnet : subnetsIPv6) {
+            fileTemp << subnet.to_string() << '\n';
+        }
+
+        fileTemp.close();
+
+        if (!fileTemp) {
+            throw std::ios_base::failure("Failed to write aggregated file on path: " + tempFilePath.string());
+        }
+    } catch (...) {
+        // Source file is kept as is, partial output is dropped
+        std::error_code ec;
+
+        fileTemp.close();
+        fs::remove(tempFilePath, ec);
+
+        throw;
+    }
+
+    fs::remove(path);
+    fs::rename(tempFilePath, path);
+
+    const size_t outCount = otherLines.size() + subnetsIPv4.size() + subnetsIPv6.size();
+
+    if (linesCount != nullptr) {
+        *linesCount = outCount;
+    }
+
+    return inCount > outCount ? inCount - outCount : 0;
+}
+
 bool isUrl(const std::string& str) {
     static const std::regex url_regex(
         R"(^[a-zA-Z][a-zA-Z0-9+.\-]*://)"
@@ -108,160 +294,422 @@ bool isUrl(const std::string& str) {
 }
 
 template <typename T>
-static bool checkIPvxByLists(NetTypes::ListIPvx<T>& current, const NetTypes::ListIPvx<T>& lists, std::forward_list<uint32_t>* removeInxs=nullptr) {
-    bool checkResult = false;
-    size_t index = 0;
+static bool checkIPvxByRanges(const NetTypes::ListIPvx<T>& current, const NetTypes::IPRangeSet<T>& ranges) {
+    for (const auto& cIP : current) {
+        if (ranges.isOverlaps(cIP)) {
+            return true;
+        }
+    }
+
+    return false;
+}
 
+// Parts of subnets which are not in ranges, written in place of original entry
+template <typename T>
+static void writeSubnetsOutOfRanges(std::ostream& out, const NetTypes::ListIPvx<T>& current, const NetTypes::IPRangeSet<T>& ranges) {
     for (const auto& cIP : current) {
-        for (const auto& lIP : lists) {
-            if (const bool status = lIP.isSubnetIncludes(cIP); status && (removeInxs == nullptr)) {
-                return true;
-            } else if (status) {
-                checkResult = true;
-                removeInxs->push_front(index);
-
-                break;
-            }
+        for (const auto& subnet : ranges.subtract(cIP)) {
+            out << subnet.to_string() << '\n';
         }
-        ++index;
+    }
+}
+
+// Lines of file which pass stages of check together
+struct FilterChunk {
+    enum class Verdict {
+        KEEP,       // Written as is
+        DROP,       // Not written
+        REPLACE,    // Replacement is written instead of line
+        DOMAIN      // Verdict is set after resolving
+    };
+
+    struct Line {
+        std::string_view text;          // Points into source of checked file, which outlives chunks
+        Verdict verdict = Verdict::KEEP;
+        std::string replacement;
+    };
+
+    std::vector<Line> lines;
+    std::vector<size_t> domainInxs;     // Lines which must be resolved
+    bool isFound = false;               // Any entry overlaps whitelist
+};
+
+// Context of one checked file shared by stages
+struct FilterContext {
+    const fs::path& path;
+    const WhitelistIndex& whitelist;
+    NetUtils::CAresResolver& resolver;
+    std::ofstream* out;                 // nullptr if fix is not applied
+
+    float prevProgress = 0.0f;
+    size_t linesCount = 0;
+    size_t doneCount = 0;
+};
+
+static bool readFilterChunk(FS::Utils::LineSource& file, FilterChunk& chunk) {
+    std::string_view line;
+
+    while (chunk.lines.size() < FILTER_CHUNK_LINES_COUNT && file.next(line)) {
+        chunk.lines.push_back({line, FilterChunk::Verdict::KEEP, {}});
     }
 
-    return checkResult;
+    return !chunk.lines.empty();
 }
 
+// Line is replaced with parts of its subnets out of whitelist, if any of them overlaps it
+static void checkLineAddresses(FilterChunk& chunk, FilterChunk::Line& line, const NetTypes::ListIPv4& ipv4,
+                               const NetTypes::ListIPv6& ipv6, const FilterContext& ctx) {
+    const auto& ranges = ctx.whitelist.ranges;
 
-bool checkFileByIPvLists(const fs::path& path, const NetTypes::ListIPvxPair& listsPair, bool applyFix) {
-    const fs::path tempFilePath = addPathPostfix(path, FILTER_FILENAME_POSTFIX);
+    if (!checkIPvxByRanges(ipv4, ranges.v4) && !checkIPvxByRanges(ipv6, ranges.v6)) {
+        return;
+    }
+
+    LOG_INFO("Detection in search between file and IP lists: {} --> {}", line.text, ctx.path.string());
+
+    // Only whitelisted part of subnet is removed
+    std::ostringstream replacement;
+    writeSubnetsOutOfRanges(replacement, ipv4, ranges.v4);
+    writeSubnetsOutOfRanges(replacement, ipv6, ranges.v6);
+
+    line.verdict = FilterChunk::Verdict::REPLACE;
+    line.replacement = replacement.str();
+    chunk.isFound = true;
+}
 
-    // listsPair is from whitelist (in most cases)
+// Subnets of mask-less IPs of chunk are searched in BGP dump by one batch, then their lines are checked.
+// BGP prefix is not written in place of host, so line is dropped only if host itself is whitelisted
+template <typename T>
+static void checkPendingBGPFix(FilterChunk& chunk, std::vector<NetTypes::IPvx<T>>& pending,
+                               const std::vector<size_t>& lineInxs, const FilterContext& ctx) {
+    std::vector<bool> isFixed;
+    const std::vector<NetTypes::IPvx<T>> hosts = pending;
+
+    NetUtils::Convert::fixSubnetsByBGP(pending, isFixed);
+
+    const auto& ranges = [&ctx]() -> const NetTypes::IPRangeSet<T>& {
+        if constexpr (std::is_same_v<T, NetTypes::addrIPv4>) {
+            return ctx.whitelist.ranges.v4;
+        } else {
+            return ctx.whitelist.ranges.v6;
+        }
+    }();
+
+    for (size_t i = 0; i < pending.size(); ++i) {
+        // IP without proper subnet is not checked, like in single lookup
+        if (!isFixed[i] || !ranges.isOverlaps(hosts[i])) {
+            continue;
+        }
 
-    //  ======= Variables for file, which will be checked
+        auto& line = chunk.lines[lineInxs[i]];
+
+        LOG_INFO("Detection in search between file and IP lists: {} --> {}", line.text, ctx.path.string());
+
+        line.verdict = FilterChunk::Verdict::DROP;
+        chunk.isFound = true;
+    }
+}
+
+// Type of every line, whitelisted domains and IPs are checked without DNS
+static void classifyFilterChunk(FilterChunk& chunk, const FilterContext& ctx) {
     NetTypes::ListIPv4 currIPv4;
     NetTypes::ListIPv6 currIPv6;
 
-    NetTypes::ListIPvxPair currListsPair = {
+    const NetTypes::ListIPvxPair currListsPair = {
         currIPv4,
         currIPv6
     };
 
-    NetTypes::ListAddress uniqueIPs;
-    // =======
+    PendingBGPFix pendingFix;
+    std::vector<size_t> pendingInxsV4;
+    std::vector<size_t> pendingInxsV6;
 
-    std::ifstream file;
-    std::ofstream fileTemp;
+    for (size_t i = 0; i < chunk.lines.size(); ++i) {
+        auto& line = chunk.lines[i];
+        const auto type = NetUtils::getAddressType(line.text);
 
-    std::string buffer;
-    NetTypes::ListAddress domainBatch;
+        if (type == NetTypes::AddressType::UNKNOWN) {
+            LOG_WARNING("An unknown entry was found in file with addresses, the type could not be determined: {}", line.text);
+            line.verdict = FilterChunk::Verdict::DROP;
+            continue;
+        }
 
-    std::forward_list<uint32_t> removeInxs;
+        if (type == NetTypes::AddressType::DOMAIN && ctx.whitelist.domains.isMatches(line.text)) {
+            // Domain or its parent is whitelisted, DNS is not needed
+            LOG_INFO("Detection in search between file and whitelisted domains: {} --> {}", line.text, ctx.path.string());
+            line.verdict = FilterChunk::Verdict::DROP;
+            chunk.isFound = true;
+            continue;
+        }
 
-    bool status;
-    bool isFoundAny(false);
+        if (type == NetTypes::AddressType::DOMAIN) {
+            line.verdict = FilterChunk::Verdict::DOMAIN;
+            chunk.domainInxs.push_back(i);
+            continue;
+        }
 
-    float progress;
-    const size_t linesCount = countLinesInFile(path);
-    size_t currSize(0);
-    size_t currPerfCount(0);
+        parseAddress(line.text, currListsPair, nullptr, &pendingFix);
 
-    NetUtils::CAresResolver resolver;
+        // Mask-less IP is deferred, its line is checked after batched search in BGP dump
+        pendingInxsV4.resize(pendingFix.v4.size(), i);
+        pendingInxsV6.resize(pendingFix.v6.size(), i);
 
-    if (!resolver.isInitialized()) {
-        LOG_ERROR("Failed to init CAres domain resolver");
-        return false;
+        checkLineAddresses(chunk, line, currIPv4, currIPv6, ctx);
+
+        // Addresses of this line are checked, next one starts from empty lists
+        currIPv4.clear();
+        currIPv6.clear();
     }
 
-    file.open(path);
+    checkPendingBGPFix(chunk, pendingFix.v4, pendingInxsV4, ctx);
+    checkPendingBGPFix(chunk, pendingFix.v6, pendingInxsV6, ctx);
+}
 
-    if (!file.is_open()) {
-        throw std::ios_base::failure(FILE_OPEN_ERROR_MSG + path.string());
-    }
+// True if any IP of domain overlaps whitelist
+static bool checkResolvedDomain(const NetTypes::ListAddress& ips, const WhitelistIndex& whitelist) {
+    NetTypes::ListIPv4 currIPv4;
+    NetTypes::ListIPv6 currIPv6;
 
-    if (applyFix) {
-        fileTemp.open(tempFilePath);
+    const NetTypes::ListIPvxPair currListsPair = {
+        currIPv4,
+        currIPv6
+    };
 
-        if (!fileTemp.is_open()) {
-            throw std::ios_base::failure(FILE_OPEN_ERROR_MSG + tempFilePath.string());
-        }
-    }
+    parseAddress(ips, currListsPair);
+
+    return checkIPvxByRanges(currIPv4, whitelist.ranges.v4) || checkIPvxByRanges(currIPv6, whitelist.ranges.v6);
+}
 
-    while (std::getline(file, buffer)) {
-        auto type = NetUtils::getAddressType(buffer);
-        bool isTypeDomain = type == NetTypes::AddressType::DOMAIN;
+// Domains which were not judged before (in this or other files) are resolved by batches,
+// domain is dropped only if its own IPs overlap whitelist
+static void resolveFilterChunk(FilterChunk& chunk, const FilterContext& ctx) {
+    auto& verdicts = ctx.whitelist.verdicts;
+    std::vector<std::string> unknownDomains;
 
-        status = false;
+    // Verdicts used by this chunk, shared ones may be evicted before chunk is done
+    std::unordered_map<std::string_view, bool> chunkVerdicts;
 
-        removeInxs.clear();
+    for (const size_t inx : chunk.domainInxs) {
+        const std::string_view domain = chunk.lines[inx].text;
 
-        if (type == NetTypes::AddressType::UNKNOWN) {
-            LOG_WARNING("An unknown entry was found in file with addresses, the type could not be determined: " + buffer);
+        if (chunkVerdicts.count(domain) != 0) {
             continue;
         }
 
-        if (isTypeDomain) {
-            domainBatch.push_front(buffer);
-            ++currSize;
+        const auto verdict = verdicts.find(domain);
+        chunkVerdicts.emplace(domain, verdict.value_or(false));
+
+        if (!verdict) {
+            unknownDomains.emplace_back(domain);
         }
+    }
 
-        if (isTypeDomain && (currSize == RESOLVE_BATCH_SIZE || currPerfCount == linesCount - 1)) {
-            resolver.resolveDomains(domainBatch, uniqueIPs);
-            parseAddress(uniqueIPs, currListsPair);
+    for (size_t begin = 0; begin < unknownDomains.size(); begin += RESOLVE_BATCH_SIZE) {
+        const size_t end = std::min<size_t>(begin + RESOLVE_BATCH_SIZE, unknownDomains.size());
 
-            status |= checkIPvxByLists(currIPv4, listsPair.v4, &removeInxs);
-            status |= checkIPvxByLists(currIPv6, listsPair.v6, &removeInxs);
+        NetTypes::ListAddress domainBatch(unknownDomains.begin() + begin, unknownDomains.begin() + end);
+        NetUtils::ResolvedHosts resolved;
 
-            currPerfCount += currSize;
-        } else if (isTypeDomain) {
-            // Not enough recording in batch, skipping
-            continue;
+        ctx.resolver.resolveHosts(domainBatch, resolved);
+
+        for (const auto& domain : domainBatch) {
+            const auto it = resolved.find(domain);
+
+            // Failed lookup is not cached: domain is kept now and resolved again when it is met later
+            if (it == resolved.end() || it->second.empty()) {
+                continue;
+            }
+
+            const bool isFound = checkResolvedDomain(it->second, ctx.whitelist);
+
+            verdicts.insert(domain, isFound);
+            chunkVerdicts.find(domain)->second = isFound;
+        }
+    }
+
+    for (const size_t inx : chunk.domainInxs) {
+        auto& line = chunk.lines[inx];
+
+        if (chunkVerdicts.at(line.text)) {
+            LOG_INFO("Detection in search between file and IP lists: {} --> {}", line.text, ctx.path.string());
+            line.verdict = FilterChunk::Verdict::DROP;
+            chunk.isFound = true;
         } else {
-            parseAddress(buffer, currListsPair);
+            line.verdict = FilterChunk::Verdict::KEEP;
+        }
+    }
+}
+
+static bool writeFilterChunk(const FilterChunk& chunk, FilterContext& ctx) {
+    if (ctx.out != nullptr) {
+        for (const auto& line : chunk.lines) {
+            if (line.verdict == FilterChunk::Verdict::KEEP) {
+                *ctx.out << line.text << '\n';
+            } else if (line.verdict == FilterChunk::Verdict::REPLACE) {
+                *ctx.out << line.replacement;
+            }
+        }
+    }
 
-            status |= checkIPvxByLists(currIPv4, listsPair.v4);
-            status |= checkIPvxByLists(currIPv6, listsPair.v6);
+    ctx.doneCount += chunk.lines.size();
 
-            ++currPerfCount;
+    const float progress = std::min(static_cast<float>(ctx.doneCount) / static_cast<float>(ctx.linesCount), 1.0f);
+    logFilterCheckProgress(ctx.path.filename().string(), progress, ctx.prevProgress);
+
+    return chunk.isFound;
+}
+
+static bool runFilterSequential(FS::Utils::LineSource& file, FilterContext& ctx) {
+    bool isFoundAny = false;
+    FilterChunk chunk;
+
+    while (readFilterChunk(file, chunk)) {
+        classifyFilterChunk(chunk, ctx);
+        resolveFilterChunk(chunk, ctx);
+        isFoundAny |= writeFilterChunk(chunk, ctx);
+
+        chunk = FilterChunk();
+    }
+
+    return isFoundAny;
+}
+
+// Reader, classifier and resolver are run in their own threads, writer is run by caller.
+// Queues keep order of chunks, so output is the same as in sequential mode
+static bool runFilterPipeline(FS::Utils::LineSource& file, FilterContext& ctx) {
+    BoundedQueue<FilterChunk> readQueue(FILTER_QUEUE_CHUNKS_COUNT);
+    BoundedQueue<FilterChunk> classifyQueue(FILTER_QUEUE_CHUNKS_COUNT);
+    BoundedQueue<FilterChunk> resolveQueue(FILTER_QUEUE_CHUNKS_COUNT);
+
+    std::array<std::exception_ptr, 3> errors;
+    bool isFoundAny = false;
+
+    // Stage fails as a whole: queues are closed, so other stages stop too
+    const auto closeAll = [&]() {
+        readQueue.close();
+        classifyQueue.close();
+        resolveQueue.close();
+    };
+
+    std::thread reader([&]() {
+        try {
+            FilterChunk chunk;
+
+            while (readFilterChunk(file, chunk) && readQueue.push(std::move(chunk))) {
+                chunk = FilterChunk();
+            }
+
+            readQueue.close();
+        } catch (...) {
+            errors[0] = std::current_exception();
+            closeAll();
         }
+    });
 
-        // На данном этапе
-        // IPv4 / IPv6 - в status лежит состояние
-        // Domain - в status лежит состояние, в removeInxs индексы к удалению
+    std::thread classifier([&]() {
+        try {
+            while (auto chunk = readQueue.pop()) {
+                classifyFilterChunk(*chunk, ctx);
 
-        isFoundAny |= status;
+                if (!classifyQueue.push(std::move(*chunk))) {
+                    break;
+                }
+            }
 
-        if (!status && !applyFix) {
-            // Record is valid, skipping
-            continue;
-        } else if (!status) {
-            if (isTypeDomain) {
-                removeListItemsForInxs(domainBatch, removeInxs);
+            classifyQueue.close();
+        } catch (...) {
+            errors[1] = std::current_exception();
+            closeAll();
+        }
+    });
+
+    std::thread resolver([&]() {
+        try {
+            while (auto chunk = classifyQueue.pop()) {
+                resolveFilterChunk(*chunk, ctx);
 
-                for (const auto& domain : domainBatch) {
-                    fileTemp << domain << '\n';
+                if (!resolveQueue.push(std::move(*chunk))) {
+                    break;
                 }
-            } else {
-                fileTemp << buffer << '\n';
             }
+
+            resolveQueue.close();
+        } catch (...) {
+            errors[2] = std::current_exception();
+            closeAll();
         }
+    });
+
+    std::exception_ptr writerError;
 
-        if (isTypeDomain) {
-            domainBatch.clear();
-            currSize = 0;
+    try {
+        while (auto chunk = resolveQueue.pop()) {
+            isFoundAny |= writeFilterChunk(*chunk, ctx);
         }
+    } catch (...) {
+        writerError = std::current_exception();
+        closeAll();
+    }
 
-        if (status && isTypeDomain) {
-            LOG_INFO("Detection in search between file and IP lists: domain batch");
-        } else if (status) {
-            LOG_INFO("Detection in search between file and IP lists: " + buffer + " --> " + path.string());
+    reader.join();
+    classifier.join();
+    resolver.join();
+
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
         }
+    }
 
-        progress = std::min(static_cast<float>(currPerfCount) / static_cast<float>(linesCount), 100.0f);
-        logFilterCheckProgress(progress);
+    if (writerError) {
+        std::rethrow_exception(writerError);
     }
 
-    if (file.is_open()) {
-        file.close();
+    return isFoundAny;
+}
+
+bool checkFileByIPvLists(const fs::path& path, const WhitelistIndex& whitelist, NetUtils::CAresResolver& resolver, bool applyFix, bool isPipelined) {
+    const fs::path tempFilePath = addPathPostfix(path, FILTER_FILENAME_POSTFIX);
+
+    // Lines of chunks point into source, it is released before file is replaced
+    std::optional<FS::Utils::LineSource> file;
+    std::ofstream fileTemp;
+
+    bool isFoundAny;
+
+    file.emplace(path);
+
+    if (applyFix) {
+        fileTemp.open(tempFilePath);
+
+        if (!fileTemp.is_open()) {
+            throw std::ios_base::failure(FILE_OPEN_ERROR_MSG + tempFilePath.string());
+        }
     }
 
+    FilterContext ctx = {path, whitelist, resolver, applyFix ? &fileTemp : nullptr};
+    ctx.linesCount = std::max<size_t>(FS::Utils::countLines(file->content()), 1);
+
+    try {
+        if (isPipelined) {
+            isFoundAny = runFilterPipeline(*file, ctx);
+        } else {
+            isFoundAny = runFilterSequential(*file, ctx);
+        }
+    } catch (...) {
+        // Checked file is kept as is, partial output is dropped
+        if (applyFix) {
+            std::error_code ec;
+
+            fileTemp.close();
+            fs::remove(tempFilePath, ec);
+        }
+
+        throw;
+    }
+
+    file.reset();
+
     if (applyFix && fileTemp.is_open()) {
         fileTemp.close();
 
@@ -272,26 +720,69 @@ bool checkFileByIPvLists(const fs::path& path, const NetTypes::ListIPvxPair& lis
     return isFoundAny;
 }
 
-void filterDownloadsByWhitelist(const std::vector<DownloadedSourcePair>& downloadedFiles) {
-    NetTypes::ListIPv4 ipv4;
-    NetTypes::ListIPv6 ipv6;
+static unsigned getFilterThreadsCount(const size_t filesCount) {
+    const unsigned count = std::max(1u, std::thread::hardware_concurrency());
 
-    NetTypes::ListIPvxPair listsPair = {
-        ipv4,
-        ipv6
-    };
+    return static_cast<unsigned>(std::min<size_t>(count, filesCount));
+}
+
+static void filterDownloadByWhitelist(const fs::path& path, const WhitelistIndex& whitelist, NetUtils::CAresResolver& resolver) {
+    LOG_INFO("Checking for whitelist entries: " + path.string());
+
+    if (const bool status = checkFileByIPvLists(path, whitelist, resolver, true); !status) {
+        LOG_INFO("File [" + path.filename().string() + "] was checked successfully, no filter applied");
+    } else {
+        LOG_WARNING("File [" + path.filename().string() + "] was checked successfully, whitelist filter was applied");
+    }
+}
 
+void filterDownloadsByWhitelist(const std::vector<DownloadedSourcePair>& downloadedFiles) {
     const auto config = getCachedConfig();
 
-    parseAddressFile(config->whitelistPath, listsPair);
+    // Whitelist is compiled once for all files (and reused by next presets)
+    const auto pwhitelist = loadWhitelistIndex(config->whitelistPath);
+    const WhitelistIndex& whitelist = *pwhitelist;
 
-    for (const auto&[fst, snd] : downloadedFiles) {
-        LOG_INFO("Checking for whitelist entries: " + snd.string());
+    const unsigned threadsCount = getFilterThreadsCount(downloadedFiles.size());
 
-        if (const bool status = checkFileByIPvLists(snd, listsPair, true); !status) {
-            LOG_INFO("File [" + snd.filename().string() + "] was checked successfully, no filter applied");
-        } else {
-            LOG_WARNING("File [" + snd.filename().string() + "] was checked successfully, whitelist filter was applied");
+    // Resolver serializes queries of its channel, so every thread gets own one.
+    // They are created here, because init of c-ares library is not thread safe
+    std::vector<std::unique_ptr<NetUtils::CAresResolver>> resolvers;
+
+    for (unsigned i = 0; i < threadsCount; ++i) {
+        resolvers.push_back(std::make_unique<NetUtils::CAresResolver>());
+
+        if (!resolvers.back()->isInitialized()) {
+            LOG_ERROR("Failed to init CAres domain resolver");
+            return;
+        }
+    }
+
+    std::vector<std::exception_ptr> errors(threadsCount);
+    std::atomic<size_t> nextFile{0};
+    std::vector<std::thread> threads;
+
+    LOG_INFO("{} files are checked for whitelist entries by {} threads", downloadedFiles.size(), threadsCount);
+
+    for (unsigned i = 0; i < threadsCount; ++i) {
+        threads.emplace_back([&, i]() {
+            try {
+                for (size_t fileInx = nextFile++; fileInx < downloadedFiles.size(); fileInx = nextFile++) {
+                    filterDownloadByWhitelist(downloadedFiles[fileInx].second, whitelist, *resolvers[i]);
+                }
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
         }
     }
 }
@@ -302,30 +793,27 @@ bool extractDomainsInPlace(const std::string& filePath) {
         return false;
     }
 
-    std::ifstream inputFile(filePath);
-    if (!inputFile.is_open()) {
-        LOG_ERROR("Failed to open file for reading: {}", filePath);
-        return false;
-    }
-
     std::set<std::string> domains;
     static const std::regex kDomainSearcher(R"(([a-zA-Z0-9-]+\.)+[a-zA-Z]{2,63})");
 
-    std::string line;
-    while (std::getline(inputFile, line)) {
-        if (line.empty() || line[0] == '!' || line[0] == '#') {
-            continue;
-        }
-
-        std::smatch match;
-        if (std::regex_search(line, match, kDomainSearcher)) {
-            std::string found = match.str();
-            std::transform(found.begin(), found.end(), found.begin(),
-                           [](unsigned char c){ return std::tolower(c); });
-            domains.insert(found);
+    try {
+        // Source is released before file is truncated
+        FS::Utils::LineSource inputFile(filePath, {false, true, "!#"});
+
+        std::string_view line;
+        while (inputFile.next(line)) {
+            std::cmatch match;
+            if (std::regex_search(line.data(), line.data() + line.size(), match, kDomainSearcher)) {
+                std::string found = match.str();
+                std::transform(found.begin(), found.end(), found.begin(),
+                               [](unsigned char c){ return std::tolower(c); });
+                domains.insert(found);
+            }
         }
+    } catch (const std::ios_base::failure&) {
+        LOG_ERROR("Failed to open file for reading: {}", filePath);
+        return false;
     }
-    inputFile.close();
 
     std::ofstream outputFile(filePath, std::ios::trunc);
     if (!outputFile.is_open()) {
@@ -7,6 +7,9 @@
 #include "url_handle.hpp"
 #include "geo_manager.hpp"
 #include "fs_utils_temp.hpp"
+#include "bgp_cache.hpp"
+#include "cli_draw.hpp"
+#include "libnetwork_settings.hpp"
 
 #include <string>
 
@@ -140,6 +143,50 @@ void checkSourcesAvailability(const CmdArgs& args) {
     }
 }
 
+bool showBGPStats() {
+    if (gLibNetworkSettings.bgpDumpPaths.empty()) {
+        LOG_WARNING("BGP dump path is not specified in config");
+        return false;
+    }
+
+    const auto ptrie = NetUtils::BGP::loadTrieToCache(gLibNetworkSettings.bgpDumpPaths);
+
+    if (ptrie == nullptr) {
+        LOG_ERROR("No BGP dumps are loaded, statistics can not be shown");
+        return false;
+    }
+
+    const auto stats = ptrie->getStats();
+
+    TablePrinter table({"Parameter", "IPv4", "IPv6"});
+    table.addRow({"Nodes", std::to_string(stats.v4.nodesCount), std::to_string(stats.v6.nodesCount)});
+    table.addRow({"Routes", std::to_string(stats.v4.routesCount), std::to_string(stats.v6.routesCount)});
+    table.addRow({"Allocated (KiB)", std::to_string(stats.v4.allocatedBytes / 1024), std::to_string(stats.v6.allocatedBytes / 1024)});
+    table.addRow({"Sampled lookups", std::to_string(stats.v4.sampledLookupsCount), std::to_string(stats.v6.sampledLookupsCount)});
+    table.addRow({"Average lookup depth", fmt::format("{:.2f}", stats.v4.avgLookupDepth), fmt::format("{:.2f}", stats.v6.avgLookupDepth)});
+
+    std::cout << "\n==== BGP TRIES ====\n" << std::endl;
+    table.print(std::cout);
+    std::cout << "Compiled lookup tables (KiB): " << stats.compiledBytes / 1024 << std::endl;
+
+    // Only depths with routes are shown
+    TablePrinter depthTable({"Depth", "IPv4 routes", "IPv6 routes"});
+
+    for (size_t depth = 0; depth < stats.v6.depthHistogram.size(); ++depth) {
+        const size_t countV4 = depth < stats.v4.depthHistogram.size() ? stats.v4.depthHistogram[depth] : 0;
+        const size_t countV6 = stats.v6.depthHistogram[depth];
+
+        if (countV4 || countV6) {
+            depthTable.addRow({std::to_string(depth), std::to_string(countV4), std::to_string(countV6)});
+        }
+    }
+
+    std::cout << "\n==== DEPTH OF ROUTES ====\n" << std::endl;
+    depthTable.print(std::cout);
+
+    return true;
+}
+
 void deinitSoftware() {
     bool status;
     RgcConfig config;
@@ -1,4 +1,6 @@
 #include "handlers.hpp"
+#include "bgp_cache.hpp"
+#include "libnetwork_settings.hpp"
 #include "config.hpp"
 #include "cli_args.hpp"
 #include "log.hpp"
@@ -70,7 +72,17 @@ int main(const int argc, char** argv) {
         return 1;
     }
 
+    initBGPSettings();
+
     if (app.got_subcommand(gServiceSubCmd)) {
+        NetUtils::BGP::TrieCacheRefresher bgpRefresher;
+
+        // Builds use published version of tries, new one is swapped in when it is ready
+        if (gServiceSettings.bgp_refresh_sec && !gLibNetworkSettings.bgpDumpPaths.empty()) {
+            LOG_INFO("BGP dumps are refreshed in background every {} sec", gServiceSettings.bgp_refresh_sec);
+            bgpRefresher.start(gLibNetworkSettings.bgpDumpPaths, std::chrono::seconds(gServiceSettings.bgp_refresh_sec));
+        }
+
         fillServiceCallbacks(gServiceCallbacks);
         runService(gServiceSettings, gServiceCallbacks);
     }
@@ -103,6 +115,11 @@ int main(const int argc, char** argv) {
         exitCode = !status;
     }
 
+    // Show statistics of BGP tries
+    if (app.got_subcommand(gBGPStatsSubCmd)) {
+        exitCode = !showBGPStats();
+    }
+
     // Check access for URLs and close software
     if (app.got_subcommand(gCheckSubCmd)) {
         checkSourcesAvailability(gCmdArgs);
@@ -171,7 +171,7 @@ void groupSourcesByInetType(std::vector<DownloadedSourcePair>& sources,
     size_t domainSourcesCount = 0;
     size_t ipSourcesCount = 0;
 
-    for (const auto& [sourceId, filePath] : sources) {
+    for (const auto& [sourceId, filePath, linesCount] : sources) {
         const auto& sourceConfig = sourcesStorage.at(sourceId);
 
         if (sourceConfig.inetType == Source::InetType::DOMAIN) {
@@ -5,6 +5,7 @@
 #include <json/json.h>
 
 #include "build_tools.hpp"
+#include "fs_utils_lines.hpp"
 #include "fs_utils_temp.hpp"
 #include "log.hpp"
 #include "main_sources.hpp"
@@ -27,28 +28,25 @@ std::optional<std::vector<fs::path>> generateSingBoxRuleSets(
         // ===================
         // FILL ARRAYS WITH SUBNETS AND DOMAINS
         // ===================
-        for (const auto& [sourceId, filePath] : sources) {
+        for (const auto& [sourceId, filePath, linesCount] : sources) {
             const auto& source = storage.at(sourceId);
             auto& data = groupedData[source.section];
 
-            std::ifstream file(filePath);
-            if (!file.is_open()) continue;
+            std::error_code ec;
+            if (!fs::exists(filePath, ec)) continue;
 
-            std::string line;
-            while (std::getline(file, line)) {
-                line.erase(0, line.find_first_not_of(" \t\r\n"));
-                line.erase(line.find_last_not_of(" \t\r\n") + 1);
-
-                if (line.empty() || line[0] == '#') continue;
+            FS::Utils::LineSource file(filePath, {true, true, "#"});
 
+            std::string_view line;
+            while (file.next(line)) {
                 if (source.inetType == Source::InetType::DOMAIN) {
-                    data.fullDomains.insert(line);
+                    data.fullDomains.emplace(line);
 
                     if (std::count(line.begin(), line.end(), '.') == 1) {
-                        data.suffixDomains.insert("." + line);
+                        data.suffixDomains.insert("." + std::string(line));
                     }
                 } else { // IP CIDR
-                    data.uniqueIps.insert(line);
+                    data.uniqueIps.emplace(line);
                 }
             }
         }
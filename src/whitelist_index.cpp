@@ -0,0 +1,204 @@
+#include "whitelist_index.hpp"
+
+#include <array>
+#include <fstream>
+
+#include "filter.hpp"
+#include "bgp_parse.hpp"
+#include "bgp_snapshot.hpp"
+#include "range_index.hpp"
+#include "libnetwork_settings.hpp"
+#include "log.hpp"
+
+namespace {
+    // Index which is used by current process
+    struct LoadedIndex {
+        uint64_t key = 0;
+        uint64_t createdAt = 0;
+        std::shared_ptr<const WhitelistIndex> index;
+    };
+
+    std::mutex gLoadedIndexMutex;
+
+    // Guarded by gLoadedIndexMutex
+    LoadedIndex gLoadedIndex;
+
+    const fs::path gkWhitelistCacheDir = fs::path(std::getenv("HOME")) / ".cache" / "rglc" / "whitelist";
+
+    uint64_t hashFNV1a(const char* data, const size_t size, uint64_t hash) {
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= static_cast<uint8_t>(data[i]);
+            hash *= 0x100000001b3ull;
+        }
+
+        return hash;
+    }
+
+    template <typename T>
+    uint64_t hashValue(const T& value, const uint64_t hash) {
+        return hashFNV1a(reinterpret_cast<const char*>(&value), sizeof(value), hash);
+    }
+
+    uint64_t hashFingerprint(const NetUtils::BGP::DumpFingerprint& fingerprint, uint64_t hash) {
+        hash = hashValue(fingerprint.size, hash);
+        hash = hashValue(fingerprint.mtime, hash);
+
+        return hashValue(fingerprint.sampleHash, hash);
+    }
+}
+
+// ──────────────────────────────────────────────────────────────
+// DomainVerdictCache
+// ──────────────────────────────────────────────────────────────
+std::optional<bool> DomainVerdictCache::find(const std::string_view domain) const {
+    std::lock_guard<std::mutex> lock(m_mtx);
+
+    const auto it = m_verdicts.find(domain);
+
+    if (it == m_verdicts.end()) {
+        return std::nullopt;
+    }
+
+    // Nodes are relinked, so keys of map stay valid
+    m_order.splice(m_order.begin(), m_order, it->second);
+
+    return it->second->second;
+}
+
+void DomainVerdictCache::insert(const std::string& domain, const bool isFound) {
+    std::lock_guard<std::mutex> lock(m_mtx);
+
+    if (const auto it = m_verdicts.find(domain); it != m_verdicts.end()) {
+        it->second->second = isFound;
+        m_order.splice(m_order.begin(), m_order, it->second);
+        return;
+    }
+
+    m_order.emplace_front(domain, isFound);
+    m_verdicts.emplace(m_order.front().first, m_order.begin());
+
+    if (m_verdicts.size() > m_maxCount) {
+        m_verdicts.erase(m_order.back().first);
+        m_order.pop_back();
+    }
+}
+
+size_t DomainVerdictCache::size() const {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_verdicts.size();
+}
+
+// ──────────────────────────────────────────────────────────────
+// Binary cache
+// ──────────────────────────────────────────────────────────────
+
+// Mask-less IPs of whitelist are fixed by BGP dump, so its settings and files are a part of key too
+static uint64_t getWhitelistKey(const fs::path& whitelistPath) {
+    std::ifstream file(whitelistPath, std::ios::binary);
+    std::array<char, 64 * 1024> buffer{};
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    if (!file.is_open()) {
+        throw std::ios_base::failure(FILE_OPEN_ERROR_MSG + whitelistPath.string());
+    }
+
+    while (file.read(buffer.data(), buffer.size()) || file.gcount() > 0) {
+        hash = hashFNV1a(buffer.data(), static_cast<size_t>(file.gcount()), hash);
+    }
+
+    hash = hashValue(gLibNetworkSettings.isSearchSubnetByBGP, hash);
+    hash = hashValue(gLibNetworkSettings.autoFixMaskLimitByBGP.v4, hash);
+    hash = hashValue(gLibNetworkSettings.autoFixMaskLimitByBGP.v6, hash);
+
+    if (gLibNetworkSettings.isSearchSubnetByBGP) {
+        // Same fingerprints as ones which decide whether BGP cache is rebuilt
+        const auto dumpPaths = NetUtils::BGP::expandDumpPaths(gLibNetworkSettings.bgpDumpPaths);
+        const auto updatePaths = NetUtils::BGP::expandDumpPaths(gLibNetworkSettings.bgpUpdatePaths);
+
+        hash = hashFingerprint(NetUtils::BGP::getDumpFingerprint(dumpPaths), hash);
+        hash = hashFingerprint(NetUtils::BGP::getDumpFingerprint(updatePaths), hash);
+    }
+
+    return hash;
+}
+
+static fs::path getIndexCachePath(const uint64_t key) {
+    return gkWhitelistCacheDir / fmt::format("{:016x}.index", key);
+}
+
+static bool isIndexExpired(const uint64_t createdAt) {
+    return createdAt + WHITELIST_INDEX_TTL_SEC <= getCurrentUnixTimestamp();
+}
+
+// Index of previous whitelist or BGP dump is never read again
+static void pruneIndexCache(const fs::path& keepPath) {
+    std::error_code ec;
+
+    for (const auto& entry : fs::directory_iterator(keepPath.parent_path(), ec)) {
+        if (entry.path() != keepPath && entry.path().extension() == ".index") {
+            fs::remove(entry.path(), ec);
+        }
+    }
+}
+
+static std::shared_ptr<const WhitelistIndex> buildWhitelistIndex(const fs::path& whitelistPath) {
+    NetTypes::ListIPv4 ipv4;
+    NetTypes::ListIPv6 ipv6;
+
+    NetTypes::ListIPvxPair listsPair = {
+        ipv4,
+        ipv6
+    };
+
+    NetTypes::ListAddress domains;
+
+    parseAddressFile(whitelistPath, listsPair, &domains);
+
+    auto index = std::make_shared<WhitelistIndex>();
+    index->ranges = {NetTypes::IPv4RangeSet(ipv4), NetTypes::IPv6RangeSet(ipv6)};
+    index->domains = NetTypes::DomainSuffixSet(domains);
+
+    return index;
+}
+
+std::shared_ptr<const WhitelistIndex> loadWhitelistIndex(const fs::path& whitelistPath) {
+    std::lock_guard<std::mutex> lock(gLoadedIndexMutex);
+
+    const uint64_t key = getWhitelistKey(whitelistPath);
+
+    if (gLoadedIndex.index && gLoadedIndex.key == key && !isIndexExpired(gLoadedIndex.createdAt)) {
+        return gLoadedIndex.index;
+    }
+
+    const fs::path cachePath = getIndexCachePath(key);
+    uint64_t createdAt = 0;
+
+    try {
+        auto index = std::make_shared<WhitelistIndex>();
+
+        if (NetUtils::RangeIndex::read(cachePath, key, index->ranges, index->domains, createdAt) &&
+            !isIndexExpired(createdAt)) {
+            LOG_INFO("Whitelist index is loaded from cache {}", cachePath.string());
+            gLoadedIndex = {key, createdAt, index};
+
+            return index;
+        }
+    } catch (const std::exception& e) {
+        LOG_WARNING("Failed to read whitelist index cache: {}", e.what());
+    }
+
+    createdAt = getCurrentUnixTimestamp();
+    auto index = buildWhitelistIndex(whitelistPath);
+
+    try {
+        NetUtils::RangeIndex::write(cachePath, index->ranges, index->domains, key, createdAt);
+        pruneIndexCache(cachePath);
+    } catch (const std::exception& e) {
+        // Cache only speeds up next runs, so index is used anyway
+        LOG_WARNING("Failed to save whitelist index cache: {}", e.what());
+    }
+
+    gLoadedIndex = {key, createdAt, index};
+
+    return index;
+}
@@ -0,0 +1,175 @@
+#include <catch2/catch_all.hpp>
+
+#include <fstream>
+#include <sstream>
+
+#include "bgp_cache.hpp"
+#include "filter.hpp"
+#include "libnetwork_settings.hpp"
+#include "mrt_reader.hpp"
+
+static std::string readWholeFile(const fs::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream content;
+
+    content << file.rdbuf();
+
+    return content.str();
+}
+
+TEST_CASE("checkFileByIPvLists: pipelined and sequential checks give the same output", "[filter]") {
+    const fs::path dir = fs::temp_directory_path() / "rglc_test_filter";
+    fs::create_directories(dir);
+
+    const bool origSearchByBGP = gLibNetworkSettings.isSearchSubnetByBGP;
+    gLibNetworkSettings.isSearchSubnetByBGP = false;
+
+    // 10.0.0.5, 192.168.0.0/16 and subdomains of example.ru are whitelisted
+    WhitelistIndex whitelist;
+    whitelist.ranges.v4 = NetTypes::IPv4RangeSet(NetTypes::ListIPv4{{0x0A000005u, 32}, {0xC0A80000u, 16}});
+    whitelist.domains = NetTypes::DomainSuffixSet(NetTypes::ListAddress{"example.ru"});
+
+    // Several chunks with entries which are kept, replaced and dropped (domains are matched without DNS)
+    std::string content;
+
+    for (int i = 0; i < 20000; ++i) {
+        content += "10." + std::to_string(i % 256) + "." + std::to_string(i / 256) + ".0/24\n";
+
+        if (i % 3000 == 0) {
+            content += "???\nsub.example.ru\n10.0.0.0/16\n192.168.1.1\n2001:db8::/32\n";
+        }
+    }
+
+    std::ofstream(dir / "sequential.txt", std::ios::binary) << content;
+    std::ofstream(dir / "pipelined.txt", std::ios::binary) << content;
+
+    NetUtils::CAresResolver resolver;
+    REQUIRE(resolver.isInitialized());
+
+    REQUIRE(checkFileByIPvLists(dir / "sequential.txt", whitelist, resolver, true, false));
+    REQUIRE(checkFileByIPvLists(dir / "pipelined.txt", whitelist, resolver, true, true));
+
+    const std::string sequential = readWholeFile(dir / "sequential.txt");
+    const std::string pipelined = readWholeFile(dir / "pipelined.txt");
+
+    REQUIRE(sequential == pipelined);
+
+    // Whitelisted and unknown entries are dropped, 10.0.0.0/16 is written without 10.0.0.5
+    REQUIRE(sequential.find("192.168.1.1\n") == std::string::npos);
+    REQUIRE(sequential.find("sub.example.ru\n") == std::string::npos);
+    REQUIRE(sequential.find("???\n") == std::string::npos);
+    REQUIRE(sequential.find("10.0.0.0/16\n") == std::string::npos);
+    REQUIRE(sequential.find("10.0.0.4/32\n10.0.0.6/31\n") != std::string::npos);
+    REQUIRE(sequential.find("2001:db8::/32\n") != std::string::npos);
+
+    // Temporary output is not left
+    REQUIRE(std::distance(fs::directory_iterator(dir), fs::directory_iterator()) == 2);
+
+    gLibNetworkSettings.isSearchSubnetByBGP = origSearchByBGP;
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("checkFileByIPvLists: mask-less IP is not replaced by its BGP prefix", "[filter][bgp]") {
+    const bool isPipelined = GENERATE(true, false);
+
+    const fs::path dir = fs::temp_directory_path() / "rglc_test_filter_bgp";
+    const fs::path dumpPath = dir / "rrc00.mrt";
+    fs::create_directories(dir);
+
+    using namespace std::string_literals;
+
+    // TABLE_DUMP_V2 RIB_IPV4_UNICAST record of 10.20.1.0/24
+    const std::string ribBody = "\x00\x00\x00\x01\x18\x0a\x14\x01\x00\x00"s;
+    std::string dump = "\x00\x00\x00\x00"s;
+
+    dump += static_cast<char>(NetUtils::MRT::kTypeTableDumpV2 >> 8);
+    dump += static_cast<char>(NetUtils::MRT::kTypeTableDumpV2 & 0xFF);
+    dump += static_cast<char>(NetUtils::MRT::kRibIPv4Unicast >> 8);
+    dump += static_cast<char>(NetUtils::MRT::kRibIPv4Unicast & 0xFF);
+    dump += "\x00\x00\x00"s + static_cast<char>(ribBody.size()) + ribBody;
+
+    std::ofstream(dumpPath, std::ios::binary) << dump;
+
+    NetUtils::BGP::parseDumpsToCache({dumpPath.string()});
+    REQUIRE(NetUtils::BGP::getTrieFromCache()->lookup(0x0A140101u)->prefix == 24);
+
+    const bool origSearchByBGP = gLibNetworkSettings.isSearchSubnetByBGP;
+    gLibNetworkSettings.isSearchSubnetByBGP = true;
+
+    // BGP prefix of both hosts partly overlaps whitelist, only the second host is whitelisted itself
+    WhitelistIndex whitelist;
+    whitelist.ranges.v4 = NetTypes::IPv4RangeSet(NetTypes::ListIPv4{{0x0A140180u, 25}});
+
+    const fs::path path = dir / "list.txt";
+    std::ofstream(path, std::ios::binary) << "10.20.1.1\n10.20.1.200\n";
+
+    NetUtils::CAresResolver resolver;
+    REQUIRE(resolver.isInitialized());
+
+    REQUIRE(checkFileByIPvLists(path, whitelist, resolver, true, isPipelined));
+    REQUIRE(readWholeFile(path) == "10.20.1.1\n");
+
+    gLibNetworkSettings.isSearchSubnetByBGP = origSearchByBGP;
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("DomainVerdictCache: least recently used verdicts are evicted", "[filter]") {
+    DomainVerdictCache cache(2);
+
+    cache.insert("a.ru", true);
+    cache.insert("b.ru", false);
+
+    // "a.ru" is used, so "b.ru" is evicted by the next domain
+    REQUIRE(cache.find("a.ru") == std::optional<bool>(true));
+
+    cache.insert("c.ru", true);
+
+    REQUIRE(cache.size() == 2);
+    REQUIRE_FALSE(cache.find("b.ru").has_value());
+    REQUIRE(cache.find("a.ru") == std::optional<bool>(true));
+    REQUIRE(cache.find("c.ru") == std::optional<bool>(true));
+
+    // Verdict of cached domain is replaced without growth
+    cache.insert("c.ru", false);
+
+    REQUIRE(cache.size() == 2);
+    REQUIRE(cache.find("c.ru") == std::optional<bool>(false));
+}
+
+TEST_CASE("aggregateAddressFile: overlapping and adjacent subnets are merged", "[filter]") {
+    const fs::path dir = fs::temp_directory_path() / "rglc_test_aggregate";
+    fs::create_directories(dir);
+
+    const fs::path path = dir / "list.txt";
+
+    std::ofstream(path, std::ios::binary)
+        << "10.0.1.0/24\n"
+        << "10.0.0.0/24\n"          // Adjacent to 10.0.1.0/24
+        << "10.0.0.128/25\n"        // Covered by 10.0.0.0/24
+        << "192.168.0.1\n"          // Mask-less IP is a single host
+        << "example.ru\n"
+        << "2001:0db8:0000:0000:0000:0000:0000:0000/33\n"
+        << "2001:db8:8000::/33\n"   // Adjacent to the previous one
+        << "2001:db8::1\n"          // Covered by 2001:db8::/33
+        << "fe80::1\n";
+
+    size_t linesCount = 0;
+
+    REQUIRE(aggregateAddressFile(path, &linesCount) == 4);
+    REQUIRE(linesCount == 5);
+
+    // Lines which are not subnets go first, then IPv4 and IPv6 in canonical compressed form
+    REQUIRE(readWholeFile(path) ==
+        "example.ru\n"
+        "10.0.0.0/23\n"
+        "192.168.0.1/32\n"
+        "2001:db8::/32\n"
+        "fe80::1/128\n");
+
+    // Temporary output is not left
+    REQUIRE(std::distance(fs::directory_iterator(dir), fs::directory_iterator()) == 1);
+
+    fs::remove_all(dir);
+}
@@ -1,8 +1,11 @@
 #include "catch2/catch_all.hpp"
+#include <algorithm>
 #include <vector>
 #include <forward_list>
+#include <thread>
 
 #include "common.hpp"
+#include "bounded_queue.hpp"
 
 template<typename T>
 std::vector<T> to_vec(const std::forward_list<T>& fl) {
@@ -62,4 +65,29 @@ TEST_CASE("removeListItemsForInxs works correctly", "[common][idx]")
         removeListItemsForInxs(list, {0, 1, 99});
         REQUIRE(list.empty());
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("BoundedQueue keeps order between threads and stops after close", "[common][queue]")
+{
+    BoundedQueue<int> queue(2);
+    std::vector<int> popped;
+
+    std::thread producer([&queue] {
+        for (int i = 0; i < 100; ++i) {
+            queue.push(i);
+        }
+
+        queue.close();
+    });
+
+    while (auto item = queue.pop()) {
+        popped.push_back(*item);
+    }
+
+    producer.join();
+
+    REQUIRE(popped.size() == 100);
+    REQUIRE(std::is_sorted(popped.begin(), popped.end()));
+    REQUIRE_FALSE(queue.push(100));
+    REQUIRE_FALSE(queue.pop().has_value());
+}
@@ -1,8 +1,13 @@
 #include "catch2/catch_all.hpp"
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <thread>
+
+#include <sys/stat.h>
 
 #include "fs_utils.hpp"
+#include "fs_utils_lines.hpp"
 #include "fs_utils_temp.hpp"
 #include "log.hpp"
 
@@ -53,6 +58,96 @@ TEST_CASE("countLinesInFile", "[fs]")
     }
 }
 
+TEST_CASE("LineSource", "[fs]")
+{
+    FS::Utils::Temp::SessionTempFileRegistry tfr("LineSource_TEST");
+
+    const auto readAll = [](FS::Utils::LineSource& source) {
+        std::vector<std::string> lines;
+        std::string_view line;
+
+        while (source.next(line)) {
+            lines.emplace_back(line);
+        }
+
+        return lines;
+    };
+
+    SECTION("raw lines, last one without line break")
+    {
+        auto filePath = tfr.createTempFile("txt").lock()->path;
+        std::ofstream(filePath) << "a\n\n  b \r\nc";
+
+        FS::Utils::LineSource source(filePath);
+        REQUIRE(readAll(source) == std::vector<std::string>{"a", "", "  b \r", "c"});
+    }
+
+    SECTION("trim, empty lines and comments")
+    {
+        auto filePath = tfr.createTempFile("txt").lock()->path;
+        std::ofstream(filePath) << "# comment\n  a.com \r\n\n \t\n  ! note\nb.com\n";
+
+        FS::Utils::LineSource source(filePath, {true, true, "#!"});
+        REQUIRE(readAll(source) == std::vector<std::string>{"a.com", "b.com"});
+    }
+
+    SECTION("empty file")
+    {
+        auto filePath = tfr.createTempFile("txt").lock()->path;
+        createTempFile(filePath, {});
+
+        FS::Utils::LineSource source(filePath);
+        REQUIRE(readAll(source).empty());
+        REQUIRE(source.content().empty());
+    }
+
+    SECTION("pipe is read without mapping")
+    {
+        const auto fifoPath = tfr.getTempDir() / "LineSource_TEST.fifo";
+        REQUIRE(::mkfifo(fifoPath.c_str(), 0600) == 0);
+
+        std::thread writer([&]() {
+            std::ofstream(fifoPath) << "x\ny\n";
+        });
+
+        FS::Utils::LineSource source(fifoPath);
+        writer.join();
+        fs::remove(fifoPath);
+
+        REQUIRE(source.content() == "x\ny\n");
+        REQUIRE(readAll(source) == std::vector<std::string>{"x", "y"});
+    }
+
+    SECTION("file does not exist -> throws")
+    {
+        REQUIRE_THROWS_AS(FS::Utils::LineSource("/this/does/not/exist.txt"), std::ios_base::failure);
+    }
+}
+
+TEST_CASE("countLines", "[fs]")
+{
+    REQUIRE(FS::Utils::countLines("") == 0);
+    REQUIRE(FS::Utils::countLines("\n") == 1);
+    REQUIRE(FS::Utils::countLines("a") == 1);
+    REQUIRE(FS::Utils::countLines("a\nb\n") == 2);
+    REQUIRE(FS::Utils::countLines("a\n\nb") == 3);
+
+    SECTION("long content is counted by blocks")
+    {
+        // Longer than 255 blocks of 32 bytes, so counters of vectorized version are summed several times
+        const size_t size = GENERATE(31u, 32u, 8160u, 8191u, 100000u);
+        std::string content;
+
+        for (size_t i = 0; i < size; ++i) {
+            content.push_back(i % 3 == 0 || i % 7 == 0 ? '\n' : 'x');
+        }
+
+        const auto newlines = static_cast<size_t>(std::count(content.begin(), content.end(), '\n'));
+
+        REQUIRE(FS::Utils::countLines(content) == newlines + (content.back() == '\n' ? 0 : 1));
+    }
+}
+
 TEST_CASE("removeDuplicateLines", "[fs]")
 {
     SECTION("removes duplicates from larger file (A > B)")
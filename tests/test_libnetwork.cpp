@@ -1,26 +1,21 @@
 #include <catch2/catch_all.hpp>
 
+#include <fstream>
+
 #include "fs_utils.hpp"
 #include "net_convert.hpp"
 #include "net_types_base.hpp"
 #include "url_handle.hpp"
 #include "libnetwork_settings.hpp"
-
-static bool allLeadingBitsSet(const NetTypes::bitsetIPv4& b, int n) {
-    for (int i = 0; i < n; i++)
-        if (!b[IPV4_BITS_COUNT - 1 - i]) return false;
-    for (int i = n; i < IPV4_BITS_COUNT; i++)
-        if (b[IPV4_BITS_COUNT - 1 - i]) return false;
-    return true;
-}
-
-static bool allLeadingBitsSetV6(const NetTypes::bitsetIPv6& b, int n) {
-    for (int i = 0; i < n; i++)
-        if (!b[IPV6_BITS_COUNT - 1 - i]) return false;
-    for (int i = n; i < IPV4_BITS_COUNT; i++)
-        if (b[IPV6_BITS_COUNT - 1 - i]) return false;
-    return true;
-}
+#include "bgp_trie.hpp"
+#include "bgp_cache.hpp"
+#include "bgp_parse.hpp"
+#include "bgp_snapshot.hpp"
+#include "mrt_reader.hpp"
+#include "ip_range_set.hpp"
+#include "range_index.hpp"
+#include "domain_suffix_set.hpp"
+#include "ipv4_bulk_parse.hpp"
 
 struct FastTimeout {
     FastTimeout() {
@@ -64,8 +59,8 @@ TEST_CASE("parseIPv4: valid address without prefix", "[ipv4]") {
     const bool ok = NetUtils::Convert::parseIPv4("192.168.10.5", sub);
 
     REQUIRE(ok == true);
-    REQUIRE(sub.ip.to_ulong() == 0xC0A80A05UL);
-    REQUIRE(sub.mask.count() == 32);
+    REQUIRE(sub.ip == 0xC0A80A05u);
+    REQUIRE(sub.prefix == 32);
 }
 
 TEST_CASE("parseIPv4: valid address with CIDR prefix", "[ipv4]") {
@@ -75,8 +70,8 @@ TEST_CASE("parseIPv4: valid address with CIDR prefix", "[ipv4]") {
     const bool ok = NetUtils::Convert::parseIPv4("10.0.0.0/8", sub);
 
     REQUIRE(ok == true);
-    REQUIRE(sub.ip.to_ulong() == 0x0A000000UL);
-    REQUIRE(sub.mask.count() == 8);
+    REQUIRE(sub.ip == 0x0A000000u);
+    REQUIRE(sub.prefix == 8);
 }
 
 TEST_CASE("parseIPv4: invalid format returns false", "[ipv4]") {
@@ -104,7 +99,7 @@ TEST_CASE("parseIPv6: address without prefix", "[ipv6]") {
     const bool ok = NetUtils::Convert::parseIPv6("2001:db8::1", sub);
 
     REQUIRE(ok == true);
-    REQUIRE(sub.mask.count() == 128);     // full mask when no /prefix and BGP off
+    REQUIRE(sub.prefix == 128);     // full mask when no /prefix and BGP off
 }
 
 TEST_CASE("parseIPv6: address with /48 prefix", "[ipv6]") {
@@ -114,7 +109,62 @@ TEST_CASE("parseIPv6: address with /48 prefix", "[ipv6]") {
     const bool ok = NetUtils::Convert::parseIPv6("2001:db8:abcd::/48", sub);
 
     REQUIRE(ok == true);
-    REQUIRE(sub.mask.count() == 48);
+    REQUIRE(sub.prefix == 48);
+}
+
+TEST_CASE("parseIPv6: embedded IPv4 and zone", "[ipv6]") {
+    DisableParseBGP dp;
+
+    NetTypes::IPv6Subnet sub;
+
+    REQUIRE(NetUtils::Convert::parseIPv6("::ffff:1.2.3.4/120", sub) == true);
+    REQUIRE(sub.ip == NetTypes::addrIPv6(0xFFFF01020304ull));
+    REQUIRE(sub.prefix == 120);
+
+    REQUIRE(NetUtils::Convert::parseIPv6("fe80::1%eth0", sub) == true);
+    REQUIRE(sub.ip == ((NetTypes::addrIPv6(0xFE80u) << 112) | 1u));
+    REQUIRE(sub.prefix == 128);
+}
+
+TEST_CASE("parseIPv4/parseIPv6: malformed input is rejected without exceptions", "[ipv4][ipv6]") {
+    DisableParseBGP dp;
+
+    NetTypes::IPv4Subnet sub4;
+    NetTypes::IPv6Subnet sub6;
+
+    REQUIRE(NetUtils::Convert::parseIPv4("1.2.3.4/", sub4) == false);
+    REQUIRE(NetUtils::Convert::parseIPv4("1.2.3.4/abc", sub4) == false);
+    REQUIRE(NetUtils::Convert::parseIPv4("1.2.3.4/33", sub4) == false);
+    REQUIRE(NetUtils::Convert::parseIPv4("a.b.c.d", sub4) == false);
+    REQUIRE(NetUtils::Convert::parseIPv4("1.2.3.4 ", sub4) == false);
+
+    REQUIRE(NetUtils::Convert::parseIPv6("2001:db8::/", sub6) == false);
+    REQUIRE(NetUtils::Convert::parseIPv6("2001:db8::/129", sub6) == false);
+    REQUIRE(NetUtils::Convert::parseIPv6("2001:db8:::1", sub6) == false);
+    REQUIRE(NetUtils::Convert::parseIPv6("12345::", sub6) == false);
+    REQUIRE(NetUtils::Convert::parseIPv6("fe80::1%", sub6) == false);
+}
+
+TEST_CASE("fromCharsIPv4/fromCharsIPv6: position and error of parsing", "[ipv4][ipv6]") {
+    const std::string_view line = "10.20.30.40/24";
+    NetTypes::addrIPv4 ipv4 = 0;
+    NetTypes::addrIPv6 ipv6 = 0;
+
+    const auto result4 = NetUtils::Convert::fromCharsIPv4(line.data(), line.data() + line.size(), ipv4);
+
+    REQUIRE(result4.ec == std::errc());
+    REQUIRE(result4.ptr == line.data() + 11);
+    REQUIRE(ipv4 == 0x0A141E28u);
+
+    const std::string_view big = "1.2.300.4";
+    REQUIRE(NetUtils::Convert::fromCharsIPv4(big.data(), big.data() + big.size(), ipv4).ec == std::errc::result_out_of_range);
+
+    const std::string_view full = "1:2:3:4:5:6:7:8";
+    const auto result6 = NetUtils::Convert::fromCharsIPv6(full.data(), full.data() + full.size(), ipv6);
+
+    REQUIRE(result6.ec == std::errc());
+    REQUIRE(result6.ptr == full.data() + full.size());
+    REQUIRE(ipv6 == ((NetTypes::addrIPv6(0x0001000200030004ull) << 64) | 0x0005000600070008ull));
 }
 
 // ======================================================================
@@ -293,48 +343,280 @@ TEST_CASE("getAddressType: edge cases and mixed", "[edge]") {
     REQUIRE(NetUtils::getAddressType("http://example.com") == NetTypes::AddressType::UNKNOWN);
 }
 
-TEST_CASE("lengthv4ToBitset produces correct mask", "[ipv4]") {
-    SECTION("len = 0") {
-        auto const b = NetUtils::Convert::lengthv4ToBitset(0);
-        REQUIRE(b.to_ulong() == 0);
-    }
+TEST_CASE("classifyAddress: value is parsed together with type", "[ipv4][ipv6][edge]") {
+    SECTION("IPv4 with and without prefix") {
+        const auto subnet = NetUtils::classifyAddress("10.1.2.3/8");
+        const auto host = NetUtils::classifyAddress("10.1.2.3");
+
+        REQUIRE(subnet.type == NetTypes::AddressType::IPV4);
+        REQUIRE(subnet.hasPrefix);
+        REQUIRE(std::get<NetTypes::IPv4Subnet>(subnet.subnet).ip == 0x0A010203u);
+        REQUIRE(std::get<NetTypes::IPv4Subnet>(subnet.subnet).prefix == 8);
 
-    SECTION("len = 1") {
-        auto const b = NetUtils::Convert::lengthv4ToBitset(1);
-        REQUIRE(allLeadingBitsSet(b, 1));
+        REQUIRE(host.type == NetTypes::AddressType::IPV4);
+        REQUIRE_FALSE(host.hasPrefix);
     }
 
-    SECTION("len = 16") {
-        auto const b = NetUtils::Convert::lengthv4ToBitset(16);
-        REQUIRE(allLeadingBitsSet(b, 16));
+    SECTION("IPv6 subnets and embedded IPv4") {
+        const auto subnet = NetUtils::classifyAddress("2001:db8::/32");
+        const auto mapped = NetUtils::classifyAddress("::ffff:1.2.3.4");
+
+        REQUIRE(subnet.type == NetTypes::AddressType::IPV6);
+        REQUIRE(std::get<NetTypes::IPv6Subnet>(subnet.subnet).ip == NetTypes::addrIPv6(0x20010db8u) << 96);
+        REQUIRE(std::get<NetTypes::IPv6Subnet>(subnet.subnet).prefix == 32);
+
+        REQUIRE(mapped.type == NetTypes::AddressType::IPV6);
+        REQUIRE(std::get<NetTypes::IPv6Subnet>(mapped.subnet).ip == NetTypes::addrIPv6(0xFFFF01020304ull));
     }
 
-    SECTION("len = 32") {
-        auto const b = NetUtils::Convert::lengthv4ToBitset(32);
-        REQUIRE(b.to_ulong() == 0xFFFFFFFFu);
+    SECTION("invalid prefixes and groups") {
+        REQUIRE(NetUtils::getAddressType("2001:db8::/129") == NetTypes::AddressType::UNKNOWN);
+        REQUIRE(NetUtils::getAddressType("fe80::1%eth0/64") == NetTypes::AddressType::UNKNOWN);
+        REQUIRE(NetUtils::getAddressType("1:2:3:4:5:6:7:8::") == NetTypes::AddressType::UNKNOWN);
+        REQUIRE(NetUtils::getAddressType("12345::1") == NetTypes::AddressType::UNKNOWN);
+        REQUIRE(NetUtils::getAddressType("1:2") == NetTypes::AddressType::UNKNOWN);
     }
 }
 
-TEST_CASE("lengthv6ToBitset produces correct mask", "[ipv6]") {
-    SECTION("len = 0") {
-        auto const b = NetUtils::Convert::lengthv6ToBitset(0);
-        REQUIRE(b.none());
+TEST_CASE("lengthv4ToMask produces correct mask", "[ipv4]") {
+    REQUIRE(NetUtils::Convert::lengthv4ToMask(0) == 0u);
+    REQUIRE(NetUtils::Convert::lengthv4ToMask(1) == 0x80000000u);
+    REQUIRE(NetUtils::Convert::lengthv4ToMask(16) == 0xFFFF0000u);
+    REQUIRE(NetUtils::Convert::lengthv4ToMask(32) == 0xFFFFFFFFu);
+}
+
+TEST_CASE("lengthv6ToMask produces correct mask", "[ipv6]") {
+    const NetTypes::addrIPv6 kAllOnes = ~NetTypes::addrIPv6(0);
+
+    REQUIRE(NetUtils::Convert::lengthv6ToMask(0) == 0u);
+    REQUIRE(NetUtils::Convert::lengthv6ToMask(1) == NetTypes::addrIPv6(1) << 127);
+    REQUIRE(NetUtils::Convert::lengthv6ToMask(64) == kAllOnes << 64);
+    REQUIRE(NetUtils::Convert::lengthv6ToMask(128) == kAllOnes);
+}
+
+TEST_CASE("parseIPv4Bulk: SIMD and scalar parsers give same lines", "[ipv4]") {
+    const auto origType = gLibNetworkSettings.ipv4BulkParseType;
+    const std::string_view buffer =
+        "1.2.3.4\n"
+        "10.0.0.0/8\r\n"
+        "\n"
+        "255.255.255.255/32\n"
+        "192.168.01.1\n"
+        "1.2.3.256\n"
+        "1.2.3.4/33\n"
+        "1.2.3.4/0\n"
+        "example.com\n"
+        "2001:db8::/32\n"
+        "100.64.0.1";
+
+    const auto type = GENERATE(IPv4BulkParseType::AUTO, IPv4BulkParseType::SCALAR);
+    gLibNetworkSettings.ipv4BulkParseType = type;
+
+    std::vector<NetTypes::IPv4Subnet> subnets;
+    std::vector<std::string_view> otherLines;
+
+    NetUtils::Convert::parseIPv4Bulk(buffer, subnets, otherLines);
+    gLibNetworkSettings.ipv4BulkParseType = origType;
+
+    REQUIRE(subnets.size() == 5);
+    REQUIRE((subnets[0].ip == 0x01020304u && subnets[0].prefix == 0));     // Mask-less
+    REQUIRE((subnets[1].ip == 0x0A000000u && subnets[1].prefix == 8));
+    REQUIRE((subnets[2].ip == 0xFFFFFFFFu && subnets[2].prefix == 32));
+    REQUIRE((subnets[3].ip == 0x01020304u && subnets[3].prefix == 32));    // "/0" as in parseIPv4
+    REQUIRE((subnets[4].ip == 0x64400001u && subnets[4].prefix == 0));     // Line without break
+
+    REQUIRE(otherLines == std::vector<std::string_view>{
+        "192.168.01.1", "1.2.3.256", "1.2.3.4/33", "example.com", "2001:db8::/32"
+    });
+}
+
+TEST_CASE("IPRangeSet: subnets are merged to sorted ranges", "[ipv4][ipv6][range]") {
+    const NetTypes::ListIPv4 v4 = {
+        {0x0A000000u, 24},  // 10.0.0.0/24
+        {0x0A000100u, 24},  // 10.0.1.0/24, adjacent to previous one
+        {0x0A000080u, 25},  // 10.0.0.128/25, inside of first one
+        {0xC0A80001u, 32},  // 192.168.0.1
+        {0x00000000u, 0}    // corrupted, skipped
+    };
+
+    const NetTypes::IPv4RangeSet set(v4);
+
+    using Range = NetTypes::IPv4RangeSet::Range;
+    REQUIRE(set.getRanges() == std::vector<Range>{{0x0A000000u, 0x0A0001FFu}, {0xC0A80001u, 0xC0A80001u}});
+
+    REQUIRE(set.isIncludes({0x0A0001FFu, 32}));
+    REQUIRE(set.isIncludes({0x0A000000u, 23}));
+    REQUIRE_FALSE(set.isIncludes({0x0A000000u, 16}));
+    REQUIRE(set.isOverlaps({0x0A000000u, 16}));
+    REQUIRE(set.isOverlaps({0xC0A80000u, 24}));
+    REQUIRE_FALSE(set.isOverlaps({0xC0A80002u, 32}));
+    REQUIRE_FALSE(set.isOverlaps({0x0B000000u, 8}));
+    REQUIRE_FALSE(set.isOverlaps({0x0A000001u, 0}));
+
+    const NetTypes::addrIPv6 net = NetTypes::addrIPv6(0x20010db8u) << 96;
+    const NetTypes::IPv6RangeSet set6(NetTypes::ListIPv6{{net, 32}, {~NetTypes::addrIPv6(0), 128}});
+
+    REQUIRE(set6.getRanges().size() == 2);
+    REQUIRE(set6.isIncludes({net | 1, 128}));
+    REQUIRE(set6.isOverlaps({~NetTypes::addrIPv6(0), 64}));
+    REQUIRE_FALSE(set6.isOverlaps({net >> 1, 32}));
+    REQUIRE(NetTypes::IPv6RangeSet().isEmpty());
+}
+
+TEST_CASE("IPRangeSet: covered subnets are dropped and adjacent ones are merged", "[ipv4][ipv6][range]") {
+    const NetTypes::ListIPv4 v4 = {
+        {0x0A000000u, 25},  // 10.0.0.0/25
+        {0x0A000080u, 25},  // 10.0.0.128/25, sibling of previous one
+        {0x0A000100u, 24},  // 10.0.1.0/24, sibling of merged /24
+        {0x0A000105u, 32},  // 10.0.1.5, covered by previous one
+        {0x0A000200u, 32},  // 10.0.2.0
+        {0x0A000201u, 32}   // 10.0.2.1
+    };
+
+    const auto subnets = NetTypes::IPv4RangeSet(v4).toSubnets();
+
+    REQUIRE(subnets.size() == 2);
+    REQUIRE(subnets[0].to_string() == "10.0.0.0/23");
+    REQUIRE(subnets[1].to_string() == "10.0.2.0/31");
+
+    // Range which is not aligned to a single subnet: 10.0.0.1 - 10.0.0.6
+    const NetTypes::ListIPv4 unaligned = {
+        {0x0A000001u, 32}, {0x0A000002u, 31}, {0x0A000004u, 31}, {0x0A000006u, 32}
+    };
+
+    std::vector<std::string> strs;
+    for (const auto& subnet : NetTypes::IPv4RangeSet(unaligned).toSubnets()) {
+        strs.push_back(subnet.to_string());
     }
 
-    SECTION("len = 1") {
-        auto const b = NetUtils::Convert::lengthv6ToBitset(1);
-        REQUIRE(allLeadingBitsSetV6(b, 1));
+    REQUIRE(strs == std::vector<std::string>{"10.0.0.1/32", "10.0.0.2/31", "10.0.0.4/31", "10.0.0.6/32"});
+
+    // Upper half of IPv6 space ends at the last address
+    const NetTypes::addrIPv6 top = NetTypes::addrIPv6(1) << 127;
+    const NetTypes::ListIPv6 v6 = {{top, 2}, {top | (NetTypes::addrIPv6(1) << 126), 2}};
+    const auto subnets6 = NetTypes::IPv6RangeSet(v6).toSubnets();
+
+    REQUIRE(subnets6.size() == 1);
+    REQUIRE(subnets6[0].ip == top);
+    REQUIRE(subnets6[0].prefix == 1);
+    REQUIRE(subnets6[0].to_string() == "8000::/1");
+}
+
+TEST_CASE("IPRangeSet: subtraction keeps only addresses out of set", "[ipv4][ipv6][range]") {
+    const NetTypes::IPv4RangeSet set(NetTypes::ListIPv4{
+        {0x0A000005u, 32},  // 10.0.0.5
+        {0x0A008000u, 17},  // 10.0.128.0/17
+        {0x0B000000u, 8}    // 11.0.0.0/8
+    });
+
+    // 10.0.0.0/16 without 10.0.0.5 and its upper half
+    const auto parts = set.subtract({0x0A000000u, 16});
+    std::vector<std::string> strs;
+
+    for (const auto& subnet : parts) {
+        strs.push_back(subnet.to_string());
     }
 
-    SECTION("len = 64") {
-        auto const b = NetUtils::Convert::lengthv6ToBitset(64);
-        REQUIRE(allLeadingBitsSetV6(b, 64));
+    REQUIRE(strs == std::vector<std::string>{
+        "10.0.0.0/30", "10.0.0.4/32", "10.0.0.6/31", "10.0.0.8/29", "10.0.0.16/28", "10.0.0.32/27",
+        "10.0.0.64/26", "10.0.0.128/25", "10.0.1.0/24", "10.0.2.0/23", "10.0.4.0/22", "10.0.8.0/21",
+        "10.0.16.0/20", "10.0.32.0/19", "10.0.64.0/18"
+    });
+
+    REQUIRE(set.subtract({0x0B010000u, 16}).empty());
+    REQUIRE(set.subtract({0x0C000000u, 8}).size() == 1);
+    REQUIRE(set.subtract({0x0C000000u, 8})[0].to_string() == "12.0.0.0/8");
+
+    // Whitelisted last address of IPv6 space
+    const NetTypes::addrIPv6 kAllOnes = ~NetTypes::addrIPv6(0);
+    const NetTypes::IPv6RangeSet set6(NetTypes::ListIPv6{{kAllOnes, 128}});
+    const auto parts6 = set6.subtract({kAllOnes, 126});
+
+    REQUIRE(parts6.size() == 2);
+    REQUIRE(parts6[0].prefix == 127);
+    REQUIRE(parts6[1].ip == kAllOnes - 1);
+    REQUIRE(parts6[1].prefix == 128);
+}
+
+TEST_CASE("DomainSuffixSet: domains match with all subdomains", "[domain][suffix]") {
+    const NetTypes::DomainSuffixSet set(NetTypes::ListAddress{"example.ru", "*.Mail.COM", "host.org."});
+
+    REQUIRE(set.size() == 3);
+
+    REQUIRE(set.isMatches("example.ru"));
+    REQUIRE(set.isMatches("a.b.example.ru"));
+    REQUIRE(set.isMatches("WWW.Example.RU"));
+    REQUIRE(set.isMatches("mail.com"));
+    REQUIRE(set.isMatches("smtp.mail.com"));
+    REQUIRE(set.isMatches("host.org"));
+
+    REQUIRE_FALSE(set.isMatches("badexample.ru"));
+    REQUIRE_FALSE(set.isMatches("example.ru.net"));
+    REQUIRE_FALSE(set.isMatches("ru"));
+    REQUIRE_FALSE(set.isMatches(""));
+    REQUIRE_FALSE(NetTypes::DomainSuffixSet().isMatches("example.ru"));
+}
+
+TEST_CASE("RangeIndex: ranges and domains are restored from file", "[ipv4][ipv6][range][suffix]") {
+    const fs::path path = fs::temp_directory_path() / "rglc_test_range_index" / "list.index";
+
+    // Unsorted, overlapping and adjacent ranges are normalized as subnets are
+    const NetTypes::IPv4RangeSet fromRanges(std::vector<NetTypes::IPv4RangeSet::Range>{
+        {0x0A000100u, 0x0A0001FFu},     // 10.0.1.0/24
+        {0x0A000000u, 0x0A0000FFu},     // 10.0.0.0/24
+        {0x0A000080u, 0x0A000180u},     // Overlaps both
+        {0xC0A80000u, 0xC0A8FFFFu}      // 192.168.0.0/16
+    });
+
+    REQUIRE(fromRanges.getRanges() == std::vector<NetTypes::IPv4RangeSet::Range>{
+        {0x0A000000u, 0x0A0001FFu},
+        {0xC0A80000u, 0xC0A8FFFFu}
+    });
+
+    const NetTypes::IPRangeSetPair ranges = {
+        fromRanges,
+        NetTypes::IPv6RangeSet(NetTypes::ListIPv6{
+            {NetTypes::addrIPv6(0x20010db8u) << 96, 32},    // 2001:db8::/32
+            {NetTypes::addrIPv6(0x20010db9u) << 96, 32}     // 2001:db9::/32
+        })
+    };
+    const NetTypes::DomainSuffixSet domains(NetTypes::ListAddress{"example.ru", "*.mail.com"});
+
+    NetUtils::RangeIndex::write(path, ranges, domains, 42, 1000);
+
+    SECTION("Same key") {
+        NetTypes::IPRangeSetPair loadedRanges;
+        NetTypes::DomainSuffixSet loadedDomains;
+        uint64_t createdAt = 0;
+
+        REQUIRE(NetUtils::RangeIndex::read(path, 42, loadedRanges, loadedDomains, createdAt));
+        REQUIRE(createdAt == 1000);
+
+        REQUIRE(loadedRanges.v4.getRanges() == ranges.v4.getRanges());
+        REQUIRE(loadedRanges.v6.getRanges() == ranges.v6.getRanges());
+        REQUIRE(loadedRanges.v6.getRanges().size() == 1);
+        REQUIRE(loadedRanges.v4.isIncludes({0x0A000107u, 32}));
+        REQUIRE_FALSE(loadedRanges.v4.isOverlaps({0x0A000200u, 24}));
+
+        REQUIRE(loadedDomains.getDomains() == domains.getDomains());
+        REQUIRE(loadedDomains.isMatches("smtp.mail.com"));
     }
 
-    SECTION("len = 128") {
-        auto const b = NetUtils::Convert::lengthv6ToBitset(128);
-        REQUIRE(b.all());
+    SECTION("Another key or broken file") {
+        NetTypes::IPRangeSetPair loadedRanges;
+        NetTypes::DomainSuffixSet loadedDomains;
+        uint64_t createdAt = 0;
+
+        REQUIRE_FALSE(NetUtils::RangeIndex::read(path, 43, loadedRanges, loadedDomains, createdAt));
+
+        fs::resize_file(path, fs::file_size(path) - 1);
+
+        REQUIRE_FALSE(NetUtils::RangeIndex::read(path, 42, loadedRanges, loadedDomains, createdAt));
+        REQUIRE(loadedRanges.v4.isEmpty());
+        REQUIRE(loadedDomains.isEmpty());
     }
+
+    fs::remove_all(path.parent_path());
 }
 
 TEST_CASE("getAsIpRangesUrls", "[ipv4][ipv6][valid]") {
@@ -347,4 +629,706 @@ TEST_CASE("getAsIpRangesUrls", "[ipv4][ipv6][valid]") {
 
     REQUIRE(status == true);
     REQUIRE(urls.size() == 2);
-}
\ No newline at end of file
+}
+
+static NetTypes::IPv4Subnet makeSubnetV4(const std::string& str) {
+    DisableParseBGP dp;
+    NetTypes::IPv4Subnet sub;
+    NetUtils::Convert::parseIPv4(str, sub);
+    return sub;
+}
+
+static NetTypes::IPv6Subnet makeSubnetV6(const std::string& str) {
+    DisableParseBGP dp;
+    NetTypes::IPv6Subnet sub;
+    NetUtils::Convert::parseIPv6(str, sub);
+    return sub;
+}
+
+TEST_CASE("BGPTrie: longest prefix match for radix and patricia", "[bgp][trie]") {
+    const auto type = GENERATE(BGPTrieType::RADIX, BGPTrieType::PATRICIA);
+
+    NetTypes::IPv4Trie trie(type);
+    REQUIRE(trie.isEmpty());
+
+    trie.insert(makeSubnetV4("10.0.0.0/8"));
+    trie.insert(makeSubnetV4("10.1.0.0/16"));
+    trie.insert(makeSubnetV4("10.1.2.0/24"));
+    trie.insert(makeSubnetV4("192.168.0.0/16"));
+
+    REQUIRE_FALSE(trie.isEmpty());
+    REQUIRE(trie.getAllocatedBytes() > 0);
+
+    SECTION("most specific prefix is returned") {
+        const auto res = trie.lookup(makeSubnetV4("10.1.2.3").ip);
+        REQUIRE(res.has_value());
+        REQUIRE(res->prefix == 24);
+    }
+
+    SECTION("falls back to shorter prefix") {
+        const auto res = trie.lookup(makeSubnetV4("10.1.7.1").ip);
+        REQUIRE(res.has_value());
+        REQUIRE(res->prefix == 16);
+
+        const auto resShort = trie.lookup(makeSubnetV4("10.200.0.1").ip);
+        REQUIRE(resShort.has_value());
+        REQUIRE(resShort->prefix == 8);
+    }
+
+    SECTION("no match outside of prefixes") {
+        REQUIRE_FALSE(trie.lookup(makeSubnetV4("11.0.0.1").ip).has_value());
+        REQUIRE_FALSE(trie.lookup(makeSubnetV4("192.169.0.1").ip).has_value());
+    }
+}
+
+TEST_CASE("BGPTrie: withdraw removes route after last announcement", "[bgp][trie]") {
+    const auto type = GENERATE(BGPTrieType::RADIX, BGPTrieType::PATRICIA);
+
+    NetTypes::IPv4Trie trie(type);
+
+    trie.insert(makeSubnetV4("10.0.0.0/8"));
+    trie.insert(makeSubnetV4("10.1.0.0/16"), 2);
+    trie.insert(makeSubnetV4("10.1.2.0/24"));
+
+    // Route is announced by two peers
+    REQUIRE_FALSE(trie.withdraw(makeSubnetV4("10.1.0.0/16")));
+    REQUIRE(trie.lookup(makeSubnetV4("10.1.7.1").ip)->prefix == 16);
+
+    REQUIRE(trie.withdraw(makeSubnetV4("10.1.0.0/16")));
+    REQUIRE(trie.lookup(makeSubnetV4("10.1.7.1").ip)->prefix == 8);
+    REQUIRE(trie.lookup(makeSubnetV4("10.1.2.3").ip)->prefix == 24);
+
+    REQUIRE(trie.remove(makeSubnetV4("10.1.2.0/24")));
+    REQUIRE(trie.lookup(makeSubnetV4("10.1.2.3").ip)->prefix == 8);
+
+    REQUIRE_FALSE(trie.remove(makeSubnetV4("10.1.2.0/24")));
+    REQUIRE(trie.remove(makeSubnetV4("10.0.0.0/8")));
+    REQUIRE(trie.isEmpty());
+
+    // Released nodes are reused
+    trie.insert(makeSubnetV4("10.1.2.0/24"));
+    REQUIRE(trie.lookup(makeSubnetV4("10.1.2.3").ip)->prefix == 24);
+}
+
+TEST_CASE("BGPTrie: default route alone is not empty trie", "[bgp][trie]") {
+    const auto type = GENERATE(BGPTrieType::RADIX, BGPTrieType::PATRICIA);
+
+    // Default route is kept on root node
+    const NetTypes::IPv4Subnet defaultRoute = {0, 0};
+
+    NetTypes::TriePair pair(type);
+    pair.v4.insert(defaultRoute);
+
+    REQUIRE_FALSE(pair.v4.isEmpty());
+    REQUIRE_FALSE(pair.isEmpty());
+
+    const auto origLookupType = gLibNetworkSettings.ipv4LookupType;
+    gLibNetworkSettings.ipv4LookupType = IPv4LookupType::DIR_24_8;
+
+    pair.compileLookupTables();
+
+    gLibNetworkSettings.ipv4LookupType = origLookupType;
+
+    REQUIRE(pair.v4Compiled != nullptr);
+    REQUIRE(pair.lookup(makeSubnetV4("10.1.2.3").ip)->prefix == 0);
+
+    REQUIRE(pair.v4.remove(defaultRoute));
+    REQUIRE(pair.v4.isEmpty());
+}
+
+TEST_CASE("BGPTrie: statistics of nodes, routes and depth", "[bgp][trie]") {
+    SECTION("radix trie has node per bit") {
+        NetTypes::IPv4Trie trie(BGPTrieType::RADIX);
+
+        trie.insert(makeSubnetV4("10.0.0.0/8"));
+        trie.insert(makeSubnetV4("10.1.0.0/16"));
+
+        const auto stats = trie.getStats();
+
+        REQUIRE(stats.nodesCount == 17);
+        REQUIRE(stats.routesCount == 2);
+        REQUIRE(stats.depthHistogram[8] == 1);
+        REQUIRE(stats.depthHistogram[16] == 1);
+        REQUIRE(stats.sampledLookupsCount == 2);
+        REQUIRE(stats.avgLookupDepth == 16.5);
+    }
+
+    SECTION("patricia trie has node per route") {
+        NetTypes::IPv4Trie trie(BGPTrieType::PATRICIA);
+
+        trie.insert(makeSubnetV4("10.0.0.0/8"));
+        trie.insert(makeSubnetV4("10.1.0.0/16"));
+        trie.insert(makeSubnetV4("10.2.0.0/16"));
+        REQUIRE(trie.withdraw(makeSubnetV4("10.2.0.0/16")));
+
+        const auto stats = trie.getStats();
+
+        // Root, /8 and /16, released node is not counted
+        REQUIRE(stats.nodesCount == 3);
+        REQUIRE(stats.routesCount == 2);
+        REQUIRE(stats.depthHistogram[1] == 1);
+        REQUIRE(stats.depthHistogram[2] == 1);
+        REQUIRE(stats.avgLookupDepth == 3.0);
+    }
+}
+
+TEST_CASE("BGPTrie: batch lookup matches single lookups", "[bgp][trie]") {
+    const auto type = GENERATE(BGPTrieType::RADIX, BGPTrieType::PATRICIA);
+
+    NetTypes::IPv4Trie trie(type);
+
+    trie.insert(makeSubnetV4("10.0.0.0/8"));
+    trie.insert(makeSubnetV4("10.1.2.0/24"));
+    trie.insert(makeSubnetV4("10.1.2.200/32"));
+    trie.insert(makeSubnetV4("192.168.0.0/16"));
+
+    // More IPs than width of batch, so lanes are refilled
+    std::vector<NetTypes::addrIPv4> ips;
+
+    for (int i = 0; i < 100; ++i) {
+        ips.push_back(makeSubnetV4("10.1.2." + std::to_string(150 + i)).ip);
+        ips.push_back(makeSubnetV4("192." + std::to_string(160 + i % 16) + ".0.1").ip);
+    }
+
+    std::vector<std::optional<NetTypes::IPv4Subnet>> results;
+    trie.lookupBatch(ips, results);
+
+    REQUIRE(results.size() == ips.size());
+
+    for (size_t i = 0; i < ips.size(); ++i) {
+        const auto expected = trie.lookup(ips[i]);
+
+        REQUIRE(expected.has_value() == results[i].has_value());
+
+        if (expected) {
+            REQUIRE(expected->ip == results[i]->ip);
+            REQUIRE(expected->prefix == results[i]->prefix);
+        }
+    }
+}
+
+TEST_CASE("Dir24_8Table: same results as trie including prefixes longer than /24", "[bgp][trie]") {
+    NetTypes::IPv4Trie trie(BGPTrieType::PATRICIA);
+
+    trie.insert(makeSubnetV4("10.0.0.0/8"));
+    trie.insert(makeSubnetV4("10.1.2.0/24"));
+    trie.insert(makeSubnetV4("10.1.2.128/25"));
+    trie.insert(makeSubnetV4("10.1.2.200/32"));
+
+    const NetTypes::Dir24_8Table table(trie);
+
+    for (const auto& ip : {"10.1.2.1", "10.1.2.130", "10.1.2.200", "10.1.2.201", "10.9.9.9", "11.0.0.0"}) {
+        const auto bits = makeSubnetV4(ip).ip;
+        const auto expected = trie.lookup(bits);
+        const auto actual = table.lookup(bits);
+
+        REQUIRE(expected.has_value() == actual.has_value());
+
+        if (expected) {
+            REQUIRE(expected->prefix == actual->prefix);
+        }
+    }
+
+    REQUIRE(table.lookup(makeSubnetV4("10.1.2.130").ip)->prefix == 25);
+}
+
+TEST_CASE("IPv6TreeBitmap: same results as trie", "[bgp][trie]") {
+    NetTypes::IPv6Trie trie(BGPTrieType::PATRICIA);
+
+    trie.insert(makeSubnetV6("2001:db8::/32"));
+    trie.insert(makeSubnetV6("2001:db8:abcd::/48"));
+    trie.insert(makeSubnetV6("2001:db8:abcd:12::/63"));
+    trie.insert(makeSubnetV6("2001:db8:abcd:12::1/128"));
+
+    const NetTypes::IPv6TreeBitmap table(trie);
+
+    for (const auto& ip : {"2001:db8::1", "2001:db8:abcd::5", "2001:db8:abcd:13::1", "2001:db8:abcd:12::1", "2001:db9::1"}) {
+        const auto bits = makeSubnetV6(ip).ip;
+        const auto expected = trie.lookup(bits);
+        const auto actual = table.lookup(bits);
+
+        REQUIRE(expected.has_value() == actual.has_value());
+
+        if (expected) {
+            REQUIRE(expected->prefix == actual->prefix);
+        }
+    }
+
+    REQUIRE(table.lookup(makeSubnetV6("2001:db8:abcd:13::1").ip)->prefix == 63);
+    REQUIRE(table.lookup(makeSubnetV6("2001:db8:abcd:12::1").ip)->prefix == 128);
+}
+
+static void appendMrtRecord(std::string& out, const uint16_t type, const uint16_t subtype, const std::string& body) {
+    const auto put = [&out](const uint32_t value, const int bytes) {
+        for (int i = bytes - 1; i >= 0; --i) {
+            out += static_cast<char>((value >> (8 * i)) & 0xFF);
+        }
+    };
+
+    put(0, 4);
+    put(type, 2);
+    put(subtype, 2);
+    put(static_cast<uint32_t>(body.size()), 4);
+    out += body;
+}
+
+TEST_CASE("BGP::parseDump: reads prefixes from TABLE_DUMP_V2 and TABLE_DUMP records", "[bgp][mrt]") {
+    const fs::path dumpPath = fs::temp_directory_path() / "rglc_test_dump.mrt";
+    std::string dump;
+
+    using namespace std::string_literals;
+
+    // PEER_INDEX_TABLE (skipped), RIB_IPV4_UNICAST 10.1.0.0/16, RIB_IPV6_UNICAST 2001:db8::/32
+    appendMrtRecord(dump, NetUtils::MRT::kTypeTableDumpV2, NetUtils::MRT::kPeerIndexTable, "\x0a\x00\x00\x01\x00\x00\x00\x00"s);
+    appendMrtRecord(dump, NetUtils::MRT::kTypeTableDumpV2, NetUtils::MRT::kRibIPv4Unicast, "\x00\x00\x00\x01\x10\x0a\x01\x00\x00"s);
+    appendMrtRecord(dump, NetUtils::MRT::kTypeTableDumpV2, NetUtils::MRT::kRibIPv6Unicast, "\x00\x00\x00\x02\x20\x20\x01\x0d\xb8\x00\x00"s);
+
+    // Legacy TABLE_DUMP 192.168.0.0/16
+    appendMrtRecord(dump, NetUtils::MRT::kTypeTableDump, NetUtils::MRT::kTableDumpAfiIPv4, "\x00\x00\x00\x00\xc0\xa8\x00\x00\x10\x01"s);
+
+    // Truncated record at the end is ignored
+    dump += "\x00\x00\x00"s;
+
+    std::ofstream(dumpPath, std::ios::binary) << dump;
+
+    NetTypes::TriePair pair(BGPTrieType::PATRICIA);
+    NetUtils::BGP::parseDump(dumpPath.string(), pair);
+
+    REQUIRE(pair.lookup(makeSubnetV4("10.1.200.1").ip)->prefix == 16);
+    REQUIRE(pair.lookup(makeSubnetV4("192.168.3.4").ip)->prefix == 16);
+    REQUIRE(pair.lookup(makeSubnetV6("2001:db8::1").ip)->prefix == 32);
+    REQUIRE_FALSE(pair.lookup(makeSubnetV4("10.2.0.1").ip).has_value());
+
+    fs::remove(dumpPath);
+}
+
+TEST_CASE("BGP::parseDumps: routes of several dumps are merged", "[bgp][mrt]") {
+    const fs::path dir = fs::temp_directory_path() / "rglc_test_bgp_dumps";
+    fs::create_directories(dir);
+
+    using namespace std::string_literals;
+
+    std::string dumpA;
+    std::string dumpB;
+
+    // 10.1.0.0/16 and 10.1.2.0/24 in different dumps
+    appendMrtRecord(dumpA, NetUtils::MRT::kTypeTableDumpV2, NetUtils::MRT::kRibIPv4Unicast, "\x00\x00\x00\x01\x10\x0a\x01\x00\x00"s);
+    appendMrtRecord(dumpB, NetUtils::MRT::kTypeTableDumpV2, NetUtils::MRT::kRibIPv4Unicast, "\x00\x00\x00\x01\x18\x0a\x01\x02\x00\x00"s);
+
+    std::ofstream(dir / "rrc00.mrt", std::ios::binary) << dumpA;
+    std::ofstream(dir / "rrc01.mrt", std::ios::binary) << dumpB;
+
+    const auto paths = NetUtils::BGP::expandDumpPaths({(dir / "rrc*.mrt").string()});
+    REQUIRE(paths.size() == 2);
+
+    gLibNetworkSettings.bgpParseThreadsCount = 2;
+
+    NetTypes::TriePair pair(BGPTrieType::PATRICIA);
+    NetUtils::BGP::parseDumps(paths, pair);
+
+    gLibNetworkSettings.bgpParseThreadsCount = 0;
+
+    REQUIRE(pair.lookup(makeSubnetV4("10.1.2.3").ip)->prefix == 24);
+    REQUIRE(pair.lookup(makeSubnetV4("10.1.3.3").ip)->prefix == 16);
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("BGP cache: new version is published when dumps change, readers keep old one", "[bgp][mrt]") {
+    const fs::path dir = fs::temp_directory_path() / "rglc_test_bgp_cache";
+    const fs::path dumpPath = dir / "rrc00.mrt";
+    fs::create_directories(dir);
+
+    using namespace std::string_literals;
+
+    std::string dump;
+
+    // 10.1.0.0/16
+    appendMrtRecord(dump, NetUtils::MRT::kTypeTableDumpV2, NetUtils::MRT::kRibIPv4Unicast, "\x00\x00\x00\x01\x10\x0a\x01\x00\x00"s);
+    std::ofstream(dumpPath, std::ios::binary) << dump;
+
+    const std::vector<std::string> patterns = {dumpPath.string()};
+
+    REQUIRE(NetUtils::BGP::parseDumpsToCache(patterns));
+
+    const auto oldTrie = NetUtils::BGP::getTrieFromCache();
+    const auto oldVersion = NetUtils::BGP::getTrieCacheVersion();
+
+    REQUIRE(oldTrie != nullptr);
+    REQUIRE(oldTrie->lookup(makeSubnetV4("10.1.2.3").ip)->prefix == 16);
+
+    // Same dumps are not parsed again
+    REQUIRE_FALSE(NetUtils::BGP::parseDumpsToCache(patterns));
+    REQUIRE(NetUtils::BGP::loadTrieToCache(patterns) == oldTrie);
+
+    // 10.1.2.0/24 is added
+    appendMrtRecord(dump, NetUtils::MRT::kTypeTableDumpV2, NetUtils::MRT::kRibIPv4Unicast, "\x00\x00\x00\x02\x18\x0a\x01\x02\x00\x00"s);
+    std::ofstream(dumpPath, std::ios::binary) << dump;
+
+    REQUIRE(NetUtils::BGP::parseDumpsToCache(patterns));
+    REQUIRE(NetUtils::BGP::getTrieCacheVersion() == oldVersion + 1);
+
+    const auto newTrie = NetUtils::BGP::getTrieFromCache();
+
+    REQUIRE(newTrie->lookup(makeSubnetV4("10.1.2.3").ip)->prefix == 24);
+    REQUIRE(oldTrie->lookup(makeSubnetV4("10.1.2.3").ip)->prefix == 16);
+
+    fs::remove_all(dir);
+}
+
+// BGP4MP(_ET) MESSAGE_AS4 record body with UPDATE of IPv4 prefixes from peer 192.0.2.<peerId> (AS 6450<peerId>)
+static std::string makeUpdateBody(const bool isET, const uint8_t peerId, const std::string& withdrawn, const std::string& nlri) {
+    std::string body;
+
+    const auto put = [&body](const uint32_t value, const int bytes) {
+        for (int i = bytes - 1; i >= 0; --i) {
+            body += static_cast<char>((value >> (8 * i)) & 0xFF);
+        }
+    };
+
+    if (isET) {
+        put(0, 4);  // Microseconds
+    }
+
+    put(64500u + peerId, 4);                    // Peer AS
+    put(64499u, 4);                             // Local AS
+    put(0, 2);                                  // Interface index
+    put(1, 2);                                  // AFI IPv4
+    put(0xc0000200u + peerId, 4);               // Peer IP
+    put(0xc0000201u, 4);                        // Local IP
+
+    body += std::string(16, '\xff');            // Marker
+    put(static_cast<uint32_t>(19 + 2 + withdrawn.size() + 2 + nlri.size()), 2);
+    put(2, 1);                                  // UPDATE
+    put(static_cast<uint32_t>(withdrawn.size()), 2);
+    body += withdrawn;
+    put(0, 2);                                  // No path attributes
+    body += nlri;
+
+    return body;
+}
+
+static void appendBigEndian(std::string& out, const uint32_t value, const int bytes) {
+    for (int i = bytes - 1; i >= 0; --i) {
+        out += static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+// TABLE_DUMP_V2 PEER_INDEX_TABLE body with peers 192.0.2.<peerId> (AS 6450<peerId>), same as peers of makeUpdateBody
+static std::string makePeerIndexBody(const std::vector<uint8_t>& peerIds) {
+    std::string body;
+
+    appendBigEndian(body, 0x0a000001u, 4);              // Collector BGP ID
+    appendBigEndian(body, 0, 2);                        // Empty view name
+    appendBigEndian(body, static_cast<uint32_t>(peerIds.size()), 2);
+
+    for (const uint8_t peerId : peerIds) {
+        appendBigEndian(body, 0x02, 1);                 // IPv4 peer with 4-byte AS
+        appendBigEndian(body, 0xc0000200u + peerId, 4); // BGP ID
+        appendBigEndian(body, 0xc0000200u + peerId, 4); // Peer IP
+        appendBigEndian(body, 64500u + peerId, 4);      // Peer AS
+    }
+
+    return body;
+}
+
+// TABLE_DUMP_V2 RIB_IPV4_UNICAST body of prefix (NLRI encoding) with entries of peers by their indexes in peer table
+static std::string makeRibBody(const std::string& prefix, const std::vector<uint16_t>& peerIndexes) {
+    std::string body;
+
+    appendBigEndian(body, 1, 4);                        // Sequence number
+    body += prefix;
+    appendBigEndian(body, static_cast<uint32_t>(peerIndexes.size()), 2);
+
+    for (const uint16_t peerIndex : peerIndexes) {
+        appendBigEndian(body, peerIndex, 2);
+        appendBigEndian(body, 0, 4);                    // Originated time
+        appendBigEndian(body, 0, 2);                    // No attributes
+    }
+
+    return body;
+}
+
+TEST_CASE("BGP::applyUpdates: announcements are tracked per peer", "[bgp][mrt]") {
+    const auto type = GENERATE(BGPTrieType::RADIX, BGPTrieType::PATRICIA);
+
+    const fs::path dir = fs::temp_directory_path() / "rglc_test_bgp_updates";
+    fs::create_directories(dir);
+
+    using namespace std::string_literals;
+    using NetUtils::MRT::kTypeBGP4MP;
+    using NetUtils::MRT::kTypeBGP4MP_ET;
+    using NetUtils::MRT::kBGP4MPMessageAS4;
+
+    const auto kDumpRoute = "\x10\x0a\x01"s;     // 10.1.0.0/16
+    const auto kNewRoute = "\x10\x0a\x02"s;      // 10.2.0.0/16
+
+    std::string updatesA;
+    std::string updatesB;
+
+    // Peer 1 announces new route twice (implicit replace), peer 2 announces it too
+    appendMrtRecord(updatesA, kTypeBGP4MP, kBGP4MPMessageAS4, makeUpdateBody(false, 1, "", kNewRoute));
+    appendMrtRecord(updatesA, kTypeBGP4MP, kBGP4MPMessageAS4, makeUpdateBody(false, 1, "", kNewRoute));
+    appendMrtRecord(updatesA, kTypeBGP4MP, kBGP4MPMessageAS4, makeUpdateBody(false, 2, "", kNewRoute));
+
+    // Both peers withdraw new route, peer 1 replaces and withdraws route of dump
+    appendMrtRecord(updatesB, kTypeBGP4MP_ET, kBGP4MPMessageAS4, makeUpdateBody(true, 1, kNewRoute, kDumpRoute));
+    appendMrtRecord(updatesB, kTypeBGP4MP_ET, kBGP4MPMessageAS4, makeUpdateBody(true, 2, kNewRoute, ""));
+    appendMrtRecord(updatesB, kTypeBGP4MP_ET, kBGP4MPMessageAS4, makeUpdateBody(true, 1, kDumpRoute, ""));
+
+    std::ofstream(dir / "updates.1.mrt", std::ios::binary) << updatesA;
+    std::ofstream(dir / "updates.2.mrt", std::ios::binary) << updatesB;
+
+    // Route of dump is announced by peers 1 and 2
+    std::string dump;
+    appendMrtRecord(dump, NetUtils::MRT::kTypeTableDumpV2, NetUtils::MRT::kPeerIndexTable, makePeerIndexBody({1, 2}));
+    appendMrtRecord(dump, NetUtils::MRT::kTypeTableDumpV2, NetUtils::MRT::kRibIPv4Unicast, makeRibBody(kDumpRoute, {0, 1}));
+    std::ofstream(dir / "dump.mrt", std::ios::binary) << dump;
+
+    NetTypes::TriePair pair(type);
+    NetUtils::BGP::RoutePeers peers;
+
+    NetUtils::BGP::parseDump((dir / "dump.mrt").string(), pair, &peers);
+
+    const auto getPeersCount = [&peers](const NetTypes::IPv4Subnet& subnet) -> size_t {
+        const auto it = peers.v4.find({subnet.ip, subnet.prefix});
+        return it != peers.v4.end() ? it->second.size() : 0;
+    };
+
+    REQUIRE(getPeersCount(makeSubnetV4("10.1.0.0/16")) == 2);
+    REQUIRE(peers.peers.size() == 2);
+
+    SECTION("Repeated announcement does not add peers") {
+        const auto stats = NetUtils::BGP::applyUpdates({dir / "updates.1.mrt"}, pair, peers);
+
+        REQUIRE(stats.messagesCount == 3);
+        REQUIRE(stats.announcedCount == 3);
+        REQUIRE(getPeersCount(makeSubnetV4("10.2.0.0/16")) == 2);
+        REQUIRE(getPeersCount(makeSubnetV4("10.1.0.0/16")) == 2);
+        REQUIRE(pair.lookup(makeSubnetV4("10.2.0.1").ip)->prefix == 16);
+    }
+
+    SECTION("Route is removed after withdrawal of its last peer") {
+        const auto stats = NetUtils::BGP::applyUpdates({dir / "updates.1.mrt", dir / "updates.2.mrt"}, pair, peers);
+
+        REQUIRE(stats.messagesCount == 6);
+        REQUIRE(stats.withdrawnCount == 3);
+        REQUIRE(stats.removedCount == 1);
+
+        REQUIRE_FALSE(pair.lookup(makeSubnetV4("10.2.0.1").ip).has_value());
+
+        // Second peer of dump still announces route
+        REQUIRE(getPeersCount(makeSubnetV4("10.1.0.0/16")) == 1);
+        REQUIRE(pair.lookup(makeSubnetV4("10.1.0.1").ip)->prefix == 16);
+    }
+
+    SECTION("Withdrawal of peer which does not announce route is ignored") {
+        std::string updatesC;
+        appendMrtRecord(updatesC, kTypeBGP4MP_ET, kBGP4MPMessageAS4, makeUpdateBody(true, 3, kDumpRoute, ""));
+        appendMrtRecord(updatesC, kTypeBGP4MP_ET, kBGP4MPMessageAS4, makeUpdateBody(true, 4, kDumpRoute, ""));
+        appendMrtRecord(updatesC, kTypeBGP4MP_ET, kBGP4MPMessageAS4, makeUpdateBody(true, 5, kDumpRoute + kNewRoute, ""));
+        std::ofstream(dir / "updates.3.mrt", std::ios::binary) << updatesC;
+
+        const auto stats = NetUtils::BGP::applyUpdates({dir / "updates.3.mrt"}, pair, peers);
+
+        REQUIRE(stats.withdrawnCount == 4);
+        REQUIRE(stats.removedCount == 0);
+        REQUIRE(getPeersCount(makeSubnetV4("10.1.0.0/16")) == 2);
+        REQUIRE(pair.lookup(makeSubnetV4("10.1.0.1").ip)->prefix == 16);
+    }
+
+    SECTION("Route of dump peers is kept after withdrawal of new peer") {
+        std::string updatesD;
+        appendMrtRecord(updatesD, kTypeBGP4MP_ET, kBGP4MPMessageAS4, makeUpdateBody(true, 3, "", kDumpRoute));
+        appendMrtRecord(updatesD, kTypeBGP4MP_ET, kBGP4MPMessageAS4, makeUpdateBody(true, 3, kDumpRoute, ""));
+        std::ofstream(dir / "updates.4.mrt", std::ios::binary) << updatesD;
+
+        const auto stats = NetUtils::BGP::applyUpdates({dir / "updates.4.mrt"}, pair, peers);
+
+        REQUIRE(stats.removedCount == 0);
+        REQUIRE(getPeersCount(makeSubnetV4("10.1.0.0/16")) == 2);
+        REQUIRE(pair.lookup(makeSubnetV4("10.1.0.1").ip)->prefix == 16);
+    }
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("BGP cache: appended updates files are applied to published tries", "[bgp][mrt]") {
+    const fs::path dir = fs::temp_directory_path() / "rglc_test_bgp_cache_updates";
+    const fs::path dumpPath = dir / "rrc00.mrt";
+    fs::create_directories(dir);
+
+    using namespace std::string_literals;
+    using NetUtils::MRT::kTypeBGP4MP;
+    using NetUtils::MRT::kBGP4MPMessageAS4;
+
+    // 10.1.0.0/16 is announced by peer 1
+    std::string dump;
+    appendMrtRecord(dump, NetUtils::MRT::kTypeTableDumpV2, NetUtils::MRT::kPeerIndexTable, makePeerIndexBody({1}));
+    appendMrtRecord(dump, NetUtils::MRT::kTypeTableDumpV2, NetUtils::MRT::kRibIPv4Unicast, makeRibBody("\x10\x0a\x01"s, {0}));
+    std::ofstream(dumpPath, std::ios::binary) << dump;
+
+    // Peer 2 announces 10.2.0.0/16
+    std::string updatesA;
+    appendMrtRecord(updatesA, kTypeBGP4MP, kBGP4MPMessageAS4, makeUpdateBody(false, 2, "", "\x10\x0a\x02"s));
+    std::ofstream(dir / "updates.1.mrt", std::ios::binary) << updatesA;
+
+    const std::vector<std::string> patterns = {dumpPath.string()};
+    gLibNetworkSettings.bgpUpdatePaths = {(dir / "updates.*.mrt").string()};
+
+    REQUIRE(NetUtils::BGP::parseDumpsToCache(patterns));
+    REQUIRE(NetUtils::BGP::getTrieCacheUpdateStats().messagesCount == 1);
+
+    const auto oldTrie = NetUtils::BGP::getTrieFromCache();
+    REQUIRE(oldTrie->lookup(makeSubnetV4("10.2.0.1").ip)->prefix == 16);
+
+    // Peer 1 withdraws 10.1.0.0/16, peer 2 announces 10.3.0.0/16
+    std::string updatesB;
+    appendMrtRecord(updatesB, kTypeBGP4MP, kBGP4MPMessageAS4, makeUpdateBody(false, 1, "\x10\x0a\x01"s, ""));
+    appendMrtRecord(updatesB, kTypeBGP4MP, kBGP4MPMessageAS4, makeUpdateBody(false, 2, "", "\x10\x0a\x03"s));
+    std::ofstream(dir / "updates.2.mrt", std::ios::binary) << updatesB;
+
+    // Only new file is applied
+    REQUIRE(NetUtils::BGP::parseDumpsToCache(patterns));
+    REQUIRE(NetUtils::BGP::getTrieCacheUpdateStats().messagesCount == 2);
+    REQUIRE(NetUtils::BGP::getTrieCacheUpdateStats().removedCount == 1);
+
+    const auto newTrie = NetUtils::BGP::getTrieFromCache();
+
+    REQUIRE_FALSE(newTrie->lookup(makeSubnetV4("10.1.0.1").ip).has_value());
+    REQUIRE(newTrie->lookup(makeSubnetV4("10.2.0.1").ip)->prefix == 16);
+    REQUIRE(newTrie->lookup(makeSubnetV4("10.3.0.1").ip)->prefix == 16);
+    REQUIRE(oldTrie->lookup(makeSubnetV4("10.1.0.1").ip)->prefix == 16);
+
+    REQUIRE_FALSE(NetUtils::BGP::parseDumpsToCache(patterns));
+
+    gLibNetworkSettings.bgpUpdatePaths.clear();
+
+    fs::remove_all(dir);
+}
+
+TEST_CASE("BGP snapshot: mapped tries give same results and follow dump changes", "[bgp][trie]") {
+    const auto type = GENERATE(BGPTrieType::RADIX, BGPTrieType::PATRICIA);
+
+    const fs::path dir = fs::temp_directory_path() / "rglc_test_bgp_snapshot";
+    const fs::path dumpPath = dir / "dump.mrt";
+
+    fs::create_directories(dir);
+    std::ofstream(dumpPath) << "fake dump content";
+
+    NetTypes::TriePair source(type);
+    source.v4.insert(makeSubnetV4("10.0.0.0/8"));
+    source.v4.insert(makeSubnetV4("10.1.2.0/24"));
+    source.v6.insert(makeSubnetV6("2001:db8::/32"));
+
+    const auto fingerprint = NetUtils::BGP::getDumpFingerprint({dumpPath});
+    const auto snapshotPath = NetUtils::BGP::getSnapshotPath(dir, {dumpPath}, type);
+
+    NetUtils::BGP::writeSnapshot(snapshotPath, source, fingerprint);
+
+    SECTION("Snapshot is mapped for the same dump") {
+        NetTypes::TriePair loaded(type);
+
+        REQUIRE(NetUtils::BGP::loadSnapshot(snapshotPath, loaded, fingerprint));
+        REQUIRE(loaded.lookup(makeSubnetV4("10.1.2.3").ip)->prefix == 24);
+        REQUIRE(loaded.lookup(makeSubnetV4("10.9.0.1").ip)->prefix == 8);
+        REQUIRE(loaded.lookup(makeSubnetV6("2001:db8::1").ip)->prefix == 32);
+        REQUIRE_FALSE(loaded.lookup(makeSubnetV4("11.0.0.1").ip).has_value());
+
+        // Modification copies mapped storage
+        loaded.v4.insert(makeSubnetV4("11.0.0.0/8"));
+        REQUIRE(loaded.lookup(makeSubnetV4("11.0.0.1").ip)->prefix == 8);
+        REQUIRE(loaded.lookup(makeSubnetV4("10.1.2.3").ip)->prefix == 24);
+    }
+
+    SECTION("Snapshot is rejected after dump is changed") {
+        std::ofstream(dumpPath) << "another fake dump content";
+
+        NetTypes::TriePair loaded(type);
+
+        REQUIRE_FALSE(NetUtils::BGP::loadSnapshot(snapshotPath, loaded, NetUtils::BGP::getDumpFingerprint({dumpPath})));
+        REQUIRE(loaded.isEmpty());
+    }
+
+    SECTION("Snapshot without peers is rejected when peers are requested") {
+        NetTypes::TriePair loaded(type);
+        NetUtils::BGP::RoutePeers peers;
+
+        REQUIRE_FALSE(NetUtils::BGP::loadSnapshot(snapshotPath, loaded, fingerprint, &peers));
+        REQUIRE(loaded.isEmpty());
+    }
+
+    SECTION("Peers of routes are kept in snapshot") {
+        NetUtils::BGP::RoutePeers peers;
+        NetUtils::MRT::Peer peerA;
+        NetUtils::MRT::Peer peerB;
+        peerA.as = 1;
+        peerB.as = 2;
+
+        const uint32_t indexA = peers.getPeerIndex(peerA);
+        const uint32_t indexB = peers.getPeerIndex(peerB);
+        const auto subnetV4 = makeSubnetV4("10.1.2.0/24");
+        const auto subnetV6 = makeSubnetV6("2001:db8::/32");
+
+        peers.v4[{subnetV4.ip, subnetV4.prefix}] = {indexA, indexB};
+        peers.v6[{subnetV6.ip, subnetV6.prefix}] = {indexB};
+
+        NetUtils::BGP::writeSnapshot(snapshotPath, source, fingerprint, &peers);
+
+        NetTypes::TriePair loaded(type);
+        NetUtils::BGP::RoutePeers loadedPeers;
+
+        REQUIRE(NetUtils::BGP::loadSnapshot(snapshotPath, loaded, fingerprint, &loadedPeers));
+        REQUIRE(loaded.lookup(makeSubnetV4("10.1.2.3").ip)->prefix == 24);
+
+        REQUIRE(loadedPeers.peers == peers.peers);
+        REQUIRE(loadedPeers.peerIndexes == peers.peerIndexes);
+        REQUIRE(loadedPeers.v4 == peers.v4);
+        REQUIRE(loadedPeers.v6 == peers.v6);
+    }
+
+    fs::remove_all(dir);
+}
+
+// Hidden benchmark, launched manually with real dump: RGLC_BGP_DUMP=<path> test_runner "[benchmark]"
+TEST_CASE("IPv6 LPM engines on real BGP dump", "[.][benchmark][bgp]") {
+    const char* dumpPath = std::getenv("RGLC_BGP_DUMP");
+
+    if (dumpPath == nullptr) {
+        SKIP("RGLC_BGP_DUMP is not set");
+    }
+
+    NetTypes::TriePair radixPair(BGPTrieType::RADIX);
+    NetTypes::TriePair patriciaPair(BGPTrieType::PATRICIA);
+
+    NetUtils::BGP::parseDump(dumpPath, radixPair);
+    NetUtils::BGP::parseDump(dumpPath, patriciaPair);
+
+    const NetTypes::IPv6TreeBitmap treeBitmap(patriciaPair.v6);
+
+    // Query addresses are taken from routes of dump
+    std::vector<NetTypes::addrIPv6> queries;
+    patriciaPair.v6.forEachRoute([&queries](const NetTypes::IPv6Subnet& subnet) {
+        queries.push_back(subnet.ip);
+    });
+
+    REQUIRE_FALSE(queries.empty());
+
+    BENCHMARK("radix trie") {
+        size_t found = 0;
+        for (const auto& ip : queries) found += radixPair.v6.lookup(ip).has_value();
+        return found;
+    };
+
+    BENCHMARK("patricia trie") {
+        size_t found = 0;
+        for (const auto& ip : queries) found += patriciaPair.v6.lookup(ip).has_value();
+        return found;
+    };
+
+    BENCHMARK("tree bitmap") {
+        size_t found = 0;
+        for (const auto& ip : queries) found += treeBitmap.lookup(ip).has_value();
+        return found;
+    };
+}